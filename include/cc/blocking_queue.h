@@ -0,0 +1,143 @@
+/**
+ * blocking_queue.h
+ * Bounded thread-safe FIFO queue with blocking, timed & batched operations.
+*/
+#ifndef CC_STD_BLOCKING_QUEUE_H
+#define CC_STD_BLOCKING_QUEUE_H
+#include "cc/common.h"
+#include "cc/queue.h"
+#include <stdbool.h>
+#include <threads.h>
+
+#define BLOCKING_QUEUE_WAIT_FOREVER SIZE_MAX
+
+/// @brief Create a new blocking queue. The capacity is fixed, producers wait while it is full.
+/// @param t Queue type
+/// @param n Maximum number of elements
+/// @return Queue pointer
+#define blocking_queue_create(t, n) _blocking_queue_factory(sizeof(t), n)
+
+/// @brief Deallocate a blocking queue. No other thread may be using it.
+/// @param q Queue pointer
+#define blocking_queue_destroy(q) _blocking_queue_destroy(q)
+
+/// @brief Add an element to the back of the queue, waiting for room.
+/// @param q Queue pointer
+/// @param d Data pointer
+/// @return True on success, false if the queue was closed
+#define blocking_queue_push(q, d) _blocking_queue_push(q, (void*)(d), BLOCKING_QUEUE_WAIT_FOREVER)
+
+/// @brief Add an element to the back of the queue if there is room right now.
+/// @param q Queue pointer
+/// @param d Data pointer
+/// @return True on success, false if the queue was full or closed
+#define blocking_queue_try_push(q, d) _blocking_queue_push(q, (void*)(d), 0)
+
+/// @brief Add an element to the back of the queue, waiting up to a timeout for room.
+/// @param q Queue pointer
+/// @param d Data pointer
+/// @param ms Timeout in milliseconds
+/// @return True on success, false on timeout or if the queue was closed
+#define blocking_queue_push_timeout(q, d, ms) _blocking_queue_push(q, (void*)(d), ms)
+
+/// @brief Add up to n elements to the back of the queue under one lock, waiting until at least one fits. Call again with the rest if fewer
+/// @brief than n were taken.
+/// @param q Queue pointer
+/// @param d Data pointer to an array of n elements
+/// @param n Number of elements
+/// @return Number of elements added, 0 if the queue was closed
+#define blocking_queue_push_batch(q, d, n) _blocking_queue_push_n(q, (void*)(d), n, BLOCKING_QUEUE_WAIT_FOREVER)
+
+/// @brief Add up to n elements to the back of the queue under one lock, waiting up to a timeout until at least one fits.
+/// @param q Queue pointer
+/// @param d Data pointer to an array of n elements
+/// @param n Number of elements
+/// @param ms Timeout in milliseconds (0 to not wait)
+/// @return Number of elements added, 0 on timeout or if the queue was closed
+#define blocking_queue_push_batch_timeout(q, d, n, ms) _blocking_queue_push_n(q, (void*)(d), n, ms)
+
+/// @brief Remove the element at the front of the queue, waiting for one to arrive.
+/// @param q Queue pointer
+/// @param d Data pointer to copy the element to
+/// @return True on success, false if the queue was closed & drained
+#define blocking_queue_pop(q, d) _blocking_queue_pop(q, (void*)(d), BLOCKING_QUEUE_WAIT_FOREVER)
+
+/// @brief Remove the element at the front of the queue if there is one right now.
+/// @param q Queue pointer
+/// @param d Data pointer to copy the element to
+/// @return True on success, false if the queue was empty
+#define blocking_queue_try_pop(q, d) _blocking_queue_pop(q, (void*)(d), 0)
+
+/// @brief Remove the element at the front of the queue, waiting up to a timeout for one to arrive.
+/// @param q Queue pointer
+/// @param d Data pointer to copy the element to
+/// @param ms Timeout in milliseconds
+/// @return True on success, false on timeout or if the queue was closed & drained
+#define blocking_queue_pop_timeout(q, d, ms) _blocking_queue_pop(q, (void*)(d), ms)
+
+/// @brief Remove up to n elements from the front of the queue under one lock, waiting until there is at least one.
+/// @param q Queue pointer
+/// @param d Data pointer to an array with room for n elements
+/// @param n Number of elements
+/// @return Number of elements removed, 0 if the queue was closed & drained
+#define blocking_queue_pop_batch(q, d, n) _blocking_queue_pop_n(q, (void*)(d), n, BLOCKING_QUEUE_WAIT_FOREVER)
+
+/// @brief Remove up to n elements from the front of the queue under one lock, waiting up to a timeout until there is at least one.
+/// @param q Queue pointer
+/// @param d Data pointer to an array with room for n elements
+/// @param n Number of elements
+/// @param ms Timeout in milliseconds (0 to not wait)
+/// @return Number of elements removed, 0 on timeout or if the queue was closed & drained
+#define blocking_queue_pop_batch_timeout(q, d, n, ms) _blocking_queue_pop_n(q, (void*)(d), n, ms)
+
+/// @brief Close the queue. Waiting threads wake up, pushes fail from now on & pops fail once the queue is drained.
+/// @param q Queue pointer
+#define blocking_queue_close(q) _blocking_queue_close(q)
+
+/// @brief Get the number of elements in the queue. Only a snapshot while other threads are using it.
+/// @param q Queue pointer
+/// @return Queue size
+#define blocking_queue_size(q) _blocking_queue_length(q)
+
+/// @brief Get the maximum number of elements in the queue.
+/// @param q Queue pointer
+/// @return Queue capacity
+#define blocking_queue_capacity(q) ((q)->_queue->_capacity)
+
+/// @brief Get the size of the queue in memory.
+/// @param q Queue pointer
+/// @return Number of bytes
+#define blocking_queue_bytes(q) ((q) ? sizeof(blocking_queue_t) + queue_bytes((q)->_queue) : 0)
+
+/// @brief Bounded FIFO queue guarded by one lock. The ring is a queue_t created at full capacity, so it never reallocates.
+typedef struct {
+	mtx_t _lock;
+	cnd_t _not_empty;
+	cnd_t _not_full;
+	size_t _waiting_producers;
+	size_t _waiting_consumers;
+	bool _closed;
+	queue_t* _queue;
+} blocking_queue_t;
+
+blocking_queue_t* _blocking_queue_factory(size_t, size_t);
+
+void _blocking_queue_destroy(blocking_queue_t*);
+
+bool _blocking_queue_deadline(struct timespec*, size_t);
+
+bool _blocking_queue_wait(blocking_queue_t*, cnd_t*, size_t*, struct timespec*, size_t);
+
+size_t _blocking_queue_push_n(blocking_queue_t*, void*, size_t, size_t);
+
+bool _blocking_queue_push(blocking_queue_t*, void*, size_t);
+
+size_t _blocking_queue_pop_n(blocking_queue_t*, void*, size_t, size_t);
+
+bool _blocking_queue_pop(blocking_queue_t*, void*, size_t);
+
+void _blocking_queue_close(blocking_queue_t*);
+
+size_t _blocking_queue_length(blocking_queue_t*);
+
+#endif	// CC_STD_BLOCKING_QUEUE_H
@@ -47,6 +47,38 @@
 
 #endif // defined(_MSC_VER)
 
+/// @brief Count the leading zero bits of a nonzero 32-bit integer.
+#ifndef CC_CLZ
+#if defined(_MSC_VER)
+#include <intrin.h>
+static __inline unsigned int _cc_clz(uint32_t x) { unsigned long i; _BitScanReverse(&i, x); return 31U - (unsigned int)i; }
+#define CC_CLZ(x) _cc_clz(x)
+#else
+#define CC_CLZ(x) ((unsigned int)__builtin_clz(x))
+#endif
+#endif
+
+/// @brief Count the trailing zero bits of a nonzero 64-bit integer.
+#ifndef CC_CTZ64
+#if defined(_MSC_VER)
+#include <intrin.h>
+static __inline unsigned int _cc_ctz64(uint64_t x) { unsigned long i; _BitScanForward64(&i, x); return (unsigned int)i; }
+#define CC_CTZ64(x) _cc_ctz64(x)
+#else
+#define CC_CTZ64(x) ((unsigned int)__builtin_ctzll(x))
+#endif
+#endif
+
+/// @brief Count the set bits of a 64-bit integer.
+#ifndef CC_POPCOUNT64
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CC_POPCOUNT64(x) ((unsigned int)__popcnt64(x))
+#else
+#define CC_POPCOUNT64(x) ((unsigned int)__builtin_popcountll(x))
+#endif
+#endif
+
 // Custom memory allocators
 #ifndef CC_MALLOC
 #define CC_MALLOC malloc
@@ -54,6 +86,9 @@
 #ifndef CC_CALLOC
 #define CC_CALLOC calloc
 #endif
+#ifndef CC_REALLOC
+#define CC_REALLOC realloc
+#endif
 #ifndef CC_FREE
 #define CC_FREE free
 #endif
@@ -1,10 +1,11 @@
 /*
  * deque.h
- * Double-ended queue.
+ * Double-ended queue, either one circular buffer or a map of fixed-size chunks.
  */
 #ifndef CC_STD_DEQUEUE_H
 #define CC_STD_DEQUEUE_H
 #include "cc/common.h"
+#include <stdbool.h>
 
 #ifndef DEQUE_DEFAULT_CAPACITY
 #define DEQUE_DEFAULT_CAPACITY 1ULL
@@ -12,27 +13,57 @@
 #ifndef DEQUE_MAX_CAPACITY
 #define DEQUE_MAX_CAPACITY SIZE_MAX - 1
 #endif
+#ifndef DEQUE_DEFAULT_MAP_CAPACITY
+#define DEQUE_DEFAULT_MAP_CAPACITY 8ULL
+#endif
+#ifndef DEQUE_CHUNK_BYTES
+#define DEQUE_CHUNK_BYTES 4096ULL
+#endif
+
+#define DEQUE_FLAG_CHUNKED 0x01
 
 #define _deque_pos(q, i) &(q)->_buffer[0] + ((i) * (q)->_element_size)
+#define _deque_chunk(q, c) ((uint8_t**)&(q)->_buffer[0])[c]
+#define _deque_chunk_pos(q, o) (_deque_chunk(q, (o) / (q)->_chunk_length) + (((o) % (q)->_chunk_length) * (q)->_element_size))
 
 /// @brief Create a new deque.
 /// @param t Dequeue type
 /// @return Dequeue pointer
-#define deque_create(t) _deque_factory(sizeof(t), DEQUE_DEFAULT_CAPACITY)
+#define deque_create(t) _deque_factory(sizeof(t), DEQUE_DEFAULT_CAPACITY, 0)
+
+/// @brief Create a new deque made of fixed-size chunks. Pushing at either end never moves existing elements, so pointers to them stay valid
+/// @brief until they are popped, and growing only copies the chunk map.
+/// @param t Dequeue type
+/// @return Dequeue pointer
+#define deque_create_chunked(t) _deque_factory(sizeof(t), DEQUE_DEFAULT_MAP_CAPACITY, DEQUE_FLAG_CHUNKED)
 
 /// @brief Deallocate a deque.
 /// @param q Dequeue pointer.
-#define deque_destroy(q) CC_FREE(q)
+#define deque_destroy(q) _deque_destroy(q)
 
 /// @brief Get the front element of the deque.
 /// @param q Dequeue pointer
 /// @return Void data pointer, or NULL if empty
-#define deque_front(q) (void*)((q)->_length > 0 ? _deque_pos(q, (q)->_tail) : NULL)
+#define deque_front(q) _deque_at(q, 0)
 
 /// @brief Get the back element of the deque.
 /// @param q Dequeue pointer
 /// @return Void data pointer, or NULL if empty
-#define deque_back(q) (void*)((q)->_length > 0 ? _deque_pos(q, (q)->_head) : NULL)
+#define deque_back(q) _deque_at(q, (q)->_length - 1)
+
+/// @brief Get an element of the deque by position.
+/// @param q Dequeue pointer
+/// @param i Index, counting from the front
+/// @return Void data pointer, or NULL if out of range
+#define deque_at(q, i) _deque_at(q, i)
+
+/// @brief Describe the elements from the front as contiguous runs, ready to hand to writev or memcpy. A circular deque needs at most two
+/// @brief spans, a chunked one up to one per chunk.
+/// @param q Dequeue pointer
+/// @param s Span array
+/// @param n Maximum number of spans to fill
+/// @return Number of spans filled
+#define deque_spans(q, s, n) _deque_spans(q, s, n)
 
 /// @brief Add an element to the front of the deque.
 /// @param q Dequeue pointer
@@ -54,6 +85,18 @@
 /// @param q Dequeue pointer
 #define deque_pop_back(q) _deque_remove_back(q, 1)
 
+/// @brief Remove up to n elements from the front of the deque at once.
+/// @param q Dequeue pointer
+/// @param n Number of elements
+/// @return Number of elements removed
+#define deque_pop_front_n(q, n) _deque_remove_front(q, n)
+
+/// @brief Remove up to n elements from the back of the deque at once.
+/// @param q Dequeue pointer
+/// @param n Number of elements
+/// @return Number of elements removed
+#define deque_pop_back_n(q, n) _deque_remove_back(q, n)
+
 /// @brief Get the number of elements in the deque.
 /// @param q Dequeue pointer
 /// @return Dequeue size
@@ -61,35 +104,59 @@
 
 /// @brief Remove all elements from the deque.
 /// @param q Dequeue pointer
-#define deque_clear(q) _deque_remove(q, (q)->_length)
+#define deque_clear(q) _deque_remove_front(q, (q)->_length)
 
 /// @brief Get the sze of the deque in memory.
 /// @param q Dequeue pointer
 /// @return Number of bytes
-#define deque_bytes(q) ((q) ? (_deque_size((q)->_element_size, (q)->_capacity)) : 0)
+#define deque_bytes(q) _deque_bytes(q)
+
+/// @brief Contiguous run of deque elements.
+typedef struct {
+	void* data;
+	size_t count;
+} deque_span_t;
 
-/// @brief Double-ended queue.
+/// @brief Double-ended queue. Elements run from the head (front) to just before the tail (back), which are slots of the circular buffer or
+/// @brief offsets into the chunk map.
 typedef struct {
 	size_t _length;
 	size_t _head;
 	size_t _tail;
 	size_t _capacity;
 	size_t _element_size;
+	size_t _flags;
+	size_t _chunk_length;
+	uint8_t* _spare;
 	uint8_t _buffer[];
 } deque_t;
 
-size_t _deque_size(size_t, size_t);
+size_t _deque_size(size_t, size_t, size_t);
+
+deque_t* _deque_factory(size_t, size_t, size_t);
 
-deque_t* _deque_factory(size_t, size_t);
+void _deque_destroy(deque_t*);
 
 deque_t* _deque_resize(deque_t*, size_t);
 
+deque_t* _deque_remap(deque_t*, size_t);
+
+uint8_t* _deque_chunk_take(deque_t*, size_t);
+
+void _deque_chunk_release(deque_t*, size_t, size_t);
+
+void* _deque_at(deque_t*, size_t);
+
+size_t _deque_spans(deque_t*, deque_span_t*, size_t);
+
 void* _deque_insert_front(deque_t**, void*);
 
 void* _deque_insert_back(deque_t**, void*);
 
-void _deque_remove_front(deque_t*, size_t);
+size_t _deque_remove_front(deque_t*, size_t);
+
+size_t _deque_remove_back(deque_t*, size_t);
 
-void _deque_remove_back(deque_t*, size_t);
+size_t _deque_bytes(deque_t*);
 
-#endif	// CC_STD_DEQUEUE_H
\ No newline at end of file
+#endif	// CC_STD_DEQUEUE_H
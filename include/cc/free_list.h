@@ -1,10 +1,13 @@
 /**
  * free_list.h
- * List of elements that fills in empty slots first.
+ * List of elements that fills in empty slots first, optionally addressed through generational handles or kept in fixed pages.
 */
 #ifndef CC_STD_FREE_LIST_H
 #define CC_STD_FREE_LIST_H
 #include "cc/common.h"
+#include <stdbool.h>
+
+typedef uint64_t free_list_handle_t;
 
 #ifndef FREE_LIST_DEFAULT_CAPACITY
 #define FREE_LIST_DEFAULT_CAPACITY 8ULL
@@ -12,27 +15,59 @@
 #ifndef FREE_LIST_MAX_CAPACITY
 #define FREE_LIST_MAX_CAPACITY SIZE_MAX - 1
 #endif
+#ifndef FREE_LIST_PAGE_SIZE
+#define FREE_LIST_PAGE_SIZE 256ULL
+#endif
+#if (FREE_LIST_PAGE_SIZE % 64) != 0
+#error "FREE_LIST_PAGE_SIZE must be a multiple of 64"
+#endif
 
-#define _free_list_bit_num(l) ((l->_capacity / 8) + 1)
+#define FREE_LIST_FLAG_SLOT_MAP 0x01
+#define FREE_LIST_FLAG_PAGED 0x02
+#define FREE_LIST_INVALID_HANDLE 0
+
+#define _free_list_align(n) (((n) + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1))
+#define _free_list_bit_num(l) _free_list_align((l->_capacity / 8) + 1)
 #define _free_list_bit_set(l, n) (l->_buffer[n/8] |= (1 << (n % 8)))
 #define _free_list_bit_clr(l, n) (l->_buffer[n/8] &= ~(1 << (n % 8)))
 #define _free_list_bit_get(l, n) ((l->_buffer[n/8] >> (n % 8)) & 1)
 #define _free_list_pos(l, i) &(l)->_buffer[_free_list_bit_num(l)] + ((i) * (l)->_element_size)
 
+#define _free_list_slot(l, s) ((_free_list_slot_t*)&(l)->_buffer[0])[s]
+#define _free_list_dense_slot(l, i) ((uint32_t*)(&(l)->_buffer[0] + ((l)->_capacity * sizeof(_free_list_slot_t))))[i]
+#define _free_list_dense_pos(l, i) &(l)->_buffer[0] + ((l)->_capacity * sizeof(_free_list_slot_t)) + _free_list_align((l)->_capacity * sizeof(uint32_t)) + ((i) * (l)->_element_size)
+#define _free_list_handle(g, s) (((uint64_t)(g) << 32) | (uint64_t)(s))
+#define _free_list_page(l, p) ((_free_list_page_t**)&(l)->_buffer[0])[p]
+#define _free_list_page_size(e) (offsetof(_free_list_page_t, _buffer) + (FREE_LIST_PAGE_SIZE * (e)))
+#define _free_list_page_pos(l, i) (_free_list_page(l, (i) / FREE_LIST_PAGE_SIZE)->_buffer + (((i) % FREE_LIST_PAGE_SIZE) * (l)->_element_size))
+#define _free_list_index_pos(l, i) (((l)->_flags & FREE_LIST_FLAG_PAGED) ? _free_list_page_pos(l, i) : _free_list_pos(l, i))
+
 /// @brief Create a new free list.
 /// @param t List type
 /// @return List pointer
-#define free_list_create(t) _free_list_factory(sizeof(t), FREE_LIST_DEFAULT_CAPACITY);
+#define free_list_create(t) _free_list_factory(sizeof(t), FREE_LIST_DEFAULT_CAPACITY, 0)
+
+/// @brief Create a new free list in slot map mode. Elements are packed densely & addressed through handles that go stale once the element
+/// @brief is removed, instead of through raw indices that get reused.
+/// @param t List type
+/// @return List pointer
+#define free_list_create_slot_map(t) _free_list_factory(sizeof(t), FREE_LIST_DEFAULT_CAPACITY, FREE_LIST_FLAG_SLOT_MAP)
+
+/// @brief Create a new free list that grows by adding fixed-size pages. Elements never move, so pointers to them stay valid until they are
+/// @brief removed, and growing never copies existing elements.
+/// @param t List type
+/// @return List pointer
+#define free_list_create_paged(t) _free_list_factory(sizeof(t), FREE_LIST_PAGE_SIZE, FREE_LIST_FLAG_PAGED)
 
 /// @brief Deallocate a list.
 /// @param l List pointer
-#define free_list_destroy(l) CC_FREE(l);
+#define free_list_destroy(l) _free_list_destroy(l)
 
 /// @brief Get an element from the list.
 /// @param l List pointer
 /// @param i Index
-/// @return Void data pointer, or NULL if invalid index
-#define free_list_get(l, i) (void*)((i < (l)->_length && _free_list_bit_get(l, i)) ? _free_list_pos(l, i) : NULL)
+/// @return Void data pointer, or NULL if invalid index or the list is in slot map mode
+#define free_list_get(l, i) _free_list_get(l, i)
 
 /// @brief Get the number of elements in the list.
 /// @param l List pointer
@@ -41,26 +76,69 @@
 
 /// @brief Insert the element at the first free spot in the list.
 /// @param l List pointer
-/// @param i Index pointer (will be set to the index the element was inserted at, or NULL if insertion failed)
-/// @param d Data pointer
+/// @param i Index pointer (will be set to the index the element was inserted at, or SIZE_MAX if insertion failed)
+/// @param d Data pointer (or NULL to leave the element uninitialized)
 /// @return Void data pointer to inserted element, or NULL if insertion failed
 #define free_list_insert(l, i, d) _free_list_insert(&l, i, (void*)d)
 
 /// @brief Remove the element at the point in the list.
 /// @param l List pointer
 /// @param i Index
-#define free_list_remove(l, i) _free_list_remove(l, i, 1);
+#define free_list_remove(l, i) _free_list_remove(l, i, 1)
+
+/// @brief Insert an element into a slot map & get a handle to it.
+/// @param l List pointer
+/// @param d Data pointer
+/// @return Element handle, or FREE_LIST_INVALID_HANDLE on failure
+#define free_list_insert_handle(l, d) _free_list_insert_handle(&l, (void*)(d))
+
+/// @brief Get an element from a slot map. The pointer is only valid until the next insert or remove, since elements are kept packed.
+/// @param l List pointer
+/// @param h Element handle
+/// @return Void data pointer, or NULL if the handle is stale
+#define free_list_get_handle(l, h) _free_list_get_handle(l, h)
+
+/// @brief Remove an element from a slot map. The last element is moved into its place to keep the elements packed.
+/// @param l List pointer
+/// @param h Element handle
+/// @return True if the handle was live
+#define free_list_remove_handle(l, h) _free_list_remove_handle(l, h)
+
+/// @brief Check if a handle refers to a live element of a slot map.
+/// @param l List pointer
+/// @param h Element handle
+/// @return True if the element is in the list
+#define free_list_contains(l, h) (_free_list_lookup(l, h) != NULL)
+
+/// @brief Get the packed element array of a slot map, holding free_list_size(l) elements.
+/// @param l List pointer
+/// @return Void data pointer
+#define free_list_data(l) (void*)(_free_list_dense_pos(l, 0))
+
+/// @brief Get the handle of an element of the packed array of a slot map.
+/// @param l List pointer
+/// @param i Position in the packed array
+/// @return Element handle
+#define free_list_handle_at(l, i) _free_list_handle(_free_list_slot(l, _free_list_dense_slot(l, i))._generation, _free_list_dense_slot(l, i))
 
-/// @brief Remove all elements from the list.
+/// @brief Remove all elements from the list. Handles into a slot map all go stale.
 /// @param l List pointer
-#define free_list_clear(l) _free_list_remove(l, 0, (l)->_length)
+#define free_list_clear(l) _free_list_clear(l)
+
+/// @brief Move every element into a packed prefix, keeping their order, then give back the capacity that is no longer needed. Indices and
+/// @brief pointers to elements change, so the old to new index table lets callers fix up their references. Slot maps are already packed
+/// @brief and keep their slots so stale handles stay detectable, so they are left as is.
+/// @param l List pointer
+/// @param m Pointer to receive the remapping table with one entry per old index, SIZE_MAX for free ones (or NULL). Free with CC_FREE.
+/// @return True on success
+#define free_list_compact(l, m) _free_list_compact(&l, m)
 
 /// @brief Get the size of the list in memory.
 /// @param l List pointer
-/// @return Numberr of bytes
-#define free_list_bytes(l) ((l) ? (offsetof(free_list_t, _buffer) + _free_list_buffer_size((l)->_element_size, (l)->_capacity)) : 0)
+/// @return Number of bytes
+#define free_list_bytes(l) _free_list_bytes(l)
 
-/// @brief Create an iterator for the list.
+/// @brief Create an iterator for the list. Slot maps are walked in packed order.
 /// @param l List pointer
 /// @return Iterator pointer
 #define free_list_it(l) _free_list_it(l)
@@ -69,12 +147,27 @@
 /// @param i Iterator pointer
 #define free_list_it_next(i) _free_list_it_next(i)
 
+/// @brief Slot map entry, holding the packed position of a live element or the next free slot. The generation is odd while live.
+typedef struct {
+	uint32_t _generation;
+	uint32_t _index;
+} _free_list_slot_t;
+
+/// @brief Fixed-size page of a paged list with its own occupancy bitmap.
+typedef struct {
+	size_t _length;
+	uint64_t _bits[FREE_LIST_PAGE_SIZE / 64];
+	_Alignas(max_align_t) uint8_t _buffer[];
+} _free_list_page_t;
+
 /** Space-efficient list of elements. */
 typedef struct {
 	size_t _length;
 	size_t _capacity;
 	size_t _element_size;
 	size_t _next_free;
+	size_t _flags;
+	size_t _page_capacity;
 	uint8_t _buffer[];
 } free_list_t;
 
@@ -82,20 +175,43 @@ typedef struct {
 	free_list_t* _list;
 	void* data;
 	size_t index;
+	free_list_handle_t handle;
 } free_list_it_t;
 
-size_t _free_list_buffer_size(size_t, size_t);
+size_t _free_list_buffer_size(size_t, size_t, size_t);
+
+free_list_t* _free_list_factory(size_t, size_t, size_t);
 
-free_list_t* _free_list_factory(size_t, size_t);
+void _free_list_destroy(free_list_t*);
 
 free_list_t* _free_list_resize(free_list_t*, size_t);
 
+free_list_t* _free_list_add_pages(free_list_t*, size_t);
+
+size_t _free_list_page_scan(free_list_t*, size_t, bool);
+
+void* _free_list_get(free_list_t*, size_t);
+
 void* _free_list_insert(free_list_t**, size_t*, void*);
 
 void _free_list_remove(free_list_t*, size_t, size_t);
 
+free_list_handle_t _free_list_insert_handle(free_list_t**, void*);
+
+_free_list_slot_t* _free_list_lookup(free_list_t*, free_list_handle_t);
+
+void* _free_list_get_handle(free_list_t*, free_list_handle_t);
+
+bool _free_list_remove_handle(free_list_t*, free_list_handle_t);
+
+void _free_list_clear(free_list_t*);
+
+bool _free_list_compact(free_list_t**, size_t**);
+
+size_t _free_list_bytes(free_list_t*);
+
 free_list_it_t* _free_list_it(free_list_t*);
 
 free_list_it_t* _free_list_it_next(free_list_it_t*);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,129 @@
+/**
+ * multi_queue.h
+ * Relaxed concurrent priority queue spread over several locked binary heaps.
+*/
+#ifndef CC_STD_MULTI_QUEUE_H
+#define CC_STD_MULTI_QUEUE_H
+#include "cc/common.h"
+#include "cc/priority_queue.h"
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#ifndef MULTI_QUEUE_CACHE_LINE
+#define MULTI_QUEUE_CACHE_LINE 64ULL
+#endif
+#ifndef MULTI_QUEUE_SHARDS_PER_THREAD
+#define MULTI_QUEUE_SHARDS_PER_THREAD 2ULL
+#endif
+
+/// @brief Create a new multi-queue with int32 priorities, highest value popped first, sized for the given number of threads.
+/// @param t Multi-queue type
+/// @param n Number of threads sharing the queue
+/// @return Multi-queue pointer
+#define multi_queue_create(t, n) _multi_queue_factory(sizeof(t), sizeof(priority_queue_value_t), (n) * MULTI_QUEUE_SHARDS_PER_THREAD, PRIORITY_QUEUE_KEY_I32, NULL)
+
+/// @brief Create a new multi-queue with a built-in key type. Keys are passed by pointer to the _key functions.
+/// @param t Multi-queue type
+/// @param k Key type (PRIORITY_QUEUE_KEY_I32, PRIORITY_QUEUE_KEY_I64, PRIORITY_QUEUE_KEY_U64 or PRIORITY_QUEUE_KEY_F64)
+/// @param f Queue flags (PRIORITY_QUEUE_FLAG_MIN for lowest key first)
+/// @param n Number of threads sharing the queue
+/// @return Multi-queue pointer
+#define multi_queue_create_key(t, k, f, n) _multi_queue_factory(sizeof(t), _priority_queue_key_size(k), (n) * MULTI_QUEUE_SHARDS_PER_THREAD, (k) | (f), NULL)
+
+/// @brief Create a new multi-queue with keys of any size, ordered by a comparison function.
+/// @param t Multi-queue type
+/// @param s Key size in bytes
+/// @param c Key comparison function
+/// @param f Queue flags (PRIORITY_QUEUE_FLAG_MIN for lowest key first)
+/// @param n Number of threads sharing the queue
+/// @return Multi-queue pointer
+#define multi_queue_create_custom(t, s, c, f, n) _multi_queue_factory(sizeof(t), s, (n) * MULTI_QUEUE_SHARDS_PER_THREAD, PRIORITY_QUEUE_KEY_CUSTOM | (f), c)
+
+/// @brief Deallocate a multi-queue. No other thread may be using it.
+/// @param q Multi-queue pointer
+#define multi_queue_destroy(q) _multi_queue_destroy(q)
+
+/// @brief Add an element to an int32 multi-queue. Safe to call from any thread.
+/// @param q Multi-queue pointer
+/// @param v Priority value
+/// @param d Data pointer
+/// @return True on success
+#define multi_queue_push(q, v, d) _multi_queue_insert(q, &(priority_queue_value_t){ v }, (void*)(d))
+
+/// @brief Add an element to the multi-queue. Safe to call from any thread.
+/// @param q Multi-queue pointer
+/// @param k Key pointer
+/// @param d Data pointer
+/// @return True on success
+#define multi_queue_push_key(q, k, d) _multi_queue_insert(q, (const void*)(k), (void*)(d))
+
+/// @brief Remove an element close to the top of the multi-queue & copy it out. The better of two random heap tops is taken, so the element is
+/// @brief not always the global best, but its expected rank is bounded by the number of heaps. Safe to call from any thread.
+/// @param q Multi-queue pointer
+/// @param k Key output pointer (or NULL)
+/// @param d Data output pointer (or NULL)
+/// @return True if an element was removed, false if the queue was empty
+#define multi_queue_pop(q, k, d) _multi_queue_remove(q, (void*)(k), (void*)(d))
+
+/// @brief Get the number of elements in the multi-queue. The count is only a snapshot while other threads are pushing or popping.
+/// @param q Multi-queue pointer
+/// @return Number of elements
+#define multi_queue_size(q) atomic_load_explicit(&(q)->_length, memory_order_relaxed)
+
+/// @brief Get the number of heaps the multi-queue is spread over.
+/// @param q Multi-queue pointer
+/// @return Number of heaps
+#define multi_queue_shards(q) ((q)->_count)
+
+/// @brief Remove all elements in the multi-queue.
+/// @param q Multi-queue pointer
+#define multi_queue_clear(q) _multi_queue_clear(q)
+
+/// @brief Get the size of the multi-queue in memory. No other thread may be using it.
+/// @param q Multi-queue pointer
+/// @return Number of bytes
+#define multi_queue_bytes(q) _multi_queue_bytes(q)
+
+/// @brief One heap of a multi-queue, aligned to its own cache line so neighbouring locks do not share one.
+typedef struct {
+	_Alignas(MULTI_QUEUE_CACHE_LINE) atomic_flag _lock;
+	atomic_size_t _length;
+	priority_queue_t* _qu;
+} _multi_queue_shard_t;
+
+_Static_assert(sizeof(_multi_queue_shard_t) == MULTI_QUEUE_CACHE_LINE, "multi-queue shards must fill exactly one cache line");
+
+/// @brief Relaxed concurrent priority queue of elements spread over several heaps. The block is allocated with slack so the shards start on
+/// @brief a cache line boundary.
+typedef struct {
+	void* _block;
+	size_t _count;
+	size_t _element_size;
+	size_t _value_size;
+	atomic_size_t _length;
+	_multi_queue_shard_t _shards[];
+} multi_queue_t;
+
+multi_queue_t* _multi_queue_factory(size_t, size_t, size_t, size_t, priority_queue_compare_t);
+
+void _multi_queue_destroy(multi_queue_t*);
+
+size_t _multi_queue_random(size_t);
+
+bool _multi_queue_try_lock(_multi_queue_shard_t*);
+
+void _multi_queue_lock(_multi_queue_shard_t*);
+
+void _multi_queue_unlock(_multi_queue_shard_t*);
+
+bool _multi_queue_insert(multi_queue_t*, const void*, void*);
+
+void _multi_queue_pop_shard(multi_queue_t*, _multi_queue_shard_t*, void*, void*);
+
+bool _multi_queue_remove(multi_queue_t*, void*, void*);
+
+void _multi_queue_clear(multi_queue_t*);
+
+size_t _multi_queue_bytes(multi_queue_t*);
+
+#endif	// CC_STD_MULTI_QUEUE_H
@@ -0,0 +1,123 @@
+/**
+ * object_pool.h
+ * Thread-caching pool of fixed-size objects carved from a paged free list.
+*/
+#ifndef CC_STD_OBJECT_POOL_H
+#define CC_STD_OBJECT_POOL_H
+#include "cc/common.h"
+#include "cc/free_list.h"
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <threads.h>
+
+#ifndef OBJECT_POOL_CACHE_SIZE
+#define OBJECT_POOL_CACHE_SIZE 64ULL
+#endif
+#ifndef OBJECT_POOL_BATCH_SIZE
+#define OBJECT_POOL_BATCH_SIZE 32ULL
+#endif
+
+#define _object_pool_align(n) (((n) + (_Alignof(max_align_t) - 1)) & ~(_Alignof(max_align_t) - 1))
+#define _object_pool_header_size _object_pool_align(sizeof(_object_pool_block_t))
+#define _object_pool_object(b) (void*)((uint8_t*)(b) + _object_pool_header_size)
+#define _object_pool_block(o) (_object_pool_block_t*)((uint8_t*)(o) - _object_pool_header_size)
+
+/// @brief Create a new object pool. Each pool takes one thread-specific storage key.
+/// @param t Object type
+/// @return Object pool pointer
+#define object_pool_create(t) _object_pool_factory(sizeof(t))
+
+/// @brief Deallocate an object pool & every object in it. No other thread may be using it.
+/// @param p Object pool pointer
+#define object_pool_destroy(p) _object_pool_destroy(p)
+
+/// @brief Allocate an uninitialized object, served from the calling thread's cache when possible. Safe to call from any thread.
+/// @param p Object pool pointer
+/// @return Object pointer, or NULL on failure
+#define object_pool_alloc(p) _object_pool_alloc(p)
+
+/// @brief Return an object to the pool. Objects freed by the thread that allocated them go straight back into its cache, others are handed
+/// @brief back to the owning cache without taking a lock. Safe to call from any thread.
+/// @param p Object pool pointer
+/// @param o Object pointer
+#define object_pool_free(p, o) _object_pool_free(p, o)
+
+/// @brief Hand every object cached by the calling thread back to the shared pool.
+/// @param p Object pool pointer
+#define object_pool_flush(p) _object_pool_flush(p)
+
+/// @brief Get counters summed over every thread that has used the pool. The numbers are only a snapshot while other threads are using it.
+/// @param p Object pool pointer
+/// @param s Stats pointer
+#define object_pool_stats(p, s) _object_pool_stats(p, s, false)
+
+/// @brief Get counters for the calling thread's cache. Live, cached & capacity still cover the whole pool.
+/// @param p Object pool pointer
+/// @param s Stats pointer
+#define object_pool_thread_stats(p, s) _object_pool_stats(p, s, true)
+
+/// @brief Header in front of every object, linking it into a cache's remote free stack.
+typedef struct _object_pool_block_t {
+	struct _object_pool_cache_t* _owner;
+	struct _object_pool_block_t* _next;
+	size_t _index;
+} _object_pool_block_t;
+
+/// @brief Per-thread stash of free objects. Caches outlive their threads & are handed to new threads, so remote frees never dangle.
+typedef struct _object_pool_cache_t {
+	_Atomic(_object_pool_block_t*) _remote;
+	struct _object_pool_cache_t* _next;
+	void* _pool;
+	size_t _count;
+	bool _abandoned;
+	atomic_size_t _allocs;
+	atomic_size_t _hits;
+	atomic_size_t _frees;
+	atomic_size_t _remote_frees;
+	_object_pool_block_t* _blocks[OBJECT_POOL_CACHE_SIZE];
+} _object_pool_cache_t;
+
+/// @brief Pool usage counters.
+typedef struct {
+	size_t allocs;
+	size_t hits;
+	size_t frees;
+	size_t remote_frees;
+	size_t live;
+	size_t cached;
+	size_t capacity;
+	double hit_rate;
+	double fragmentation;
+} object_pool_stats_t;
+
+/// @brief Pool of fixed-size objects with per-thread caches in front of a shared paged free list.
+typedef struct {
+	size_t _element_size;
+	mtx_t _lock;
+	tss_t _key;
+	_object_pool_cache_t* _caches;
+	object_pool_stats_t _retired;
+	free_list_t* _list;
+} object_pool_t;
+
+object_pool_t* _object_pool_factory(size_t);
+
+void _object_pool_destroy(object_pool_t*);
+
+_object_pool_cache_t* _object_pool_cache(object_pool_t*);
+
+void _object_pool_release(object_pool_t*, _object_pool_block_t*);
+
+void _object_pool_thread_exit(void*);
+
+bool _object_pool_refill(object_pool_t*, _object_pool_cache_t*);
+
+void* _object_pool_alloc(object_pool_t*);
+
+void _object_pool_free(object_pool_t*, void*);
+
+void _object_pool_flush(object_pool_t*);
+
+void _object_pool_stats(object_pool_t*, object_pool_stats_t*, bool);
+
+#endif	// CC_STD_OBJECT_POOL_H
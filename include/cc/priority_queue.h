@@ -1,6 +1,6 @@
 /**
  * priority_queue.h
- * Sorted queue of value-data pairs.
+ * Binary heap of value-data pairs, optionally addressable through stable handles.
 */
 #ifndef CC_STD_PRIORITY_QUEUE_H
 #define CC_STD_PRIORITY_QUEUE_H
@@ -9,6 +9,11 @@
 
 typedef int32_t priority_queue_value_t;
 
+typedef uint64_t priority_queue_handle_t;
+
+/// @brief Function comparing two priority keys, returning a negative number, zero or a positive number if the first is lower, equal or higher.
+typedef int (*priority_queue_compare_t)(const void*, const void*);
+
 #ifndef PRIORITY_QUEUE_DEFAULT_CAPACITY
 #define PRIORITY_QUEUE_DEFAULT_CAPACITY 8ULL
 #endif
@@ -16,14 +21,101 @@ typedef int32_t priority_queue_value_t;
 #define PRIORITY_QUEUE_MAX_CAPACITY SIZE_MAX - 1
 #endif
 
-#define _priority_queue_value_pos(q, i) &(q)->_buffer[0] + ((i) * sizeof(priority_queue_value_t))
-#define _priority_queue_data_pos(q, i) &(q)->_buffer[0] + ((q)->_capacity * sizeof(priority_queue_value_t)) + ((i) * (q)->_element_size)
+#define PRIORITY_QUEUE_FLAG_INDEXED 0x01
+#define PRIORITY_QUEUE_FLAG_MIN 0x02
+#define PRIORITY_QUEUE_FLAG_BOUNDED 0x04
+#define PRIORITY_QUEUE_INVALID_HANDLE UINT64_MAX
+#define _PRIORITY_QUEUE_MAX_SLOTS UINT32_MAX
+
+#define PRIORITY_QUEUE_KEY_I32 0x00
+#define PRIORITY_QUEUE_KEY_I64 0x10
+#define PRIORITY_QUEUE_KEY_U64 0x20
+#define PRIORITY_QUEUE_KEY_F64 0x30
+#define PRIORITY_QUEUE_KEY_CUSTOM 0x40
+#define _PRIORITY_QUEUE_KEY_MASK 0x70
+
+#define _priority_queue_key_type(q) ((q)->_flags & _PRIORITY_QUEUE_KEY_MASK)
+#define _priority_queue_key_size(k) (((k) == PRIORITY_QUEUE_KEY_I32) ? sizeof(int32_t) : sizeof(int64_t))
+#define _priority_queue_index_size(f, c) (((f) & PRIORITY_QUEUE_FLAG_INDEXED) ? 3 * (c) * sizeof(size_t) : 0)
+#define _priority_queue_heap_handle(q, i) ((size_t*)&(q)->_buffer[0])[i]
+#define _priority_queue_handle_index(q, h) ((size_t*)&(q)->_buffer[0])[(q)->_capacity + (h)]
+#define _priority_queue_generation(q, h) ((size_t*)&(q)->_buffer[0])[2 * (q)->_capacity + (h)]
+#define _priority_queue_handle(g, s) (((uint64_t)(uint32_t)(g) << 32) | (uint64_t)(s))
+#define _priority_queue_handle_slot(h) ((size_t)((h) & UINT32_MAX))
+#define _priority_queue_slot_handle(q, s) _priority_queue_handle(_priority_queue_generation(q, s), s)
+#define _priority_queue_value_pos(q, i) &(q)->_buffer[0] + _priority_queue_index_size((q)->_flags, (q)->_capacity) + ((i) * (q)->_value_size)
+#define _priority_queue_data_pos(q, i) &(q)->_buffer[0] + _priority_queue_index_size((q)->_flags, (q)->_capacity) + ((q)->_capacity * (q)->_value_size) + ((i) * (q)->_element_size)
 #define _priority_queue_value(q, i) *(priority_queue_value_t*)(_priority_queue_value_pos(q, i))
 
-/// @brief Create a new priority queue.
+/// @brief Create a new priority queue with int32 priorities, highest value at the top.
+/// @param t Priority queue type
+/// @return Priority queue pointer
+#define priority_queue_create(t) _priority_queue_factory(sizeof(t), sizeof(priority_queue_value_t), PRIORITY_QUEUE_DEFAULT_CAPACITY, PRIORITY_QUEUE_KEY_I32, NULL)
+
+/// @brief Create a new priority queue whose elements can be addressed by the handles returned from priority_queue_push_handle.
+/// @param t Priority queue type
+/// @return Priority queue pointer
+#define priority_queue_create_indexed(t) _priority_queue_factory(sizeof(t), sizeof(priority_queue_value_t), PRIORITY_QUEUE_DEFAULT_CAPACITY, PRIORITY_QUEUE_KEY_I32 | PRIORITY_QUEUE_FLAG_INDEXED, NULL)
+
+/// @brief Create a new priority queue with a built-in key type. Keys are passed by pointer to the _key functions.
+/// @param t Priority queue type
+/// @param k Key type (PRIORITY_QUEUE_KEY_I32, PRIORITY_QUEUE_KEY_I64, PRIORITY_QUEUE_KEY_U64 or PRIORITY_QUEUE_KEY_F64)
+/// @param f Queue flags (PRIORITY_QUEUE_FLAG_MIN for lowest key at the top, PRIORITY_QUEUE_FLAG_INDEXED for handles)
+/// @return Priority queue pointer
+#define priority_queue_create_key(t, k, f) _priority_queue_factory(sizeof(t), _priority_queue_key_size(k), PRIORITY_QUEUE_DEFAULT_CAPACITY, (k) | (f), NULL)
+
+/// @brief Create a new priority queue with keys of any size, ordered by a comparison function.
+/// @param t Priority queue type
+/// @param s Key size in bytes
+/// @param c Key comparison function
+/// @param f Queue flags (PRIORITY_QUEUE_FLAG_MIN for lowest key at the top, PRIORITY_QUEUE_FLAG_INDEXED for handles)
+/// @return Priority queue pointer
+#define priority_queue_create_custom(t, s, c, f) _priority_queue_factory(sizeof(t), s, PRIORITY_QUEUE_DEFAULT_CAPACITY, PRIORITY_QUEUE_KEY_CUSTOM | (f), c)
+
+/// @brief Create a new int32 priority queue that only keeps the k highest values. The top of a bounded queue is the worst element kept, and
+/// @brief a push that would not beat it is rejected in constant time.
+/// @param t Priority queue type
+/// @param k Maximum number of elements
+/// @return Priority queue pointer
+#define priority_queue_create_bounded(t, k) _priority_queue_bounded(priority_queue_create(t), k)
+
+/// @brief Create a new priority queue with a built-in key type that only keeps the best k elements.
+/// @param t Priority queue type
+/// @param kt Key type
+/// @param f Queue flags (PRIORITY_QUEUE_FLAG_MIN keeps the lowest keys)
+/// @param k Maximum number of elements
+/// @return Priority queue pointer
+#define priority_queue_create_bounded_key(t, kt, f, k) _priority_queue_bounded(priority_queue_create_key(t, kt, f), k)
+
+/// @brief Create a new int32 priority queue from parallel arrays of values & data in linear time.
+/// @param t Priority queue type
+/// @param v Value array
+/// @param d Data array
+/// @param n Number of elements
+/// @return Priority queue pointer
+#define priority_queue_from_arrays(t, v, d, n) _priority_queue_from_arrays(sizeof(t), sizeof(priority_queue_value_t), PRIORITY_QUEUE_KEY_I32, NULL, v, d, n)
+
+/// @brief Create a new priority queue with a built-in key type from parallel arrays of keys & data in linear time. In indexed queues
+/// @brief element i of the arrays gets handle i.
+/// @param t Priority queue type
+/// @param k Key type
+/// @param f Queue flags
+/// @param v Key array
+/// @param d Data array
+/// @param n Number of elements
+/// @return Priority queue pointer
+#define priority_queue_from_arrays_key(t, k, f, v, d, n) _priority_queue_from_arrays(sizeof(t), _priority_queue_key_size(k), (k) | (f), NULL, v, d, n)
+
+/// @brief Create a new priority queue with custom keys from parallel arrays of keys & data in linear time.
 /// @param t Priority queue type
+/// @param s Key size in bytes
+/// @param c Key comparison function
+/// @param f Queue flags
+/// @param v Key array
+/// @param d Data array
+/// @param n Number of elements
 /// @return Priority queue pointer
-#define priority_queue_create(t) _priority_queue_factory(sizeof(t), PRIORITY_QUEUE_DEFAULT_CAPACITY)
+#define priority_queue_from_arrays_custom(t, s, c, f, v, d, n) _priority_queue_from_arrays(sizeof(t), s, PRIORITY_QUEUE_KEY_CUSTOM | (f), c, v, d, n)
 
 /// @brief Deallocate a priority queue.
 /// @param q Priority queue pointer
@@ -33,30 +125,132 @@ typedef int32_t priority_queue_value_t;
 /// @param q Priority queue pointer
 /// @param t Priority queue type
 /// @return Void data pointer, or NULL if empty
-#define priority_queue_top_data(q) (void*)((q)->_length > 0 ? _priority_queue_data_pos(q, (q)->_length - 1) : NULL)
+#define priority_queue_top_data(q) (void*)((q)->_length > 0 ? _priority_queue_data_pos(q, 0) : NULL)
 
-/// @brief Get the value of the top element in the priority queue.
+/// @brief Get the value of the top element in an int32 priority queue.
 /// @param q Priority queue pointer
 /// @return Value pointer, or NULL if empty
-#define priority_queue_top_value(q) (priority_queue_value_t*)((q)->_length > 0 ? _priority_queue_value_pos(q, (q)->_length - 1) : NULL)
+#define priority_queue_top_value(q) (priority_queue_value_t*)((q)->_length > 0 ? _priority_queue_value_pos(q, 0) : NULL)
 
-/// @brief Add an element to the priority queue.
+/// @brief Get the key of the top element in the priority queue.
+/// @param q Priority queue pointer
+/// @return Void key pointer, or NULL if empty
+#define priority_queue_top_key(q) (void*)((q)->_length > 0 ? _priority_queue_value_pos(q, 0) : NULL)
+
+/// @brief Get the handle of the top element in an indexed priority queue.
+/// @param q Priority queue pointer
+/// @return Element handle, or PRIORITY_QUEUE_INVALID_HANDLE if empty
+#define priority_queue_top_handle(q) (((q)->_length > 0 && ((q)->_flags & PRIORITY_QUEUE_FLAG_INDEXED)) ? _priority_queue_slot_handle(q, _priority_queue_heap_handle(q, 0)) : PRIORITY_QUEUE_INVALID_HANDLE)
+
+/// @brief Add an element to an int32 priority queue.
 /// @param q Priority queue pointer
 /// @param v Priority value
 /// @param d Data pointer
 /// @return Void data pointer to inserted element, or NULL on failure
-#define priority_queue_push(q, v, d) _priority_queue_insert(&q, v, (void*)d)
+#define priority_queue_push(q, v, d) _priority_queue_insert(&q, &(priority_queue_value_t){ v }, (void*)(d))
+
+/// @brief Add an element to the priority queue.
+/// @param q Priority queue pointer
+/// @param k Key pointer
+/// @param d Data pointer
+/// @return Void data pointer to inserted element, or NULL on failure
+#define priority_queue_push_key(q, k, d) _priority_queue_insert(&q, (const void*)(k), (void*)(d))
+
+/// @brief Add a batch of elements to the priority queue, restoring heap order once at the end.
+/// @param q Priority queue pointer
+/// @param k Key array (priority values for int32 queues)
+/// @param d Data array
+/// @param n Number of elements
+/// @return True on success
+#define priority_queue_push_n(q, k, d, n) _priority_queue_insert_n(&q, (const void*)(k), (const void*)(d), n)
+
+/// @brief Move copies of every element of one priority queue into another. Both queues must use the same element size, key type and order.
+/// @brief Elements added to an indexed queue get new handles.
+/// @param a Destination priority queue pointer
+/// @param b Source priority queue pointer (left unchanged, must differ from the destination)
+/// @return True on success
+#define priority_queue_merge(a, b) _priority_queue_merge(&a, b)
+
+/// @brief Add an element to an indexed int32 priority queue and get a handle to it. The handle stays valid until the element is removed,
+/// @brief after which it goes stale and is rejected even once its slot is reused.
+/// @param q Priority queue pointer
+/// @param v Priority value
+/// @param d Data pointer
+/// @return Element handle, or PRIORITY_QUEUE_INVALID_HANDLE on failure
+#define priority_queue_push_handle(q, v, d) _priority_queue_insert_handle(&q, &(priority_queue_value_t){ v }, (void*)(d))
+
+/// @brief Add an element to an indexed priority queue and get a handle to it.
+/// @param q Priority queue pointer
+/// @param k Key pointer
+/// @param d Data pointer
+/// @return Element handle, or PRIORITY_QUEUE_INVALID_HANDLE on failure
+#define priority_queue_push_key_handle(q, k, d) _priority_queue_insert_handle(&q, (const void*)(k), (void*)(d))
+
+/// @brief Change the priority of an element in an indexed int32 priority queue.
+/// @param q Priority queue pointer
+/// @param h Element handle
+/// @param v New priority value
+#define priority_queue_update(q, h, v) _priority_queue_update(q, h, &(priority_queue_value_t){ v })
+
+/// @brief Change the key of an element in an indexed priority queue.
+/// @param q Priority queue pointer
+/// @param h Element handle
+/// @param k New key pointer
+#define priority_queue_update_key(q, h, k) _priority_queue_update(q, h, (const void*)(k))
+
+/// @brief Remove an element from an indexed priority queue.
+/// @param q Priority queue pointer
+/// @param h Element handle
+#define priority_queue_remove_handle(q, h) _priority_queue_remove_handle(q, h)
+
+/// @brief Get the data of an element in an indexed priority queue.
+/// @param q Priority queue pointer
+/// @param h Element handle
+/// @return Void data pointer, or NULL if the handle is not in the queue
+#define priority_queue_get(q, h) _priority_queue_get(q, h)
+
+/// @brief Get the priority value of an element in an indexed int32 priority queue.
+/// @param q Priority queue pointer
+/// @param h Element handle
+/// @return Value pointer, or NULL if the handle is not in the queue
+#define priority_queue_get_value(q, h) (priority_queue_value_t*)(_priority_queue_contains(q, h) ? _priority_queue_value_pos(q, _priority_queue_handle_index(q, _priority_queue_handle_slot(h))) : NULL)
+
+/// @brief Get the key of an element in an indexed priority queue.
+/// @param q Priority queue pointer
+/// @param h Element handle
+/// @return Void key pointer, or NULL if the handle is not in the queue
+#define priority_queue_get_key(q, h) (void*)(_priority_queue_contains(q, h) ? _priority_queue_value_pos(q, _priority_queue_handle_index(q, _priority_queue_handle_slot(h))) : NULL)
+
+/// @brief Check if a handle refers to an element in an indexed priority queue.
+/// @param q Priority queue pointer
+/// @param h Element handle
+/// @return True if the element is in the queue
+#define priority_queue_contains(q, h) _priority_queue_contains(q, h)
 
 /// @brief Remove the top element from the priority queue.
 /// @param q Priority queue pointer
 #define priority_queue_pop(q) _priority_queue_remove(q, 1)
 
-/// @brief Remove an element with the given value from the priority queue. If the provided data is NULL, find the first element matching the given
-/// @brief priority value. Otherwise, find the element which matches the given data exactly.
+/// @brief Remove every element from the priority queue, writing them best first into caller buffers. Bounded queues are emitted
+/// @brief best first as well, even though their top is the worst element.
+/// @param q Priority queue pointer
+/// @param k Key output array with room for every element (or NULL)
+/// @param d Data output array with room for every element (or NULL)
+/// @return Number of elements drained
+#define priority_queue_drain_sorted(q, k, d) _priority_queue_drain(q, (void*)(k), (void*)(d))
+
+/// @brief Remove an element with the given value from an int32 priority queue. If the provided data is NULL, find the first element matching the
+/// @brief given priority value. Otherwise, find the element which matches the given data exactly.
 /// @param q Priority queue pointer
 /// @param v Priority value
 /// @param d Data pointer
-#define priority_queue_remove(q, v, d) _priority_queue_remove_value(q, v, d);
+#define priority_queue_remove(q, v, d) _priority_queue_remove_value(q, &(priority_queue_value_t){ v }, d)
+
+/// @brief Remove an element with the given key from the priority queue, matching the data too if it is not NULL.
+/// @param q Priority queue pointer
+/// @param k Key pointer
+/// @param d Data pointer
+#define priority_queue_remove_key(q, k, d) _priority_queue_remove_value(q, (const void*)(k), d)
 
 /// @brief Get the number of elements in the priority queue.
 /// @param q Priority queue pointer
@@ -70,17 +264,24 @@ typedef int32_t priority_queue_value_t;
 /// @brief Get the size of the priority queue in memory.
 /// @param q Priority queue pointer
 /// @return Number of bytes
-#define priority_queue_bytes(q) ((q) ? (_priority_queue_size((q)->_element_size, (q)->_capacity)) : 0)
+#define priority_queue_bytes(q) ((q) ? (_priority_queue_size((q)->_element_size, (q)->_value_size, (q)->_capacity, (q)->_flags)) : 0)
 
-/// @brief Find the data in the priority queue if it exists. If the provided data is NULL, find the first element matching the given priority
+/// @brief Find the data in an int32 priority queue if it exists. If the provided data is NULL, find the first element matching the given priority
 /// @brief value. Otherwise, find the element which matches the given data exactly.
 /// @param q Priority queue pointer
 /// @param v Priority value
 /// @param d Data pointer (optional)
 /// @return Data pointer, or NULL if not found
-#define priority_queue_find(q, v, d) _priority_queue_find(q, v, d)
+#define priority_queue_find(q, v, d) _priority_queue_find(q, &(priority_queue_value_t){ v }, d)
 
-/// @brief Create an iterator for the priority queue, starting at the beginning.
+/// @brief Find the data with the given key in the priority queue if it exists, matching the data too if it is not NULL.
+/// @param q Priority queue pointer
+/// @param k Key pointer
+/// @param d Data pointer (optional)
+/// @return Data pointer, or NULL if not found
+#define priority_queue_find_key(q, k, d) _priority_queue_find(q, (const void*)(k), d)
+
+/// @brief Create an iterator for the priority queue, starting at the top. Elements after the top are visited in heap order.
 /// @param q Priority queue pointer
 /// @return Iterator pointer
 #define priority_queue_it_begin(q) _priority_queue_it(q, true)
@@ -94,7 +295,13 @@ typedef int32_t priority_queue_value_t;
 /// @param q Priority queue pointer
 /// @param v Priority value
 /// @return Iterator pointer
-#define priority_queue_it_value(q, v) _priority_queue_it_value(q, v)
+#define priority_queue_it_value(q, v) _priority_queue_it_value(q, &(priority_queue_value_t){ v })
+
+/// @brief Create an iterator for the priority queue starting at the given key.
+/// @param q Priority queue pointer
+/// @param k Key pointer
+/// @return Iterator pointer
+#define priority_queue_it_key(q, k) _priority_queue_it_value(q, (const void*)(k))
 
 /// @brief Move the iterator to the next element.
 /// @param i Iterator pointer
@@ -104,43 +311,82 @@ typedef int32_t priority_queue_value_t;
 /// @param i Iterator pointer
 #define priority_queue_it_prev(i) _priority_queue_it_prev(i)
 
-/// @brief List of elements sorted by priority.
+/// @brief Binary heap of elements ordered by priority.
 typedef struct {
 	size_t _length;
 	size_t _capacity;
 	size_t _element_size;
+	size_t _value_size;
+	size_t _flags;
+	size_t _bound;
+	priority_queue_compare_t _compare;
 	uint8_t _buffer[];
 } priority_queue_t;
 
-/// @brief Iterator for a priority queue.
+/// @brief Iterator for a priority queue. The value is only filled in for int32 keys.
 typedef struct {
 	priority_queue_t* _qu;
 	void* data;
+	void* key;
 	size_t _index;
 	priority_queue_value_t value;
 } priority_queue_it_t;
 
-size_t _priority_queue_size(size_t, size_t);
+size_t _priority_queue_size(size_t, size_t, size_t, size_t);
 
-priority_queue_t* _priority_queue_factory(size_t, size_t);
+priority_queue_t* _priority_queue_factory(size_t, size_t, size_t, size_t, priority_queue_compare_t);
 
 priority_queue_t* _priority_queue_resize(priority_queue_t*, size_t);
 
-void* _priority_queue_insert(priority_queue_t**, priority_queue_value_t, void*);
+bool _priority_queue_before(priority_queue_t*, const void*, const void*);
+
+priority_queue_t* _priority_queue_bounded(priority_queue_t*, size_t);
+
+priority_queue_t* _priority_queue_from_arrays(size_t, size_t, size_t, priority_queue_compare_t, const void*, const void*, size_t);
+
+void _priority_queue_copy(priority_queue_t*, size_t, size_t);
+
+size_t _priority_queue_sift_up(priority_queue_t*, size_t);
+
+size_t _priority_queue_sift_down(priority_queue_t*, size_t);
+
+void _priority_queue_heapify(priority_queue_t*);
+
+size_t _priority_queue_insert_index(priority_queue_t**, const void*, void*);
+
+void* _priority_queue_insert(priority_queue_t**, const void*, void*);
+
+priority_queue_handle_t _priority_queue_insert_handle(priority_queue_t**, const void*, void*);
+
+bool _priority_queue_insert_n(priority_queue_t**, const void*, const void*, size_t);
+
+bool _priority_queue_merge(priority_queue_t**, priority_queue_t*);
+
+void _priority_queue_remove_index(priority_queue_t*, size_t);
 
 void _priority_queue_remove(priority_queue_t*, size_t);
 
-void _priority_queue_remove_value(priority_queue_t*, priority_queue_value_t, void*);
+size_t _priority_queue_drain(priority_queue_t*, void*, void*);
+
+void _priority_queue_remove_value(priority_queue_t*, const void*, void*);
+
+bool _priority_queue_contains(priority_queue_t*, priority_queue_handle_t);
+
+void _priority_queue_update(priority_queue_t*, priority_queue_handle_t, const void*);
+
+void _priority_queue_remove_handle(priority_queue_t*, priority_queue_handle_t);
+
+void* _priority_queue_get(priority_queue_t*, priority_queue_handle_t);
 
-void _priority_queue_sort(priority_queue_t*);
+size_t _priority_queue_find_index(priority_queue_t*, const void*, void*);
 
-size_t _priority_queue_find_index(priority_queue_t*, priority_queue_value_t, void*);
+void* _priority_queue_find(priority_queue_t*, const void*, void*);
 
-void* _priority_queue_find(priority_queue_t*, priority_queue_value_t, void*);
+void _priority_queue_it_load(priority_queue_it_t*);
 
 priority_queue_it_t* _priority_queue_it(priority_queue_t*, bool);
 
-priority_queue_it_t* _priority_queue_it_value(priority_queue_t*, priority_queue_value_t);
+priority_queue_it_t* _priority_queue_it_value(priority_queue_t*, const void*);
 
 priority_queue_it_t* _priority_queue_it_next(priority_queue_it_t*);
 
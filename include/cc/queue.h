@@ -5,6 +5,7 @@
 #ifndef CC_STD_QUEUE_H
 #define CC_STD_QUEUE_H
 #include "cc/common.h"
+#include <stdbool.h>
 
 #ifndef QUEUE_DEFAULT_CAPACITY
 #define QUEUE_DEFAULT_CAPACITY 1ULL
@@ -29,16 +30,41 @@
 /// @return Void data pointer, or NULL if empty
 #define queue_head(q) (void*)((q)->_length > 0 ? _queue_pos(q, (q)->_head) : NULL)
 
+/// @brief Get an element of the queue by position.
+/// @param q Queue pointer
+/// @param i Index, counting from the front
+/// @return Void data pointer, or NULL if out of range
+#define queue_at(q, i) (void*)((i) < (q)->_length ? _queue_pos(q, ((q)->_head + (i)) % (q)->_capacity) : NULL)
+
+/// @brief Describe the elements from the front as at most two contiguous runs of the circular buffer, ready to hand to writev or memcpy.
+/// @param q Queue pointer
+/// @param s Span array with room for two spans
+/// @return Number of spans filled
+#define queue_spans(q, s) _queue_spans(q, s)
+
 /// @brief Add a new element to the back of the queue.
 /// @param q Queue pointer
 /// @param d Data pointer
 /// @return Void data pointer to inserted element, or NULL on failure
 #define queue_push(q, d) _queue_insert(&q, (void*)d)
 
+/// @brief Add n elements to the back of the queue at once, growing the queue at most once.
+/// @param q Queue pointer
+/// @param d Data pointer to an array of n elements
+/// @param n Number of elements
+/// @return True on success, false if nothing was added
+#define queue_push_n(q, d, n) _queue_insert_n(&q, (void*)(d), n)
+
 /// @brief Remove the element at the front of the queue.
 /// @param q Queue pointer
 #define queue_pop(q) _queue_remove(q, 1)
 
+/// @brief Remove up to n elements from the front of the queue at once.
+/// @param q Queue pointer
+/// @param n Number of elements
+/// @return Number of elements removed
+#define queue_pop_n(q, n) _queue_remove(q, n)
+
 /// @brief Get the number of elements in the queue.
 /// @param q Queue pointer
 /// @return Queue size
@@ -53,6 +79,12 @@
 /// @return Number of bytes
 #define queue_bytes(q) ((q) ? (_queue_size((q)->_element_size, (q)->_capacity)) : 0)
 
+/// @brief Contiguous run of queue elements.
+typedef struct {
+	void* data;
+	size_t count;
+} queue_span_t;
+
 /// @brief FIFO group of elements.
 typedef struct {
 	size_t _length;
@@ -71,6 +103,10 @@ queue_t* _queue_resize(queue_t*, size_t);
 
 void* _queue_insert(queue_t**, void*);
 
-void _queue_remove(queue_t*, size_t);
+bool _queue_insert_n(queue_t**, void*, size_t);
+
+size_t _queue_spans(queue_t*, queue_span_t*);
+
+size_t _queue_remove(queue_t*, size_t);
 
 #endif	// CC_STD_QUEUE_H
\ No newline at end of file
@@ -0,0 +1,90 @@
+/**
+ * radix_heap.h
+ * Monotone min-queue of value-data pairs bucketed by integer priority.
+*/
+#ifndef CC_STD_RADIX_HEAP_H
+#define CC_STD_RADIX_HEAP_H
+#include "cc/common.h"
+#include "cc/priority_queue.h"
+#include <stdbool.h>
+
+#ifndef RADIX_HEAP_BUCKET_DEFAULT_CAPACITY
+#define RADIX_HEAP_BUCKET_DEFAULT_CAPACITY 8ULL
+#endif
+
+#define RADIX_HEAP_NUM_BUCKETS 33
+
+#define _radix_heap_bucket(l, v) (((v) == (l)) ? 0 : 32 - CC_CLZ((uint32_t)(v) ^ (uint32_t)(l)))
+#define _radix_heap_data_pos(q, b, i) ((q)->_buckets[b]._data + ((i) * (q)->_element_size))
+
+/// @brief Create a new radix heap.
+/// @param t Radix heap type
+/// @return Radix heap pointer
+#define radix_heap_create(t) _radix_heap_factory(sizeof(t))
+
+/// @brief Deallocate a radix heap.
+/// @param q Radix heap pointer
+#define radix_heap_destroy(q) _radix_heap_destroy(q)
+
+/// @brief Get the top (lowest priority value) element in the radix heap.
+/// @param q Radix heap pointer
+/// @return Void data pointer, or NULL if empty
+#define radix_heap_top_data(q) (void*)((q)->_buckets[0]._length > 0 ? _radix_heap_data_pos(q, 0, (q)->_buckets[0]._length - 1) : NULL)
+
+/// @brief Get the value of the top element in the radix heap.
+/// @param q Radix heap pointer
+/// @return Value pointer, or NULL if empty
+#define radix_heap_top_value(q) (priority_queue_value_t*)((q)->_buckets[0]._length > 0 ? &(q)->_buckets[0]._keys[(q)->_buckets[0]._length - 1] : NULL)
+
+/// @brief Add an element to the radix heap. The value may not be lower than the last value popped from the heap, unless the heap is empty.
+/// @param q Radix heap pointer
+/// @param v Priority value
+/// @param d Data pointer
+/// @return Void data pointer to inserted element, or NULL on failure
+#define radix_heap_push(q, v, d) _radix_heap_insert(q, v, (void*)(d))
+
+/// @brief Remove the top element from the radix heap. If the next minimum cannot be moved to the top the heap is left unchanged.
+/// @param q Radix heap pointer
+/// @return True on success, false if the heap is empty or allocation failed
+#define radix_heap_pop(q) _radix_heap_remove(q)
+
+/// @brief Get the number of elements in the radix heap.
+/// @param q Radix heap pointer
+/// @return Number of elements
+#define radix_heap_size(q) ((q)->_length)
+
+/// @brief Remove all elements in the radix heap.
+/// @param q Radix heap pointer
+#define radix_heap_clear(q) _radix_heap_clear(q)
+
+/// @brief Growable run of elements sharing the same highest differing bit from the last popped value.
+typedef struct {
+	size_t _length;
+	size_t _capacity;
+	priority_queue_value_t* _keys;
+	uint8_t* _data;
+} _radix_heap_bucket_t;
+
+/// @brief Monotone min-queue of elements bucketed by integer priority.
+typedef struct {
+	size_t _length;
+	size_t _element_size;
+	priority_queue_value_t _last;
+	_radix_heap_bucket_t _buckets[RADIX_HEAP_NUM_BUCKETS];
+} radix_heap_t;
+
+radix_heap_t* _radix_heap_factory(size_t);
+
+void _radix_heap_destroy(radix_heap_t*);
+
+int _radix_heap_reserve(radix_heap_t*, size_t, size_t);
+
+void* _radix_heap_insert(radix_heap_t*, priority_queue_value_t, void*);
+
+bool _radix_heap_refill(radix_heap_t*);
+
+bool _radix_heap_remove(radix_heap_t*);
+
+void _radix_heap_clear(radix_heap_t*);
+
+#endif	// CC_STD_RADIX_HEAP_H
@@ -1,10 +1,11 @@
 /**
  * stack.h
- * LIFO group of elements.
+ * LIFO group of elements, either one growable buffer or a chain of fixed-size segments.
 */
 #ifndef CC_STD_STACK_H
 #define CC_STD_STACK_H
 #include "cc/common.h"
+#include <stdbool.h>
 
 #ifndef STACK_DEFAULT_CAPACITY
 #define STACK_DEFAULT_CAPACITY 1ULL
@@ -12,26 +13,39 @@
 #ifndef STACK_MAX_CAPACITY
 #define STACK_MAX_CAPACITY SIZE_MAX - 1
 #endif
+#ifndef STACK_SEGMENT_BYTES
+#define STACK_SEGMENT_BYTES 4096ULL
+#endif
+
+#define STACK_FLAG_SEGMENTED 0x01
 
 #define _stack_pos(s, i) &(s)->_buffer[0] + ((i) * (s)->_element_size)
+#define _stack_segment_pos(s, i) ((s)->_top->_buffer + (((i) % (s)->_segment_length) * (s)->_element_size))
+#define _stack_segment_size(s) (offsetof(_stack_segment_t, _buffer) + ((s)->_segment_length * (s)->_element_size))
 
 /// @brief Create a new stack.
 /// @param t Stack type
 /// @return Stack pointer
-#define stack_create(t) _stack_factory(sizeof(t), STACK_DEFAULT_CAPACITY)
+#define stack_create(t) _stack_factory(sizeof(t), STACK_DEFAULT_CAPACITY, 0)
+
+/// @brief Create a new stack made of linked fixed-size segments. Growing never copies, and pointers to elements stay valid until they are
+/// @brief popped, so with stack_mark & stack_rewind the stack also works as a scoped bump allocator.
+/// @param t Stack type
+/// @return Stack pointer
+#define stack_create_segmented(t) _stack_factory(sizeof(t), STACK_DEFAULT_CAPACITY, STACK_FLAG_SEGMENTED)
 
 /// @brief Deallocate a stack.
 /// @param s Stack pointer
-#define stack_destroy(s) CC_FREE(s)
+#define stack_destroy(s) _stack_destroy(s)
 
 /// @brief Get the top element of the stack.
 /// @param s Stack pointer
 /// @return Void data pointer, or NULL if empty
-#define stack_head(s) (void*)((s)->_length > 0 ? _stack_pos(s, (s)->_length - 1) : NULL)
+#define stack_head(s) (void*)((s)->_length == 0 ? NULL : ((s)->_flags & STACK_FLAG_SEGMENTED) ? _stack_segment_pos(s, (s)->_length - 1) : _stack_pos(s, (s)->_length - 1))
 
 /// @brief Add a new element to the top of the stack.
 /// @param s Stack pointer
-/// @param d Data pointer
+/// @param d Data pointer (or NULL to leave the element uninitialized)
 /// @return Void data pointer to inserted element, or NULL on failure
 #define stack_push(s, d) _stack_insert(&s, (void*)d)
 
@@ -39,6 +53,17 @@
 /// @param s Stack pointer
 #define stack_pop(s) _stack_remove(s, 1)
 
+/// @brief Save the current depth of the stack.
+/// @param s Stack pointer
+/// @return Mark to pass to stack_rewind
+#define stack_mark(s) ((s)->_length)
+
+/// @brief Pop every element pushed since the mark was taken in one step.
+/// @param s Stack pointer
+/// @param m Mark from stack_mark
+/// @return True on success, false if the stack is already below the mark
+#define stack_rewind(s, m) _stack_rewind(s, m)
+
 /// @brief Get the number of elements in the stack.
 /// @param s Stack pointer
 /// @return Stack size
@@ -51,19 +76,31 @@
 /// @brief Get the size of the stack in memory.
 /// @param s Stack pointer
 /// @return Number of bytes
-#define stack_bytes(s) ((s) ? (_stack_size((s)->_element_size, (s)->_capacity)) : 0)
+#define stack_bytes(s) _stack_bytes(s)
+
+/// @brief Fixed-size run of stack elements, linked to the one below it.
+typedef struct _stack_segment_t {
+	struct _stack_segment_t* _prev;
+	_Alignas(max_align_t) uint8_t _buffer[];
+} _stack_segment_t;
 
-/// @brief LIFO group of elements.
+/// @brief LIFO group of elements. Segmented stacks count their capacity in elements of the live segments.
 typedef struct {
 	size_t _length;
 	size_t _capacity;
 	size_t _element_size;
+	size_t _flags;
+	size_t _segment_length;
+	_stack_segment_t* _top;
+	_stack_segment_t* _spare;
 	uint8_t _buffer[];
 } stack_t;
 
-size_t _stack_size(size_t, size_t);
+size_t _stack_size(size_t, size_t, size_t);
 
-stack_t* _stack_factory(size_t, size_t);
+stack_t* _stack_factory(size_t, size_t, size_t);
+
+void _stack_destroy(stack_t*);
 
 stack_t* _stack_resize(stack_t*, size_t);
 
@@ -71,4 +108,8 @@ void* _stack_insert(stack_t**, void*);
 
 void _stack_remove(stack_t*, size_t);
 
+bool _stack_rewind(stack_t*, size_t);
+
+size_t _stack_bytes(stack_t*);
+
 #endif  // CC_STD_STACK_H
\ No newline at end of file
@@ -0,0 +1,164 @@
+/**
+ * timing_wheel.h
+ * Hierarchical timing wheel of deadline-data pairs.
+*/
+#ifndef CC_STD_TIMING_WHEEL_H
+#define CC_STD_TIMING_WHEEL_H
+#include "cc/common.h"
+#include <stdbool.h>
+
+typedef uint64_t timing_wheel_handle_t;
+
+#ifndef TIMING_WHEEL_DEFAULT_CAPACITY
+#define TIMING_WHEEL_DEFAULT_CAPACITY 64ULL
+#endif
+#ifndef TIMING_WHEEL_MAX_CAPACITY
+#define TIMING_WHEEL_MAX_CAPACITY (UINT32_MAX - 1ULL)
+#endif
+
+#define TIMING_WHEEL_BITS 8
+#define TIMING_WHEEL_LEVELS 4
+#define TIMING_WHEEL_SLOTS (1 << TIMING_WHEEL_BITS)
+#define TIMING_WHEEL_INVALID_HANDLE 0
+
+#define _TIMING_WHEEL_MASK (TIMING_WHEEL_SLOTS - 1)
+#define _TIMING_WHEEL_NIL UINT32_MAX
+#define _TIMING_WHEEL_READY (TIMING_WHEEL_LEVELS * TIMING_WHEEL_SLOTS)
+#define _TIMING_WHEEL_FREE (_TIMING_WHEEL_READY + 1)
+
+#define _timing_wheel_stride(e) ((sizeof(_timing_wheel_entry_t) + (e) + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1))
+#define _timing_wheel_entry(w, i) ((_timing_wheel_entry_t*)(&(w)->_buffer[0] + ((size_t)(i) * _timing_wheel_stride((w)->_element_size))))
+#define _timing_wheel_data_pos(w, i) ((uint8_t*)_timing_wheel_entry(w, i) + sizeof(_timing_wheel_entry_t))
+#define _timing_wheel_handle(g, i) (((uint64_t)(g) << 32) | (uint64_t)(i))
+
+/// @brief Create a new timing wheel starting at time 0.
+/// @param t Timing wheel type
+/// @return Timing wheel pointer
+#define timing_wheel_create(t) _timing_wheel_factory(sizeof(t), TIMING_WHEEL_DEFAULT_CAPACITY, 0)
+
+/// @brief Create a new timing wheel starting at the given time.
+/// @param t Timing wheel type
+/// @param n Current time in ticks
+/// @return Timing wheel pointer
+#define timing_wheel_create_at(t, n) _timing_wheel_factory(sizeof(t), TIMING_WHEEL_DEFAULT_CAPACITY, n)
+
+/// @brief Deallocate a timing wheel.
+/// @param w Timing wheel pointer
+#define timing_wheel_destroy(w) CC_FREE(w)
+
+/// @brief Schedule an element to expire at the given deadline. Deadlines at or before the current time expire on the next advance.
+/// @param w Timing wheel pointer
+/// @param t Deadline in ticks
+/// @param d Data pointer
+/// @return Element handle, or TIMING_WHEEL_INVALID_HANDLE on failure
+#define timing_wheel_schedule(w, t, d) _timing_wheel_insert(&w, t, (void*)(d))
+
+/// @brief Move a scheduled element to a new deadline.
+/// @param w Timing wheel pointer
+/// @param h Element handle
+/// @param t New deadline in ticks
+/// @return True if the handle was still scheduled
+#define timing_wheel_reschedule(w, h, t) _timing_wheel_reschedule(w, h, t)
+
+/// @brief Cancel a scheduled element.
+/// @param w Timing wheel pointer
+/// @param h Element handle
+/// @return True if the handle was still scheduled
+#define timing_wheel_cancel(w, h) _timing_wheel_cancel(w, h)
+
+/// @brief Get the data of a scheduled element.
+/// @param w Timing wheel pointer
+/// @param h Element handle
+/// @return Void data pointer, or NULL if the handle has expired or been cancelled
+#define timing_wheel_get(w, h) _timing_wheel_get(w, h)
+
+/// @brief Move the wheel forward to the given time & copy out elements whose deadline has passed, in deadline order. Expired elements that
+/// @brief do not fit are kept for the next call.
+/// @param w Timing wheel pointer
+/// @param n Current time in ticks
+/// @param o Output data array (or NULL if m is 0)
+/// @param m Maximum number of elements to copy out
+/// @return Number of elements copied out
+#define timing_wheel_advance(w, n, o, m) _timing_wheel_advance(w, n, (void*)(o), m)
+
+/// @brief Get the current time of the timing wheel.
+/// @param w Timing wheel pointer
+/// @return Current time in ticks
+#define timing_wheel_now(w) ((w)->_now)
+
+/// @brief Get the number of scheduled & expired elements not yet copied out.
+/// @param w Timing wheel pointer
+/// @return Number of elements
+#define timing_wheel_size(w) ((w)->_length)
+
+/// @brief Get the number of expired elements waiting to be copied out.
+/// @param w Timing wheel pointer
+/// @return Number of elements
+#define timing_wheel_expired(w) ((w)->_ready_length)
+
+/// @brief Cancel all elements in the timing wheel.
+/// @param w Timing wheel pointer
+#define timing_wheel_clear(w) _timing_wheel_clear(w)
+
+/// @brief Get the size of the timing wheel in memory.
+/// @param w Timing wheel pointer
+/// @return Number of bytes
+#define timing_wheel_bytes(w) ((w) ? (_timing_wheel_size((w)->_element_size, (w)->_capacity)) : 0)
+
+/// @brief Header of a timer record, followed by its data.
+typedef struct {
+	uint64_t _deadline;
+	uint32_t _prev;
+	uint32_t _next;
+	uint32_t _generation;
+	uint32_t _slot;
+} _timing_wheel_entry_t;
+
+/// @brief Hierarchical timing wheel of elements ordered by deadline.
+typedef struct {
+	size_t _length;
+	size_t _capacity;
+	size_t _element_size;
+	size_t _ready_length;
+	uint64_t _now;
+	uint32_t _free;
+	uint32_t _ready_head;
+	uint32_t _ready_tail;
+	uint32_t _heads[TIMING_WHEEL_LEVELS * TIMING_WHEEL_SLOTS];
+	uint64_t _occupied[TIMING_WHEEL_LEVELS][TIMING_WHEEL_SLOTS / 64];
+	uint8_t _buffer[];
+} timing_wheel_t;
+
+size_t _timing_wheel_size(size_t, size_t);
+
+timing_wheel_t* _timing_wheel_factory(size_t, size_t, uint64_t);
+
+timing_wheel_t* _timing_wheel_resize(timing_wheel_t*, size_t);
+
+_timing_wheel_entry_t* _timing_wheel_lookup(timing_wheel_t*, timing_wheel_handle_t);
+
+void _timing_wheel_link(timing_wheel_t*, uint32_t);
+
+void _timing_wheel_unlink(timing_wheel_t*, uint32_t);
+
+void _timing_wheel_release(timing_wheel_t*, uint32_t);
+
+timing_wheel_handle_t _timing_wheel_insert(timing_wheel_t**, uint64_t, void*);
+
+bool _timing_wheel_reschedule(timing_wheel_t*, timing_wheel_handle_t, uint64_t);
+
+bool _timing_wheel_cancel(timing_wheel_t*, timing_wheel_handle_t);
+
+void* _timing_wheel_get(timing_wheel_t*, timing_wheel_handle_t);
+
+size_t _timing_wheel_next_slot(timing_wheel_t*, size_t, size_t);
+
+uint64_t _timing_wheel_next_tick(timing_wheel_t*, uint64_t);
+
+void _timing_wheel_tick(timing_wheel_t*, uint64_t);
+
+size_t _timing_wheel_advance(timing_wheel_t*, uint64_t, void*, size_t);
+
+void _timing_wheel_clear(timing_wheel_t*);
+
+#endif	// CC_STD_TIMING_WHEEL_H
@@ -5,11 +5,58 @@
 #ifndef CC_STD_TREE_H
 #define CC_STD_TREE_H
 #include "cc/common.h"
+#include <stddef.h>
+#include <stdio.h>
 
 #define TREE_FLAG_STR   0b10000000
+#define TREE_FLAG_RADIX 0b01000000
+#define _TREE_NODE_ENTRY 0x01
+/// @brief Byte joining the path segments of a compressed radix edge. Radix trees reject key paths with this byte inside a segment.
+#ifndef TREE_RADIX_SEP
+#define TREE_RADIX_SEP '\x1f'
+#endif
+#ifndef TREE_PRINT_SEP
+#define TREE_PRINT_SEP '/'
+#endif
+#ifndef TREE_PRINT_DEFAULT_CAPACITY
+#define TREE_PRINT_DEFAULT_CAPACITY 256ULL
+#endif
+#ifndef TREE_PARALLEL_GRAIN
+#define TREE_PARALLEL_GRAIN 8ULL
+#endif
+#ifndef TREE_PARALLEL_MIN_NODES
+#define TREE_PARALLEL_MIN_NODES 4096ULL
+#endif
+#define _TREE_TASK_VISIT  0
+#define _TREE_TASK_DEPTH  1
+#define _TREE_TASK_DELETE 2
+#define TREE_PRINT_TEXT   0
+#define TREE_PRINT_INDENT 1
+#define TREE_PRINT_JSON   2
 #ifndef TREE_SERIALIZE_MAX_LEN
 #define TREE_SERIALIZE_MAX_LEN 4096
 #endif
+#ifndef TREE_SLAB_DEFAULT_CAPACITY
+#define TREE_SLAB_DEFAULT_CAPACITY 64ULL
+#endif
+#ifndef TREE_SLAB_MAX_CAPACITY
+#define TREE_SLAB_MAX_CAPACITY 65536ULL
+#endif
+#ifndef TREE_KEY_SLAB_SIZE
+#define TREE_KEY_SLAB_SIZE 16384ULL
+#endif
+#ifndef TREE_KEY_CLASSES
+#define TREE_KEY_CLASSES 40
+#endif
+#define _TREE_KEY_MIN_SIZE sizeof(char*)
+#ifndef TREE_INLINE_DATA_SIZE
+#define TREE_INLINE_DATA_SIZE 32ULL
+#endif
+
+#define _tree_align(n) (((n) + (_Alignof(max_align_t) - 1)) & ~(_Alignof(max_align_t) - 1))
+#define _tree_data_inline(b) ((b)->_element_size <= TREE_INLINE_DATA_SIZE)
+#define _tree_node_size(b) (_tree_align(sizeof(_tree_node_t)) + (_tree_data_inline(b) ? _tree_align((b)->_element_size) : 0))
+#define _tree_node_inline(n) ((uint8_t*)(n) + _tree_align(sizeof(_tree_node_t)))
 
 // Use _Generic to select proper tree creation function
 #if __STDC__==1 && __STDC_VERSION >= 201112L
@@ -18,7 +65,7 @@
 /// @param t Tree type
 /// @return Tree pointer
 #define tree_create(t) _Generic((t), \
-	char*: _tree_factory(sizeof(t), 1), \
+	char*: _tree_factory(sizeof(t), TREE_FLAG_STR), \
 	default: _tree_factory(sizeof(t), 0))
 
 #else
@@ -32,7 +79,17 @@
 
 /// @brief Create a new tree that stores character strings.
 /// @return Tree pointer
-#define tree_create_str() _tree_factory(sizeof(char*), 1)
+#define tree_create_str() _tree_factory(sizeof(char*), TREE_FLAG_STR)
+
+/// @brief Create a new path-compressed (radix) tree, where chains of single-child nodes collapse into one edge. Only paths that
+/// @brief were inserted hold elements, and edge keys join their path segments with TREE_RADIX_SEP, so segments may not contain it.
+/// @param t Tree type
+/// @return Tree pointer
+#define tree_create_radix(t) _tree_factory(sizeof(t), TREE_FLAG_RADIX)
+
+/// @brief Create a new path-compressed (radix) tree that stores character strings.
+/// @return Tree pointer
+#define tree_create_radix_str() _tree_factory(sizeof(char*), TREE_FLAG_STR | TREE_FLAG_RADIX)
 
 /// @brief Deallocate a tree.
 /// @param b Tree pointer
@@ -43,7 +100,7 @@
 /// @param k Key path
 /// @param s Key path seperator
 /// @param d Data pointer
-/// @return Void data pointer to inserted element, or NULL on failure
+/// @return Void data pointer to inserted element, or NULL on failure (or if a radix tree key segment contains TREE_RADIX_SEP)
 #define tree_insert(b, k, s, d) _tree_insert(b, k, s, d)
 
 /// @brief Find the element if it exists in the tree.
@@ -53,37 +110,129 @@
 /// @return Void data pointer, or NULL if not found
 #define tree_find(b, k, s) _tree_find(b, k, s)
 
-/// @brief Remove the element from the tree.
+/// @brief Create an iterator over every element whose path starts with the given path prefix.
+/// @param b Tree pointer
+/// @param k Key path prefix
+/// @param s Key path seperator
+/// @return Iterator pointer, or NULL if no elements match
+#define tree_find_prefix(b, k, s) _tree_it(b, k, s, SIZE_MAX)
+
+/// @brief Call a function for every element whose path starts with the given path prefix, stopping early if it returns nonzero.
+/// @param b Tree pointer
+/// @param k Key path prefix
+/// @param s Key path seperator
+/// @param f Visitor function
+/// @param c Visitor context pointer
+/// @return Number of elements visited
+#define tree_walk_prefix(b, k, s, f, c) _tree_walk(b, k, s, SIZE_MAX, f, c)
+
+/// @brief Call a function for every element in the subtree under the given path, stopping early if it returns nonzero.
+/// @param b Tree pointer
+/// @param k Key path (or NULL for the whole tree)
+/// @param s Key path seperator
+/// @param f Visitor function
+/// @param c Visitor context pointer
+/// @return Number of elements visited
+#define tree_for_each(b, k, s, f, c) _tree_walk(b, k, s, SIZE_MAX, f, c)
+
+/// @brief Call a function for every element at most a number of levels below the given path, stopping early if it returns
+/// @brief nonzero. Deeper nodes are never visited.
+/// @param b Tree pointer
+/// @param k Key path (or NULL for the whole tree)
+/// @param s Key path seperator
+/// @param d Maximum depth relative to the path (0 visits only the path itself)
+/// @param f Visitor function
+/// @param c Visitor context pointer
+/// @return Number of elements visited
+#define tree_walk(b, k, s, d, f, c) _tree_walk(b, k, s, d, f, c)
+
+/// @brief Call a function for every element in the subtree under the given path, splitting the subtree across threads. Elements
+/// @brief are visited in no particular order and the function must be safe to call concurrently.
+/// @param b Tree pointer
+/// @param k Key path (or NULL for the whole tree)
+/// @param s Key path seperator
+/// @param f Visitor function
+/// @param c Visitor context pointer
+/// @param n Number of threads
+/// @return Number of elements visited
+#define tree_for_each_parallel(b, k, s, f, c, n) _tree_walk_parallel(b, k, s, f, c, n)
+
+/// @brief Remove the element and all of its children from the tree.
+/// @param b Tree pointer
+/// @param k Key path
+/// @param s Key path seperator
+#define tree_delete(b, k, s) _tree_delete(b, k, s)
+
+/// @brief Remove the element and all of its children from the tree, splitting the subtree across threads.
 /// @param b Tree pointer
 /// @param k Key path
 /// @param s Key path seperator
-#define tree_delete(b, k, s) _tree_clear(b)
+/// @param n Number of threads
+#define tree_delete_parallel(b, k, s, n) _tree_delete_parallel(b, k, s, n)
 
 /// @brief Remove all elements from the tree.
 /// @param b Tree pointer
-#define tree_clear(b) _tree_delete(b, NULL, NULL)
+#define tree_clear(b) _tree_clear(b)
 
-/// @brief Get the depth of a certain node in the tree.
+/// @brief Get the depth of a certain node in the tree (1 for children of the root).
 /// @param b Tree pointer
 /// @param k Key path
 /// @param s Key path seperator
-/// @return Node depth
+/// @return Node depth, or -1 if not found
 #define tree_depth(b, k, s) _tree_depth(b, k, s)
 
-/// @brief Get the deepest node in the tree.
+/// @brief Get the depth of the deepest node in the tree in constant time.
 /// @param b Tree pointer
 /// @return Tree depth
 #define tree_max_depth(b) _tree_depth(b, NULL, NULL)
 
-/// @brief Get the number of nodes in the tree.
+/// @brief Get the number of levels below a node (0 for a leaf), splitting the subtree across threads.
+/// @param b Tree pointer
+/// @param k Key path (or NULL for the whole tree)
+/// @param s Key path seperator
+/// @param n Number of threads
+/// @return Subtree depth, or -1 if not found
+#define tree_depth_parallel(b, k, s, n) _tree_depth_parallel(b, k, s, n)
+
+/// @brief Get the number of elements in the tree.
 /// @param b Tree pointer
 /// @return Tree size
-#define tree_length(b) ((b)->_length - 1)
+#define tree_length(b) ((b)->_entries)
+
+/// @brief Create an iterator for the tree.
+/// @param b Tree pointer
+/// @return Iterator pointer
+#define tree_it(b) _tree_it(b, NULL, NULL, SIZE_MAX)
+
+/// @brief Create an iterator over the elements at most a number of levels below the given path.
+/// @param b Tree pointer
+/// @param k Key path (or NULL for the whole tree)
+/// @param s Key path seperator
+/// @param d Maximum depth relative to the path
+/// @return Iterator pointer, or NULL if no elements match
+#define tree_it_depth(b, k, s, d) _tree_it(b, k, s, d)
+
+/// @brief Move the iterator to the next element.
+/// @param i Iterator pointer
+#define tree_it_next(i) _tree_it_next(i)
 
 /// @brief Convert the tree and its keys to a human-readable string.
 /// @param b Tree pointer
 /// @param s Destination string (must be freed later)
-#define tree_print(b, s) s = (b) ? (_tree_print((b)->_root, 0)) : NULL
+#define tree_print(b, s) s = _tree_print(b, TREE_PRINT_TEXT)
+
+/// @brief Convert the tree and its keys to a string in the given format.
+/// @param b Tree pointer
+/// @param s Destination string (must be freed later)
+/// @param f Output format (TREE_PRINT_TEXT, TREE_PRINT_INDENT or TREE_PRINT_JSON)
+#define tree_print_format(b, s, f) s = _tree_print(b, f)
+
+/// @brief Write the tree and its keys to a file in the given format.
+/// @param b Tree pointer
+/// @param o File pointer
+/// @param f Output format (TREE_PRINT_TEXT, TREE_PRINT_INDENT or TREE_PRINT_JSON)
+/// @return Number of bytes written (or 0 on error)
+#define tree_fprint(b, o, f) _tree_fprint(b, o, f)
 
 /// @brief Convert the tree and its keys to a serialized (not null-terminated) string.
 /// @param b Tree pointer
@@ -97,38 +246,148 @@
 #define tree_deserialize(b, s) _tree_deserialize(b, s)
 
 struct _tree_node_t {
+	struct _tree_node_t* _parent;
+	struct _tree_node_t* _first_child;
+	struct _tree_node_t* _last_child;
+	struct _tree_node_t* _next_sibling;
 	size_t _num_children;
-	struct _tree_node_t** _children;
 	void* _buffer;
 	char* _key;
+	size_t _depth;
+	char _flags;
 };
 
 /// @brief Node in an unbalanced tree.
 typedef struct _tree_node_t _tree_node_t;
 
+struct _tree_slab_t {
+	struct _tree_slab_t* _next;
+	size_t _used;
+	size_t _capacity;
+	max_align_t _buffer[];
+};
+
+/// @brief Block of memory that tree nodes, keys and payloads are carved from.
+typedef struct _tree_slab_t _tree_slab_t;
+
+/// @brief Fixed-size record allocator backed by a chain of slabs.
+typedef struct {
+	_tree_slab_t* _slabs;
+	void* _free;
+	size_t _record_size;
+	size_t _slab_capacity;
+} _tree_pool_t;
+
 /// @brief Unbalanced tree of key-value pairs.
 typedef struct {
 	size_t _element_size;
 	size_t _length;
+	size_t _entries;
 	char _flags;
 	_tree_node_t* _root;
+	_tree_pool_t _nodes;
+	_tree_pool_t _payloads;
+	_tree_slab_t* _keys;
+	char* _key_free[TREE_KEY_CLASSES];
+	size_t* _depth_counts;
+	size_t _depth_capacity;
+	size_t _max_depth;
 } tree_t;
 
+/// @brief Iterator for a tree. In radix trees the key is the compressed edge leading to the element.
+typedef struct {
+	tree_t* _tree;
+	_tree_node_t* _root;
+	_tree_node_t* _node;
+	size_t _limit;
+	void* data;
+	const char* key;
+	size_t depth;
+} tree_it_t;
+
+/// @brief Function called for each element visited in a tree walk. Return nonzero to stop the walk.
+typedef int (*tree_visit_t)(void*, const char*, void*);
+
+/// @brief Output sink for printing a tree, either a growable string or a file.
+typedef struct {
+	FILE* _file;
+	char* _buffer;
+	size_t _length;
+	size_t _capacity;
+	int _error;
+} _tree_writer_t;
+
+void* _tree_pool_alloc(_tree_pool_t*);
+
+void _tree_pool_free(_tree_pool_t*, void*);
+
+void _tree_pool_release(_tree_pool_t*);
+
+size_t _tree_key_class(size_t);
+
+char* _tree_key_alloc(tree_t*, const char*, size_t);
+
+void _tree_key_free(tree_t*, char*);
+
+size_t _tree_key_segments(const char*, size_t);
+
+_tree_node_t* _tree_node_create(tree_t*, _tree_node_t*, char*, size_t);
+
+void _tree_node_release(tree_t*, _tree_node_t*);
+
+void _tree_depth_remove(tree_t*, size_t, size_t);
+
+void _tree_node_unlink(_tree_node_t*);
+
+const char* _tree_token(const char**, const char*, size_t*);
+
+_tree_node_t* _tree_find_node(tree_t*, _tree_node_t*, int, const char*, const char*);
+
+_tree_node_t* _tree_radix_find_node(tree_t*, int, int, const char*, const char*);
+
+_tree_node_t* _tree_locate(tree_t*, int, int, const char*, const char*);
+
 tree_t* _tree_factory(size_t, int);
 
 void _tree_destroy(tree_t*);
 
 void _tree_clear(tree_t*);
 
-void* _tree_find(tree_t*, char*, char*);
+void* _tree_find(tree_t*, const char*, const char*);
+
+void* _tree_insert(tree_t*, const char*, const char*, void*);
+
+void _tree_subtree_release(tree_t*, _tree_node_t*);
+
+void _tree_radix_merge(tree_t*, _tree_node_t*);
+
+void _tree_delete(tree_t*, const char*, const char*);
+
+void _tree_delete_parallel(tree_t*, const char*, const char*, size_t);
+
+int _tree_depth(tree_t*, const char*, const char*);
+
+int _tree_depth_parallel(tree_t*, const char*, const char*, size_t);
+
+_tree_node_t* _tree_next_node(_tree_node_t*, _tree_node_t*, size_t);
+
+tree_it_t* _tree_it(tree_t*, const char*, const char*, size_t);
+
+tree_it_t* _tree_it_next(tree_it_t*);
+
+size_t _tree_walk(tree_t*, const char*, const char*, size_t, tree_visit_t, void*);
+
+size_t _tree_walk_parallel(tree_t*, const char*, const char*, tree_visit_t, void*, size_t);
+
+void _tree_writer_put(_tree_writer_t*, const char*, size_t);
 
-void* _tree_insert(tree_t*, char*, char*, void*);
+void _tree_writer_key(_tree_writer_t*, const char*, int);
 
-void _tree_delete(tree_t*, char*, char*);
+void _tree_write(tree_t*, _tree_writer_t*, int);
 
-int _tree_depth(tree_t*, char*, char*);
+char* _tree_print(tree_t*, int);
 
-char* _tree_print(_tree_node_t*, size_t);
+size_t _tree_fprint(tree_t*, FILE*, int);
 
 size_t _tree_serialize(tree_t*, char*);
 
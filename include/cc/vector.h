@@ -1,10 +1,14 @@
 /**
  * vector.h
- * Dynamically resizing array.
+ * Dynamically resizing array, optionally starting out in caller-provided inline storage or backed by a memory-mapped file.
 */
 #ifndef CC_STD_VECTOR_H
 #define CC_STD_VECTOR_H
 #include "cc/common.h"
+#include <stdbool.h>
+
+/// @brief Function testing an element, given the element & a caller-supplied context.
+typedef bool (*vector_predicate_t)(const void*, void*);
 
 #ifndef VECTOR_DEFAULT_CAPACITY
 #define VECTOR_DEFAULT_CAPACITY 1ULL
@@ -12,8 +16,25 @@
 #ifndef VECTOR_MAX_CAPACITY
 #define VECTOR_MAX_CAPACITY SIZE_MAX - 1
 #endif
+#ifndef VECTOR_SWAP_CHUNK
+#define VECTOR_SWAP_CHUNK 64
+#endif
+#ifndef VECTOR_MAPPED_HEAD
+#define VECTOR_MAPPED_HEAD 65536
+#endif
+
+#define VECTOR_FLAG_INLINE 0x01
+#define VECTOR_FLAG_MAPPED 0x02
+#define VECTOR_MAPPED_MAGIC 0x3152544345564343ULL
+
+#define _VEC_SCAN_FIND 0
+#define _VEC_SCAN_COUNT 1
+#define _VEC_SCAN_COPY 2
 
 #define _vec_pos(v, i) &(v)->_buffer[0] + ((i) * (v)->_element_size)
+#define _vec_inline_size(e, n) (offsetof(vector_t, _buffer) + ((e) * (n)))
+#define _vec_mapped_size ((sizeof(_vec_mapped_t) + 63) & ~(size_t)63)
+#define _vec_mapped(v) ((_vec_mapped_t*)((uint8_t*)(v) - _vec_mapped_size))
 
 /// @brief Create a new vector.
 /// @param t Vector type
@@ -26,9 +47,47 @@
 /// @return Vector pointer
 #define vector_create_size(t, s) _vec_factory(sizeof(t), s)
 
-/// @brief Deallocate a vector.
+/// @brief Declare storage for a small vector holding up to n elements inline, as a local variable or a struct member.
+/// @param s Storage name
+/// @param t Vector type
+/// @param n Number of inline elements
+#define vector_storage(s, t, n) _Alignas(max_align_t) uint8_t s[_vec_inline_size(sizeof(t), n)]
+
+/// @brief Create a small vector in storage declared with vector_storage. Elements stay inline until the storage is full, after which the
+/// @brief vector spills to the heap like any other. The storage must outlive the vector & must not be copied while in use.
+/// @param s Storage name
+/// @param t Vector type
+/// @return Vector pointer
+#define vector_create_inline(s, t) _vec_factory_inline(s, sizeof(s), sizeof(t))
+
+/// @brief Open or create a vector stored in a file & mapped into memory. The file holds the element size, length & elements, so reopening
+/// @brief it picks up where the last run left off, and it can grow past the size of RAM. Growing extends the file & remaps it, so element
+/// @brief pointers change like with any resize. The file is locked while open, so opening it again before the vector is destroyed returns
+/// @brief NULL. The length is written back to the file on flush, growth & destroy. POSIX only, returns NULL elsewhere.
+/// @param t Vector type
+/// @param p File path
+/// @return Vector pointer, or NULL if the file can't be mapped, is already open or holds a vector of another element size
+#define vector_open(t, p) _vec_open(p, sizeof(t))
+
+/// @brief Write the dirty pages of a file-backed vector to disk & wait for them.
+/// @param v Vector pointer
+/// @return True on success
+#define vector_flush(v) _vec_flush(v)
+
+/// @brief Tell the kernel how a file-backed vector is about to be accessed.
+/// @param v Vector pointer
+/// @param a Access pattern (vector_advice_t)
+/// @return True on success
+#define vector_advise(v, a) _vec_advise(v, a)
+
+/// @brief Deallocate a vector. Small vectors that never spilled have nothing to free, file-backed vectors are unmapped & their file closed.
+/// @param v Vector pointer
+#define vector_destroy(v) _vec_destroy(v)
+
+/// @brief Check if a small vector still lives in its inline storage.
 /// @param v Vector pointer
-#define vector_destroy(v) CC_FREE(v)
+/// @return True if no heap memory is in use
+#define vector_is_inline(v) (((v)->_flags & VECTOR_FLAG_INLINE) != 0)
 
 /// @brief Get an element from the vector.
 /// @param v Vector pointer
@@ -84,13 +143,32 @@
 /// @param i Index
 /// @param d Data pointer
 /// @return Void data pointer to inserted element, or NULL on failure
-#define vector_insert(v, i, d) _vec_insert(v, i, (void*)d)
+#define vector_insert(v, i, d) _vec_insert(&v, i, (void*)d)
 
 /// @brief Remove the element at the given point in the vector.
 /// @param v Vector pointer
 /// @param i Index
 #define vector_remove(v, i) _vec_remove(v, i, 1)
 
+/// @brief Remove the element at the given point in O(1) by moving the last element into its place. The order of the elements changes.
+/// @param v Vector pointer
+/// @param i Index
+#define vector_swap_remove(v, i) _vec_swap_remove(v, i)
+
+/// @brief Remove every element the predicate is true for in one linear pass, keeping the order of the rest.
+/// @param v Vector pointer
+/// @param p Predicate (vector_predicate_t)
+/// @param c Context pointer passed to the predicate
+/// @return Number of elements removed
+#define vector_erase_if(v, p, c) _vec_erase_if(v, p, (void*)(c))
+
+/// @brief Remove the elements at a sorted list of indices in one linear pass, keeping the order of the rest.
+/// @param v Vector pointer
+/// @param i Array of indices in ascending order, repeats are removed once
+/// @param n Number of indices
+/// @return Number of elements removed, 0 if an index is out of range or out of order
+#define vector_erase_indices(v, i, n) _vec_erase_indices(v, i, n)
+
 /// @brief Remove all elements from the vector.
 /// @param v Vector pointer
 #define vector_clear(v) _vec_remove(v, 0, (v)->_length)
@@ -106,11 +184,108 @@
 /// @param b Second index
 #define vector_swap(v, a, b) _vec_swap(v, a, b)
 
+/// @brief Reverse the order of the elements in place.
+/// @param v Vector pointer
+#define vector_reverse(v) _vec_reverse(v, 0, (v)->_length)
+
+/// @brief Rotate the elements in place so the element at index n becomes the first.
+/// @param v Vector pointer
+/// @param n Number of positions to rotate left by
+#define vector_rotate(v, n) _vec_rotate(v, n)
+
+/// @brief Put the elements in a uniformly random order in place. The same seed always gives the same order.
+/// @param v Vector pointer
+/// @param s 64-bit seed
+#define vector_shuffle(v, s) _vec_shuffle(v, s)
+
+/// @brief Reorder the elements in place so position i receives the element that was at p[i]. The table is validated first & is left
+/// @brief unchanged when the call returns.
+/// @param v Vector pointer
+/// @param p Permutation table of vector_size(v) indices
+/// @return True on success, false if the table is not a permutation
+#define vector_apply_permutation(v, p) _vec_apply_permutation(v, p)
+
+/// @brief Find the first element whose key equals a value. Keys are read from the start of each element, vectors of bare keys are scanned
+/// @brief with SIMD when the CPU supports it.
+/// @param v Vector pointer
+/// @param k Key type (vector_key_t)
+/// @param x Pointer to the key value
+/// @return Index of the element, or SIZE_MAX if not found
+#define vector_find(v, k, x) _vec_find(v, k, (void*)(x))
+
+/// @brief Count the elements whose key lies in an inclusive range.
+/// @param v Vector pointer
+/// @param k Key type (vector_key_t)
+/// @param lo Pointer to the lowest key value
+/// @param hi Pointer to the highest key value
+/// @return Number of elements in range
+#define vector_count(v, k, lo, hi) _vec_count(v, k, (void*)(lo), (void*)(hi))
+
+/// @brief Binary search a vector sorted by key for the first element whose key is not less than a value.
+/// @param v Vector pointer
+/// @param k Key type (vector_key_t)
+/// @param x Pointer to the key value
+/// @return Index of the element, or the vector size if every key is less
+#define vector_lower_bound(v, k, x) _vec_lower_bound(v, k, (void*)(x))
+
+/// @brief Append every element whose key lies in an inclusive range to another vector of the same element size, keeping their order.
+/// @param d Destination vector pointer
+/// @param v Source vector pointer
+/// @param k Key type (vector_key_t)
+/// @param lo Pointer to the lowest key value
+/// @param hi Pointer to the highest key value
+/// @return Number of elements appended, 0 on failure
+#define vector_filter_into(d, v, k, lo, hi) _vec_filter_into(&d, v, k, (void*)(lo), (void*)(hi))
+
+/// @brief Type of the key at the start of each element, for the search & filter functions.
+typedef enum {
+	VECTOR_KEY_I8,
+	VECTOR_KEY_U8,
+	VECTOR_KEY_I16,
+	VECTOR_KEY_U16,
+	VECTOR_KEY_I32,
+	VECTOR_KEY_U32,
+	VECTOR_KEY_I64,
+	VECTOR_KEY_U64,
+	VECTOR_KEY_F32,
+	VECTOR_KEY_F64,
+	VECTOR_KEY_COUNT
+} vector_key_t;
+
+/// @brief Scan kernel, finding, counting or copying out the elements whose key is in range.
+typedef size_t (*_vec_scan_fn)(const uint8_t*, size_t, size_t, const void*, const void*, int, uint8_t*);
+
+/// @brief Expected access pattern of a file-backed vector.
+typedef enum {
+	VECTOR_ADVICE_NORMAL,
+	VECTOR_ADVICE_SEQUENTIAL,
+	VECTOR_ADVICE_RANDOM,
+	VECTOR_ADVICE_WILLNEED,
+	VECTOR_ADVICE_DONTNEED
+} vector_advice_t;
+
+/// @brief Header at the start of a vector file. The elements follow VECTOR_MAPPED_HEAD bytes in, a multiple of the page size.
+typedef struct {
+	uint64_t _magic;
+	uint64_t _element_size;
+	uint64_t _length;
+} _vec_file_t;
+
+/// @brief Process-local handle of a file-backed vector, kept with the vector header in a private page mapped just in front of the elements.
+typedef struct {
+	int _fd;
+	size_t _page;
+	size_t _map_size;
+	uint8_t* _base;
+	_vec_file_t* _file;
+} _vec_mapped_t;
+
 /// @brief Dynamically resizing array.
 typedef struct {
 	size_t _length;
 	size_t _capacity;
 	size_t _element_size;
+	size_t _flags;
 	uint8_t _buffer[];
 } vector_t;
 
@@ -118,12 +293,52 @@ size_t _vec_size(size_t, size_t);
 
 vector_t* _vec_factory(size_t, size_t);
 
+vector_t* _vec_factory_inline(void*, size_t, size_t);
+
+void _vec_destroy(vector_t*);
+
+vector_t* _vec_open(const char*, size_t);
+
+void _vec_close(vector_t*);
+
+vector_t* _vec_remap(vector_t*, size_t);
+
+bool _vec_flush(vector_t*);
+
+bool _vec_advise(vector_t*, vector_advice_t);
+
 vector_t* _vec_resize(vector_t*, size_t);
 
 void* _vec_insert(vector_t**, size_t, void*);
 
 void _vec_remove(vector_t*, size_t, size_t);
 
+void _vec_swap_remove(vector_t*, size_t);
+
+size_t _vec_erase_if(vector_t*, vector_predicate_t, void*);
+
+size_t _vec_erase_indices(vector_t*, const size_t*, size_t);
+
+void _vec_swap_bytes(uint8_t*, uint8_t*, size_t);
+
 void _vec_swap(vector_t*, size_t, size_t);
 
+void _vec_reverse(vector_t*, size_t, size_t);
+
+void _vec_rotate(vector_t*, size_t);
+
+void _vec_shuffle(vector_t*, uint64_t);
+
+bool _vec_apply_permutation(vector_t*, size_t*);
+
+_vec_scan_fn _vec_scan_kernel(vector_t*, vector_key_t);
+
+size_t _vec_find(vector_t*, vector_key_t, void*);
+
+size_t _vec_count(vector_t*, vector_key_t, void*, void*);
+
+size_t _vec_lower_bound(vector_t*, vector_key_t, void*);
+
+size_t _vec_filter_into(vector_t**, vector_t*, vector_key_t, void*, void*);
+
 #endif  // CC_STD_VECTOR_H
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include "cc/blocking_queue.h"
+#include <string.h>
+#include <time.h>
+
+blocking_queue_t* _blocking_queue_factory(size_t element_size, size_t capacity) {
+	if (capacity == 0) { return NULL; }
+	blocking_queue_t* bq = CC_CALLOC(1, sizeof *bq);
+	if (!bq) { return NULL; }
+	bq->_queue = _queue_factory(element_size, capacity);
+	if (!bq->_queue) {
+		CC_FREE(bq);
+		return NULL;
+	}
+	if (mtx_init(&bq->_lock, mtx_plain) != thrd_success) {
+		CC_FREE(bq->_queue);
+		CC_FREE(bq);
+		return NULL;
+	}
+	if (cnd_init(&bq->_not_empty) != thrd_success) {
+		mtx_destroy(&bq->_lock);
+		CC_FREE(bq->_queue);
+		CC_FREE(bq);
+		return NULL;
+	}
+	if (cnd_init(&bq->_not_full) != thrd_success) {
+		cnd_destroy(&bq->_not_empty);
+		mtx_destroy(&bq->_lock);
+		CC_FREE(bq->_queue);
+		CC_FREE(bq);
+		return NULL;
+	}
+	return bq;
+}
+
+void _blocking_queue_destroy(blocking_queue_t* bq) {
+	// Error check
+	if (!bq) { return; }
+	cnd_destroy(&bq->_not_full);
+	cnd_destroy(&bq->_not_empty);
+	mtx_destroy(&bq->_lock);
+	CC_FREE(bq->_queue);
+	CC_FREE(bq);
+}
+
+bool _blocking_queue_deadline(struct timespec* deadline, size_t timeout_ms) {
+	// The C11 timed waits take an absolute TIME_UTC time
+	if (timespec_get(deadline, TIME_UTC) != TIME_UTC) { return false; }
+	size_t sec = timeout_ms / 1000;
+	long nsec = deadline->tv_nsec + (long)(timeout_ms % 1000) * 1000000L;
+	if (nsec >= 1000000000L) {
+		nsec -= 1000000000L;
+		sec++;
+	}
+	deadline->tv_sec += (time_t)sec;
+	deadline->tv_nsec = nsec;
+	return true;
+}
+
+bool _blocking_queue_wait(blocking_queue_t* bq, cnd_t* cond, size_t* waiting, struct timespec* deadline, size_t timeout_ms) {
+	// Sleep on the condition, the lock must be held
+	if (timeout_ms == 0) { return false; }
+	(*waiting)++;
+	int r = (timeout_ms == BLOCKING_QUEUE_WAIT_FOREVER) ? cnd_wait(cond, &bq->_lock) : cnd_timedwait(cond, &bq->_lock, deadline);
+	(*waiting)--;
+	return r == thrd_success;
+}
+
+size_t _blocking_queue_push_n(blocking_queue_t* bq, void* data, size_t count, size_t timeout_ms) {
+	// Error check
+	if (!bq || !data || count == 0) { return 0; }
+	struct timespec deadline;
+	if (timeout_ms != 0 && timeout_ms != BLOCKING_QUEUE_WAIT_FOREVER && !_blocking_queue_deadline(&deadline, timeout_ms)) { return 0; }
+
+	// Wait for room
+	mtx_lock(&bq->_lock);
+	queue_t* qu = bq->_queue;
+	while(!bq->_closed && qu->_length == qu->_capacity) {
+		if (!_blocking_queue_wait(bq, &bq->_not_full, &bq->_waiting_producers, &deadline, timeout_ms)) { break; }
+	}
+	if (bq->_closed || qu->_length == qu->_capacity) {
+		mtx_unlock(&bq->_lock);
+		return 0;
+	}
+
+	// Copy in as much of the batch as fits, which never grows the ring
+	count = CC_MIN(count, qu->_capacity - qu->_length);
+	_queue_insert_n(&bq->_queue, data, count);
+
+	// Only wake consumers that are actually asleep
+	if (bq->_waiting_consumers > 0) {
+		if (count > 1) { cnd_broadcast(&bq->_not_empty); }
+		else { cnd_signal(&bq->_not_empty); }
+	}
+	mtx_unlock(&bq->_lock);
+	return count;
+}
+
+bool _blocking_queue_push(blocking_queue_t* bq, void* data, size_t timeout_ms) {
+	return _blocking_queue_push_n(bq, data, 1, timeout_ms) == 1;
+}
+
+size_t _blocking_queue_pop_n(blocking_queue_t* bq, void* data, size_t count, size_t timeout_ms) {
+	// Error check
+	if (!bq || !data || count == 0) { return 0; }
+	struct timespec deadline;
+	if (timeout_ms != 0 && timeout_ms != BLOCKING_QUEUE_WAIT_FOREVER && !_blocking_queue_deadline(&deadline, timeout_ms)) { return 0; }
+
+	// Wait for elements, a closed queue is still drained
+	mtx_lock(&bq->_lock);
+	queue_t* qu = bq->_queue;
+	while(!bq->_closed && qu->_length == 0) {
+		if (!_blocking_queue_wait(bq, &bq->_not_empty, &bq->_waiting_consumers, &deadline, timeout_ms)) { break; }
+	}
+	if (qu->_length == 0) {
+		mtx_unlock(&bq->_lock);
+		return 0;
+	}
+
+	// Copy out up to count elements from the two runs of the ring
+	queue_span_t spans[2];
+	size_t n = _queue_spans(qu, spans);
+	size_t offset = 0;
+	for(size_t i=0; i<n && offset<count; ++i) {
+		size_t take = CC_MIN(spans[i].count, count - offset);
+		size_t dest_size = take * qu->_element_size;
+		memcpy_s((uint8_t*)data + (offset * qu->_element_size), dest_size, spans[i].data, dest_size);
+		offset += take;
+	}
+	_queue_remove(qu, offset);
+
+	// Only wake producers that are actually asleep
+	if (bq->_waiting_producers > 0) {
+		if (offset > 1) { cnd_broadcast(&bq->_not_full); }
+		else { cnd_signal(&bq->_not_full); }
+	}
+	mtx_unlock(&bq->_lock);
+	return offset;
+}
+
+bool _blocking_queue_pop(blocking_queue_t* bq, void* data, size_t timeout_ms) {
+	return _blocking_queue_pop_n(bq, data, 1, timeout_ms) == 1;
+}
+
+void _blocking_queue_close(blocking_queue_t* bq) {
+	// Error check
+	if (!bq) { return; }
+
+	// Wake everyone so they see the flag
+	mtx_lock(&bq->_lock);
+	bq->_closed = true;
+	cnd_broadcast(&bq->_not_empty);
+	cnd_broadcast(&bq->_not_full);
+	mtx_unlock(&bq->_lock);
+}
+
+size_t _blocking_queue_length(blocking_queue_t* bq) {
+	// Error check
+	if (!bq) { return 0; }
+	mtx_lock(&bq->_lock);
+	size_t length = bq->_queue->_length;
+	mtx_unlock(&bq->_lock);
+	return length;
+}
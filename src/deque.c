@@ -1,23 +1,50 @@
 #include "cc/deque.h"
+#include <string.h>
 #include <math.h>
 
-size_t _deque_size(size_t element_size, size_t capacity) {
-	size_t c = element_size * capacity;
-	if (c / capacity != element_size) { return 0; }
+size_t _deque_size(size_t element_size, size_t capacity, size_t flags) {
+	// Chunked deques only keep the chunk map inline
+	size_t s = (flags & DEQUE_FLAG_CHUNKED) ? sizeof(uint8_t*) : element_size;
+	size_t c = s * capacity;
+	if (c / capacity != s) { return 0; }
 	return CC_MAX(sizeof(deque_t), offsetof(deque_t, _buffer) + c);
 }
 
-deque_t* _deque_factory(size_t element_size, size_t capacity) {
-	size_t buffer_size = _deque_size(element_size, capacity);
+deque_t* _deque_factory(size_t element_size, size_t capacity, size_t flags) {
+	if (capacity == 0) { return NULL; }
+	size_t buffer_size = _deque_size(element_size, capacity, flags);
 	if (buffer_size == 0) { return NULL; }
 	deque_t* qu = CC_CALLOC(1, buffer_size);
 	if (!qu) { return NULL; }
 	qu->_capacity = capacity;
 	qu->_element_size = element_size;
+	qu->_flags = flags;
+
+	// Start in the middle of the map so either end can grow
+	if (flags & DEQUE_FLAG_CHUNKED) {
+		qu->_chunk_length = CC_MAX(DEQUE_CHUNK_BYTES / CC_MAX(element_size, (size_t)1), (size_t)1);
+		qu->_head = (capacity / 2) * qu->_chunk_length;
+		qu->_tail = qu->_head;
+	}
 	return qu;
 }
 
+void _deque_destroy(deque_t* qu) {
+	// Error check
+	if (!qu) { return; }
+
+	// Deallocate the live chunks & the spare
+	if ((qu->_flags & DEQUE_FLAG_CHUNKED) && qu->_length > 0) {
+		_deque_chunk_release(qu, qu->_head / qu->_chunk_length, ((qu->_tail - 1) / qu->_chunk_length) + 1);
+	}
+	CC_FREE(qu->_spare);
+	CC_FREE(qu);
+}
+
 deque_t* _deque_resize(deque_t* qu, size_t new_capacity) {
+	// Chunked deques only ever move their map
+	if (qu->_flags & DEQUE_FLAG_CHUNKED) { return _deque_remap(qu, new_capacity); }
+
 	// Calculate new capacity
 	if (new_capacity == 0) {
 		size_t c = CC_NEXT_POW2(qu->_capacity + 1);
@@ -25,47 +52,141 @@ deque_t* _deque_resize(deque_t* qu, size_t new_capacity) {
 	}
 	if (new_capacity > DEQUE_MAX_CAPACITY || new_capacity < qu->_length) { return NULL; }
 
-	// Create new deque & copy data to it
-	deque_t* new_qu = _deque_factory(qu->_element_size, new_capacity);
+	// Create new deque & copy data to it, in two parts if it wraps around the circular buffer
+	deque_t* new_qu = _deque_factory(qu->_element_size, new_capacity, qu->_flags);
 	if (!new_qu) { return NULL; }
-	if (qu->_tail <= qu->_head) {
-		// Queue wraps around circular buffer, copy in two parts
-		size_t _qu_end = (qu->_capacity - qu->_head);
-		size_t dest_size_start = _qu_end * qu->_element_size;
-		size_t dest_size_end = (qu->_length - _qu_end) * qu->_element_size;
-		memcpy_s(_deque_pos(new_qu, 0), dest_size_start, _deque_pos(qu, qu->_head), dest_size_start);
-		memcpy_s(_deque_pos(new_qu, _qu_end), dest_size_end, _deque_pos(qu, 0), dest_size_end);
-	}
-	else {
-		// Queue is contained in circular buffer, one copy will get everything
-		size_t dest_size = qu->_length * qu->_element_size;
-		memcpy_s(new_qu->_buffer, dest_size, _deque_pos(qu, qu->_head), dest_size);
+	deque_span_t spans[2];
+	size_t n = _deque_spans(qu, spans, 2);
+	size_t offset = 0;
+	for(size_t i=0; i<n; ++i) {
+		size_t dest_size = spans[i].count * qu->_element_size;
+		memcpy_s(_deque_pos(new_qu, offset), dest_size, spans[i].data, dest_size);
+		offset += spans[i].count;
 	}
 	new_qu->_head = 0;
-	new_qu->_tail = qu->_length;
+	new_qu->_tail = qu->_length % new_capacity;
 	new_qu->_length = qu->_length;
 	CC_FREE(qu);
 	return new_qu;
 }
 
+deque_t* _deque_remap(deque_t* qu, size_t new_capacity) {
+	// Calculate a map size with a free chunk on both sides of the live ones
+	size_t first = qu->_head / qu->_chunk_length;
+	size_t used = (qu->_length > 0) ? ((qu->_tail - 1) / qu->_chunk_length) - first + 1 : 0;
+	if (new_capacity == 0) {
+		new_capacity = qu->_capacity;
+		while(new_capacity < (used + 1) * 2) {
+			if (new_capacity > (SIZE_MAX / sizeof(uint8_t*)) / 2) { return NULL; }
+			new_capacity *= 2;
+		}
+	}
+	if (new_capacity < used + 2) { return NULL; }
+
+	// Grow into a new map if needed, only the chunk pointers are copied
+	deque_t* new_qu = qu;
+	if (new_capacity != qu->_capacity) {
+		new_qu = _deque_factory(qu->_element_size, new_capacity, qu->_flags);
+		if (!new_qu) { return NULL; }
+		new_qu->_length = qu->_length;
+		new_qu->_spare = qu->_spare;
+	}
+
+	// Center the live chunks
+	size_t new_first = (new_capacity - used) / 2;
+	memmove(&_deque_chunk(new_qu, new_first), &_deque_chunk(qu, first), used * sizeof(uint8_t*));
+	if (new_qu == qu) {
+		for(size_t i=0; i<new_first; ++i) { _deque_chunk(qu, i) = NULL; }
+		for(size_t i=new_first+used; i<new_capacity; ++i) { _deque_chunk(qu, i) = NULL; }
+	}
+	new_qu->_head = (new_first * qu->_chunk_length) + (qu->_head % qu->_chunk_length);
+	new_qu->_tail = new_qu->_head + qu->_length;
+	if (new_qu != qu) { CC_FREE(qu); }
+	return new_qu;
+}
+
+uint8_t* _deque_chunk_take(deque_t* qu, size_t chunk) {
+	// Reuse the spare chunk before allocating
+	if (_deque_chunk(qu, chunk)) { return _deque_chunk(qu, chunk); }
+	uint8_t* c = qu->_spare;
+	if (c) { qu->_spare = NULL; }
+	else {
+		c = CC_MALLOC(qu->_chunk_length * qu->_element_size);
+		if (!c) { return NULL; }
+	}
+	_deque_chunk(qu, chunk) = c;
+	return c;
+}
+
+void _deque_chunk_release(deque_t* qu, size_t first, size_t last) {
+	// Keep one emptied chunk around for the next push, free the rest
+	for(size_t i=first; i<last; ++i) {
+		if (!qu->_spare) { qu->_spare = _deque_chunk(qu, i); }
+		else { CC_FREE(_deque_chunk(qu, i)); }
+		_deque_chunk(qu, i) = NULL;
+	}
+}
+
+void* _deque_at(deque_t* qu, size_t index) {
+	// Error check
+	if (!qu || index >= qu->_length) { return NULL; }
+	if (qu->_flags & DEQUE_FLAG_CHUNKED) { return _deque_chunk_pos(qu, qu->_head + index); }
+	return _deque_pos(qu, (qu->_head + index) % qu->_capacity);
+}
+
+size_t _deque_spans(deque_t* qu, deque_span_t* spans, size_t max) {
+	// Error check
+	if (!qu || !spans) { return 0; }
+
+	// Walk from the front, cutting a run at the end of the buffer or of each chunk
+	size_t n = 0;
+	size_t index = 0;
+	while(n < max && index < qu->_length) {
+		size_t o = qu->_head + index;
+		size_t run;
+		if (qu->_flags & DEQUE_FLAG_CHUNKED) {
+			run = qu->_chunk_length - (o % qu->_chunk_length);
+			spans[n].data = _deque_chunk_pos(qu, o);
+		}
+		else {
+			o %= qu->_capacity;
+			run = qu->_capacity - o;
+			spans[n].data = _deque_pos(qu, o);
+		}
+		spans[n].count = CC_MIN(run, qu->_length - index);
+		index += spans[n].count;
+		n++;
+	}
+	return n;
+}
+
 void* _deque_insert_front(deque_t** qu, void* data) {
 	// Error check
 	if (!qu || !(*qu)) { return NULL; }
 	deque_t* _qu = *qu;
 
 	// Resize container
-	if (_qu->_length >= _qu->_capacity) {
+	bool chunked = (_qu->_flags & DEQUE_FLAG_CHUNKED) != 0;
+	if ((chunked) ? _qu->_head == 0 : _qu->_length >= _qu->_capacity) {
 		deque_t* temp = _deque_resize(_qu, 0);
 		if (!temp) { return NULL; }
 		(*qu) = temp;
 		_qu = temp;
 	}
 
-	// Append to tail
-	void* dest = _deque_pos(_qu, _qu->_tail);
+	// Prepend before the head
+	void* dest;
+	if (chunked) {
+		if (!_deque_chunk_take(_qu, (_qu->_head - 1) / _qu->_chunk_length)) { return NULL; }
+		_qu->_head--;
+		dest = _deque_chunk_pos(_qu, _qu->_head);
+	}
+	else {
+		_qu->_head = (_qu->_head == 0) ? _qu->_capacity - 1 : _qu->_head - 1;
+		dest = _deque_pos(_qu, _qu->_head);
+	}
 	size_t dest_size = _qu->_element_size;
 	memcpy_s(dest, dest_size, data, dest_size);
-	_qu->_tail = (_qu->_tail + 1) % _qu->_capacity;
 	_qu->_length++;
 	return dest;
 }
@@ -76,40 +197,93 @@ void* _deque_insert_back(deque_t** qu, void* data) {
 	deque_t* _qu = *qu;
 
 	// Resize container
-	if (_qu->_length >= _qu->_capacity) {
+	bool chunked = (_qu->_flags & DEQUE_FLAG_CHUNKED) != 0;
+	if ((chunked) ? _qu->_tail == _qu->_capacity * _qu->_chunk_length : _qu->_length >= _qu->_capacity) {
 		deque_t* temp = _deque_resize(_qu, 0);
 		if (!temp) { return NULL; }
 		(*qu) = temp;
 		_qu = temp;
 	}
 
-	// Append to head
-	_qu->_length++;
-	_qu->_head = (_qu->_head == 0) ? _qu->_capacity : _qu->_head - 1;
-	void* dest = _deque_pos(_qu, _qu->_head);
+	// Append at the tail
+	void* dest;
+	if (chunked) {
+		if (!_deque_chunk_take(_qu, _qu->_tail / _qu->_chunk_length)) { return NULL; }
+		dest = _deque_chunk_pos(_qu, _qu->_tail);
+		_qu->_tail++;
+	}
+	else {
+		dest = _deque_pos(_qu, _qu->_tail);
+		_qu->_tail = (_qu->_tail + 1) % _qu->_capacity;
+	}
 	size_t dest_size = _qu->_element_size;
 	memcpy_s(dest, dest_size, data, dest_size);
+	_qu->_length++;
 	return dest;
 }
 
-void _deque_remove_front(deque_t* qu, size_t count) {
+size_t _deque_remove_front(deque_t* qu, size_t count) {
 	// Error check
-	if (!qu || qu->_length < count) { return; }
+	if (!qu) { return 0; }
+	count = CC_MIN(count, qu->_length);
+	if (count == 0) { return 0; }
+
+	// Advance the head
+	if (!(qu->_flags & DEQUE_FLAG_CHUNKED)) {
+		qu->_head = (qu->_head + count) % qu->_capacity;
+		qu->_length -= count;
+		return count;
+	}
 
-	// Decrement tail
-	size_t new_tail = (qu->_tail < count) ? (qu->_capacity - count + qu->_tail) : qu->_tail - count;
-	qu->_tail = (qu->_head <= qu->_tail && new_tail < qu->_head) ? qu->_head : new_tail;
+	// Give back the chunks left behind, or all of them & re-center once empty
+	size_t first = qu->_head / qu->_chunk_length;
+	qu->_head += count;
 	qu->_length -= count;
-	return;
+	if (qu->_length == 0) {
+		_deque_chunk_release(qu, first, ((qu->_tail - 1) / qu->_chunk_length) + 1);
+		qu->_head = (qu->_capacity / 2) * qu->_chunk_length;
+		qu->_tail = qu->_head;
+		return count;
+	}
+	_deque_chunk_release(qu, first, qu->_head / qu->_chunk_length);
+	return count;
 }
 
-void _deque_remove_back(deque_t* qu, size_t count) {
+size_t _deque_remove_back(deque_t* qu, size_t count) {
 	// Error check
-	if (!qu || qu->_length < count) { return; }
+	if (!qu) { return 0; }
+	count = CC_MIN(count, qu->_length);
+	if (count == 0) { return 0; }
+
+	// Pull back the tail
+	if (!(qu->_flags & DEQUE_FLAG_CHUNKED)) {
+		qu->_tail = (qu->_tail + qu->_capacity - count) % qu->_capacity;
+		qu->_length -= count;
+		return count;
+	}
 
-	// Increment head
-	size_t new_head = (qu->_head + count) % qu->_capacity;
-	qu->_head = (qu->_head <= qu->_tail && new_head > qu->_tail) ? qu->_tail : new_head;
+	// Give back the chunks left behind, or all of them & re-center once empty
+	size_t last = ((qu->_tail - 1) / qu->_chunk_length) + 1;
+	qu->_tail -= count;
 	qu->_length -= count;
-	return;
-}
\ No newline at end of file
+	if (qu->_length == 0) {
+		_deque_chunk_release(qu, qu->_head / qu->_chunk_length, last);
+		qu->_head = (qu->_capacity / 2) * qu->_chunk_length;
+		qu->_tail = qu->_head;
+		return count;
+	}
+	_deque_chunk_release(qu, ((qu->_tail - 1) / qu->_chunk_length) + 1, last);
+	return count;
+}
+
+size_t _deque_bytes(deque_t* qu) {
+	// Error check
+	if (!qu) { return 0; }
+	size_t bytes = _deque_size(qu->_element_size, qu->_capacity, qu->_flags);
+	if (!(qu->_flags & DEQUE_FLAG_CHUNKED)) { return bytes; }
+
+	// Add the live chunks & the spare
+	size_t chunks = (qu->_length > 0) ? ((qu->_tail - 1) / qu->_chunk_length) - (qu->_head / qu->_chunk_length) + 1 : 0;
+	chunks += (qu->_spare) ? 1 : 0;
+	return bytes + (chunks * qu->_chunk_length * qu->_element_size);
+}
@@ -1,40 +1,105 @@
 #include "cc/free_list.h"
+#include <string.h>
 #include <math.h>
 
-size_t _free_list_buffer_size(size_t element_size, size_t capacity) {
+size_t _free_list_buffer_size(size_t element_size, size_t capacity, size_t flags) {
+	// Paged lists only keep the page table inline, the capacity counting pages
+	if (flags & FREE_LIST_FLAG_PAGED) {
+		if (capacity > (SIZE_MAX - offsetof(free_list_t, _buffer)) / sizeof(_free_list_page_t*)) { return 0; }
+		return offsetof(free_list_t, _buffer) + (capacity * sizeof(_free_list_page_t*));
+	}
+
 	size_t c = element_size * capacity;
 	if (c / capacity != element_size) { return 0; }
-	size_t o = ((capacity/8)+1);
+
+	// Slot maps keep a slot table & a packed-to-slot table in front of the data, plain lists a word-padded bitmap
+	size_t o = _free_list_align((capacity/8)+1);
+	if (flags & FREE_LIST_FLAG_SLOT_MAP) {
+		if (capacity > UINT32_MAX) { return 0; }
+		o = (capacity * sizeof(_free_list_slot_t)) + _free_list_align(capacity * sizeof(uint32_t));
+	}
+	if (c > SIZE_MAX - o - offsetof(free_list_t, _buffer)) { return 0; }
 	return CC_MAX(sizeof(free_list_t), offsetof(free_list_t, _buffer) + c + o);
 }
 
-free_list_t* _free_list_factory(size_t element_size, size_t capacity) {
-	size_t buffer_size = _free_list_buffer_size(element_size, capacity);
+free_list_t* _free_list_factory(size_t element_size, size_t capacity, size_t flags) {
+	// Slot maps move elements around, so they cannot be paged
+	if (capacity == 0 || ((flags & FREE_LIST_FLAG_PAGED) && (flags & FREE_LIST_FLAG_SLOT_MAP))) { return NULL; }
+	size_t pages = (capacity / FREE_LIST_PAGE_SIZE) + ((capacity % FREE_LIST_PAGE_SIZE) != 0);
+	size_t buffer_size = _free_list_buffer_size(element_size, (flags & FREE_LIST_FLAG_PAGED) ? pages : capacity, flags);
 	if (buffer_size == 0) { return NULL; }
-	//size_t object_size = offsetof(free_list_t, _buffer) + ((capacity/8)+1) + buffer_size;
 	free_list_t* list = CC_CALLOC(buffer_size, 1);
 	if (!list) { return NULL; }
 	list->_capacity = capacity;
 	list->_element_size = element_size;
+	list->_flags = flags;
+
+	// Allocate the first pages into the page table
+	if (flags & FREE_LIST_FLAG_PAGED) {
+		list->_capacity = 0;
+		list->_page_capacity = pages;
+		free_list_t* temp = _free_list_resize(list, pages * FREE_LIST_PAGE_SIZE);
+		if (!temp) { CC_FREE(list); }
+		return temp;
+	}
+
+	// Chain every slot onto the free list, the last one pointing past the end
+	if (flags & FREE_LIST_FLAG_SLOT_MAP) {
+		for(size_t i=0; i<capacity; ++i) {
+			_free_list_slot(list, i)._index = (uint32_t)(i + 1);
+		}
+	}
 	return list;
 }
 
+void _free_list_destroy(free_list_t* list) {
+	// Error check
+	if (!list) { return; }
+
+	// Deallocate every page
+	if (list->_flags & FREE_LIST_FLAG_PAGED) {
+		for(size_t i=0; i<list->_capacity / FREE_LIST_PAGE_SIZE; ++i) {
+			CC_FREE(_free_list_page(list, i));
+		}
+	}
+	CC_FREE(list);
+}
+
 free_list_t* _free_list_resize(free_list_t* list, size_t new_capacity) {
-	// Calculate new capacity
-	if (new_capacity == 0) {
+	// Calculate new capacity, paged lists growing one page at a time
+	if (new_capacity == 0 && (list->_flags & FREE_LIST_FLAG_PAGED)) {
+		new_capacity = (list->_capacity <= FREE_LIST_MAX_CAPACITY - FREE_LIST_PAGE_SIZE) ? list->_capacity + FREE_LIST_PAGE_SIZE : SIZE_MAX;
+	}
+	else if (new_capacity == 0) {
 		size_t c = CC_NEXT_POW2(list->_capacity + 1);
 		new_capacity = CC_MIN(c, FREE_LIST_MAX_CAPACITY);
 	}
-	if (new_capacity > FREE_LIST_MAX_CAPACITY) { return NULL; }
+	if (new_capacity > FREE_LIST_MAX_CAPACITY || new_capacity < list->_capacity) { return NULL; }
+
+	// Paged lists add pages instead of copying elements
+	if (list->_flags & FREE_LIST_FLAG_PAGED) {
+		return _free_list_add_pages(list, (new_capacity / FREE_LIST_PAGE_SIZE) + ((new_capacity % FREE_LIST_PAGE_SIZE) != 0));
+	}
 
 	// Create a new list & copy data over
-	free_list_t* new_list = _free_list_factory(list->_element_size, new_capacity);
+	free_list_t* new_list = _free_list_factory(list->_element_size, new_capacity, list->_flags);
 	if (!new_list) { return NULL; }
 
-	size_t bit_dest_size = (list->_capacity / 8) + 1;
-	memcpy_s(&new_list->_buffer[0], bit_dest_size, &list->_buffer[0], bit_dest_size);
-	size_t data_dest_size = list->_capacity * list->_element_size;
-	memcpy_s(_free_list_pos(new_list, 0), data_dest_size, _free_list_pos(list, 0), data_dest_size);
+	if (list->_flags & FREE_LIST_FLAG_SLOT_MAP) {
+		// The old free chain ends at the old capacity, which is where the new chain starts
+		size_t slot_dest_size = list->_capacity * sizeof(_free_list_slot_t);
+		memcpy_s(&_free_list_slot(new_list, 0), slot_dest_size, &_free_list_slot(list, 0), slot_dest_size);
+		size_t dense_dest_size = list->_length * sizeof(uint32_t);
+		memcpy_s(&_free_list_dense_slot(new_list, 0), dense_dest_size, &_free_list_dense_slot(list, 0), dense_dest_size);
+		size_t data_dest_size = list->_length * list->_element_size;
+		memcpy_s(_free_list_dense_pos(new_list, 0), data_dest_size, _free_list_dense_pos(list, 0), data_dest_size);
+	}
+	else {
+		size_t bit_dest_size = _free_list_bit_num(list);
+		memcpy_s(&new_list->_buffer[0], bit_dest_size, &list->_buffer[0], bit_dest_size);
+		size_t data_dest_size = list->_capacity * list->_element_size;
+		memcpy_s(_free_list_pos(new_list, 0), data_dest_size, _free_list_pos(list, 0), data_dest_size);
+	}
 
 	new_list->_length = list->_length;
 	new_list->_next_free = list->_next_free;
@@ -42,13 +107,78 @@ free_list_t* _free_list_resize(free_list_t* list, size_t new_capacity) {
 	return new_list;
 }
 
+free_list_t* _free_list_add_pages(free_list_t* list, size_t pages) {
+	// Double the page table until it fits, which moves the list but none of the pages
+	size_t old_pages = list->_capacity / FREE_LIST_PAGE_SIZE;
+	size_t page_capacity = CC_MAX(list->_page_capacity, (size_t)1);
+	while(page_capacity < pages) { page_capacity *= 2; }
+	free_list_t* new_list = list;
+	if (page_capacity != list->_page_capacity) {
+		size_t buffer_size = _free_list_buffer_size(list->_element_size, page_capacity, list->_flags);
+		if (buffer_size == 0) { return NULL; }
+		new_list = CC_CALLOC(buffer_size, 1);
+		if (!new_list) { return NULL; }
+		size_t old_size = _free_list_buffer_size(list->_element_size, list->_page_capacity, list->_flags);
+		memcpy_s(new_list, buffer_size, list, old_size);
+		new_list->_page_capacity = page_capacity;
+	}
+
+	// Append empty pages, undoing everything if one cannot be allocated
+	for(size_t i=old_pages; i<pages; ++i) {
+		_free_list_page_t* page = CC_CALLOC(1, _free_list_page_size(list->_element_size));
+		if (!page) {
+			for(size_t j=old_pages; j<i; ++j) {
+				CC_FREE(_free_list_page(new_list, j));
+			}
+			if (new_list != list) { CC_FREE(new_list); }
+			return NULL;
+		}
+		_free_list_page(new_list, i) = page;
+	}
+	new_list->_capacity = pages * FREE_LIST_PAGE_SIZE;
+	if (new_list != list) { CC_FREE(list); }
+	return new_list;
+}
+
+size_t _free_list_page_scan(free_list_t* list, size_t index, bool used) {
+	// Find the first index at or after the given one that is in use, or free
+	while(index < list->_capacity) {
+		size_t p = index / FREE_LIST_PAGE_SIZE;
+		size_t o = index % FREE_LIST_PAGE_SIZE;
+		_free_list_page_t* page = _free_list_page(list, p);
+
+		// Skip pages with nothing to find
+		if (page->_length != ((used) ? 0 : FREE_LIST_PAGE_SIZE)) {
+			for(size_t w=o/64; w<FREE_LIST_PAGE_SIZE/64; ++w) {
+				uint64_t bits = (used) ? page->_bits[w] : ~page->_bits[w];
+				if (w == o/64) { bits &= ~0ULL << (o % 64); }
+				if (bits) { return (p * FREE_LIST_PAGE_SIZE) + (w * 64) + CC_CTZ64(bits); }
+			}
+		}
+		index = (p + 1) * FREE_LIST_PAGE_SIZE;
+	}
+	return list->_capacity;
+}
+
+void* _free_list_get(free_list_t* list, size_t index) {
+	// Error check
+	if (!list || index >= list->_capacity || (list->_flags & FREE_LIST_FLAG_SLOT_MAP)) { return NULL; }
+
+	// Check the bit for the index
+	if (list->_flags & FREE_LIST_FLAG_PAGED) {
+		_free_list_page_t* page = _free_list_page(list, index / FREE_LIST_PAGE_SIZE);
+		size_t o = index % FREE_LIST_PAGE_SIZE;
+		return ((page->_bits[o / 64] >> (o % 64)) & 1) ? (void*)(page->_buffer + (o * list->_element_size)) : NULL;
+	}
+	return (_free_list_bit_get(list, index)) ? (void*)(_free_list_pos(list, index)) : NULL;
+}
+
 void* _free_list_insert(free_list_t** list, size_t* index, void* data) {
 	// Error check
-	if (!list || !(*list)) { goto free_list_insert_fail; }
+	if (!list || !(*list) || ((*list)->_flags & FREE_LIST_FLAG_SLOT_MAP)) { goto free_list_insert_fail; }
 	free_list_t* _list = *list;
-	if (_free_list_bit_get(_list, _list->_next_free)) { goto free_list_insert_fail; }
 
-	// Resize container
+	// Resize container, the next free slot is then the first new one
 	if (_list->_length >= _list->_capacity) {
 		free_list_t* temp = _free_list_resize(*list, 0);
 		if (!temp) { goto free_list_insert_fail; }
@@ -56,41 +186,254 @@ void* _free_list_insert(free_list_t** list, size_t* index, void* data) {
 		_list = temp;
 	}
 
+	// Paged lists fill in the page's bitmap & skip full pages when looking for the next free slot
+	if (_list->_flags & FREE_LIST_FLAG_PAGED) {
+		size_t i = _list->_next_free;
+		_free_list_page_t* page = _free_list_page(_list, i / FREE_LIST_PAGE_SIZE);
+		size_t o = i % FREE_LIST_PAGE_SIZE;
+		uint8_t* dest = page->_buffer + (o * _list->_element_size);
+		if (data) { memcpy_s(dest, _list->_element_size, data, _list->_element_size); }
+		page->_bits[o / 64] |= 1ULL << (o % 64);
+		page->_length++;
+		_list->_length++;
+		if (index) { *index = i; }
+		_list->_next_free = _free_list_page_scan(_list, i, false);
+		return (void*)dest;
+	}
+
 	// Add to empty slot
 	uint8_t* dest = _free_list_pos(_list, _list->_next_free);
 	size_t dest_size = _list->_element_size;
-	memcpy_s(dest, dest_size, data, dest_size);
+	if (data) { memcpy_s(dest, dest_size, data, dest_size); }
 	_free_list_bit_set(_list, _list->_next_free);
 	_list->_length++;
-	*index = _list->_next_free;
+	if (index) { *index = _list->_next_free; }
 
-	// Find the next free slot
-	for(size_t i=_list->_next_free; i<_list->_capacity; ++i) {
-		if (_free_list_bit_get(_list, i) == 0) {
-			_list->_next_free = i;
-			break;
-		}
-	}
+	// Find the next free slot, or point past the end if the list is full
+	size_t i = _list->_next_free;
+	while(i < _list->_capacity && _free_list_bit_get(_list, i)) { ++i; }
+	_list->_next_free = i;
 
 	return (void*)dest;
 free_list_insert_fail:
-	index = NULL;
+	if (index) { *index = SIZE_MAX; }
 	return NULL;
 }
 
 void _free_list_remove(free_list_t* list, size_t index, size_t count) {
 	// Error check
-	if (!list) { return; }
-	if ((index + count) > list->_length) { return; }
+	if (!list || (list->_flags & FREE_LIST_FLAG_SLOT_MAP)) { return; }
+	if (index > list->_capacity || count > list->_capacity - index) { return; }
 
-	// Flag spot as free
+	// Flag spots as free, only counting the ones in use
 	list->_next_free = CC_MIN(list->_next_free, index);
+	if (list->_flags & FREE_LIST_FLAG_PAGED) {
+		for(size_t i=index; i<index+count; ++i) {
+			_free_list_page_t* page = _free_list_page(list, i / FREE_LIST_PAGE_SIZE);
+			size_t o = i % FREE_LIST_PAGE_SIZE;
+			if ((page->_bits[o / 64] >> (o % 64)) & 1) {
+				page->_bits[o / 64] &= ~(1ULL << (o % 64));
+				page->_length--;
+				list->_length--;
+			}
+		}
+		return;
+	}
 	for(size_t i=0; i<count; ++i) {
-		_free_list_bit_clr(list, index+i);
+		if (_free_list_bit_get(list, (index + i))) {
+			_free_list_bit_clr(list, (index + i));
+			list->_length--;
+		}
+	}
+}
+
+free_list_handle_t _free_list_insert_handle(free_list_t** list, void* data) {
+	// Error check
+	if (!list || !(*list) || !((*list)->_flags & FREE_LIST_FLAG_SLOT_MAP)) { return FREE_LIST_INVALID_HANDLE; }
+	free_list_t* _list = *list;
+
+	// Resize container
+	if (_list->_length >= _list->_capacity) {
+		free_list_t* temp = _free_list_resize(*list, 0);
+		if (!temp) { return FREE_LIST_INVALID_HANDLE; }
+		(*list) = temp;
+		_list = temp;
+	}
+
+	// Take the first free slot & point it at the end of the packed array
+	uint32_t slot = (uint32_t)_list->_next_free;
+	_free_list_slot_t* s = &_free_list_slot(_list, slot);
+	_list->_next_free = s->_index;
+	s->_index = (uint32_t)_list->_length;
+	s->_generation++;
+
+	// Append the data
+	_free_list_dense_slot(_list, _list->_length) = slot;
+	memcpy_s(_free_list_dense_pos(_list, _list->_length), _list->_element_size, data, _list->_element_size);
+	_list->_length++;
+	return _free_list_handle(s->_generation, slot);
+}
+
+_free_list_slot_t* _free_list_lookup(free_list_t* list, free_list_handle_t handle) {
+	// Error check
+	if (!list || !(list->_flags & FREE_LIST_FLAG_SLOT_MAP)) { return NULL; }
+
+	// The slot must be live & of the same generation as the handle
+	uint32_t slot = (uint32_t)(handle & UINT32_MAX);
+	uint32_t generation = (uint32_t)(handle >> 32);
+	if (slot >= list->_capacity || !(generation & 1)) { return NULL; }
+	_free_list_slot_t* s = &_free_list_slot(list, slot);
+	return (s->_generation == generation) ? s : NULL;
+}
+
+void* _free_list_get_handle(free_list_t* list, free_list_handle_t handle) {
+	_free_list_slot_t* s = _free_list_lookup(list, handle);
+	return (s) ? (void*)(_free_list_dense_pos(list, s->_index)) : NULL;
+}
+
+bool _free_list_remove_handle(free_list_t* list, free_list_handle_t handle) {
+	// Error check
+	_free_list_slot_t* s = _free_list_lookup(list, handle);
+	if (!s) { return false; }
+
+	// Move the last packed element into the hole
+	size_t i = s->_index;
+	size_t last = list->_length - 1;
+	if (i != last) {
+		uint32_t moved = _free_list_dense_slot(list, last);
+		memcpy_s(_free_list_dense_pos(list, i), list->_element_size, _free_list_dense_pos(list, last), list->_element_size);
+		_free_list_dense_slot(list, i) = moved;
+		_free_list_slot(list, moved)._index = (uint32_t)i;
 	}
+	list->_length--;
 
-	// Decrement length
-	list->_length -= count;
+	// Retire the generation & push the slot onto the free chain
+	s->_generation++;
+	s->_index = (uint32_t)list->_next_free;
+	list->_next_free = (size_t)(handle & UINT32_MAX);
+	return true;
+}
+
+void _free_list_clear(free_list_t* list) {
+	// Error check
+	if (!list) { return; }
+
+	// Paged lists drop every page's bitmap
+	if (list->_flags & FREE_LIST_FLAG_PAGED) {
+		for(size_t i=0; i<list->_capacity / FREE_LIST_PAGE_SIZE; ++i) {
+			_free_list_page_t* page = _free_list_page(list, i);
+			memset(page->_bits, 0, sizeof page->_bits);
+			page->_length = 0;
+		}
+		list->_length = 0;
+		list->_next_free = 0;
+		return;
+	}
+
+	// Plain lists just drop the bitmap
+	if (!(list->_flags & FREE_LIST_FLAG_SLOT_MAP)) {
+		memset(&list->_buffer[0], 0, _free_list_bit_num(list));
+		list->_length = 0;
+		list->_next_free = 0;
+		return;
+	}
+
+	// Retire every live slot
+	for(size_t i=0; i<list->_length; ++i) {
+		uint32_t slot = _free_list_dense_slot(list, i);
+		_free_list_slot_t* s = &_free_list_slot(list, slot);
+		s->_generation++;
+		s->_index = (uint32_t)list->_next_free;
+		list->_next_free = slot;
+	}
+	list->_length = 0;
+}
+
+bool _free_list_compact(free_list_t** list, size_t** remap) {
+	// Error check
+	if (remap) { *remap = NULL; }
+	if (!list || !(*list)) { return false; }
+	free_list_t* _list = *list;
+	if (_list->_flags & FREE_LIST_FLAG_SLOT_MAP) { return true; }
+	size_t* table = NULL;
+	if (remap) {
+		table = CC_MALLOC(_list->_capacity * sizeof *table);
+		if (!table) { return false; }
+	}
+
+	// Slide live elements down over the holes in order
+	bool paged = (_list->_flags & FREE_LIST_FLAG_PAGED) != 0;
+	size_t count = 0;
+	for(size_t i=0; i<_list->_capacity; ++i) {
+		if (paged && (i % FREE_LIST_PAGE_SIZE) == 0 && _free_list_page(_list, i / FREE_LIST_PAGE_SIZE)->_length == 0) {
+			// Skip empty pages whole
+			if (table) {
+				for(size_t j=0; j<FREE_LIST_PAGE_SIZE; ++j) { table[i + j] = SIZE_MAX; }
+			}
+			i += FREE_LIST_PAGE_SIZE - 1;
+			continue;
+		}
+		void* src = _free_list_get(_list, i);
+		if (!src) {
+			if (table) { table[i] = SIZE_MAX; }
+			continue;
+		}
+		if (i != count) { memcpy_s(_free_list_index_pos(_list, count), _list->_element_size, src, _list->_element_size); }
+		if (table) { table[i] = count; }
+		count++;
+	}
+
+	// Rebuild the occupancy as a solid prefix
+	if (paged) {
+		for(size_t p=0; p<_list->_capacity / FREE_LIST_PAGE_SIZE; ++p) {
+			_free_list_page_t* page = _free_list_page(_list, p);
+			size_t used = (count > p * FREE_LIST_PAGE_SIZE) ? CC_MIN(count - (p * FREE_LIST_PAGE_SIZE), FREE_LIST_PAGE_SIZE) : 0;
+			memset(page->_bits, 0, sizeof page->_bits);
+			for(size_t w=0; w<used/64; ++w) { page->_bits[w] = ~0ULL; }
+			if (used % 64) { page->_bits[used/64] = (1ULL << (used % 64)) - 1; }
+			page->_length = used;
+		}
+	}
+	else {
+		memset(&_list->_buffer[0], 0, _free_list_bit_num(_list));
+		memset(&_list->_buffer[0], 0xFF, count / 8);
+		if (count % 8) { _list->_buffer[count / 8] = (uint8_t)((1 << (count % 8)) - 1); }
+	}
+	_list->_next_free = count;
+	if (remap) { *remap = table; }
+
+	// Free the pages past the packed prefix, keeping one
+	if (paged) {
+		size_t pages = CC_MAX((count / FREE_LIST_PAGE_SIZE) + ((count % FREE_LIST_PAGE_SIZE) != 0), (size_t)1);
+		for(size_t p=pages; p<_list->_capacity / FREE_LIST_PAGE_SIZE; ++p) {
+			CC_FREE(_free_list_page(_list, p));
+		}
+		_list->_capacity = pages * FREE_LIST_PAGE_SIZE;
+		return true;
+	}
+
+	// Move into a smaller block, keeping the compacted list if that fails
+	size_t c = CC_NEXT_POW2(CC_MAX(count, FREE_LIST_DEFAULT_CAPACITY));
+	if (c >= _list->_capacity) { return true; }
+	free_list_t* new_list = _free_list_factory(_list->_element_size, c, _list->_flags);
+	if (!new_list) { return true; }
+	memcpy_s(&new_list->_buffer[0], _free_list_bit_num(new_list), &_list->_buffer[0], _free_list_bit_num(new_list));
+	memcpy_s(_free_list_pos(new_list, 0), c * _list->_element_size, _free_list_pos(_list, 0), count * _list->_element_size);
+	new_list->_length = _list->_length;
+	new_list->_next_free = count;
+	CC_FREE(_list);
+	(*list) = new_list;
+	return true;
+}
+
+size_t _free_list_bytes(free_list_t* list) {
+	// Error check
+	if (!list) { return 0; }
+	if (!(list->_flags & FREE_LIST_FLAG_PAGED)) { return _free_list_buffer_size(list->_element_size, list->_capacity, list->_flags); }
+
+	// Page table plus every page
+	size_t pages = list->_capacity / FREE_LIST_PAGE_SIZE;
+	return _free_list_buffer_size(list->_element_size, list->_page_capacity, list->_flags) + (pages * _free_list_page_size(list->_element_size));
 }
 
 free_list_it_t* _free_list_it(free_list_t* list) {
@@ -105,16 +448,38 @@ free_list_it_t* _free_list_it(free_list_t* list) {
 	it->_list = list;
 
 	// Find first valid entry in list
-	_free_list_it_next(&it);
-	return it;
+	return _free_list_it_next(it);
 }
 
 free_list_it_t* _free_list_it_next(free_list_it_t* it) {
 	// Error check
 	if (!it) { return NULL; }
 
-	// Find the next valid position in the buffer
+	// Slot maps walk the packed array
 	free_list_t* _list = it->_list;
+	if (_list->_flags & FREE_LIST_FLAG_SLOT_MAP) {
+		it->index++;
+		if (it->index < _list->_length) {
+			it->data = (void*)(_free_list_dense_pos(_list, it->index));
+			it->handle = free_list_handle_at(_list, it->index);
+			return it;
+		}
+		CC_FREE(it);
+		return NULL;
+	}
+
+	// Paged lists jump over empty words & pages
+	if (_list->_flags & FREE_LIST_FLAG_PAGED) {
+		it->index = _free_list_page_scan(_list, it->index + 1, true);
+		if (it->index < _list->_capacity) {
+			it->data = (void*)(_free_list_page_pos(_list, it->index));
+			return it;
+		}
+		CC_FREE(it);
+		return NULL;
+	}
+
+	// Find the next valid position in the buffer
 	do {
 		// Increment index
 		it->index++;
@@ -133,4 +498,4 @@ free_list_it_t* _free_list_it_next(free_list_it_t* it) {
 
 	CC_FREE(it);
 	return NULL;
-}
\ No newline at end of file
+}
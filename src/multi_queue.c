@@ -0,0 +1,187 @@
+#include "cc/multi_queue.h"
+#include <string.h>
+#include <threads.h>
+
+static thread_local uint64_t _multi_queue_seed = 0;
+
+multi_queue_t* _multi_queue_factory(size_t element_size, size_t value_size, size_t count, size_t flags, priority_queue_compare_t compare) {
+	// Error check, every heap needs a second one to be compared against & handles or bounds make no sense across heaps
+	if (count < 2 || (flags & (PRIORITY_QUEUE_FLAG_INDEXED | PRIORITY_QUEUE_FLAG_BOUNDED))) { return NULL; }
+	if (count > (SIZE_MAX - sizeof(multi_queue_t) - MULTI_QUEUE_CACHE_LINE) / sizeof(_multi_queue_shard_t)) { return NULL; }
+
+	// The allocator only guarantees fundamental alignment, so round the queue up to a cache line inside a larger block
+	void* block = CC_CALLOC(1, sizeof(multi_queue_t) + (count * sizeof(_multi_queue_shard_t)) + MULTI_QUEUE_CACHE_LINE - 1);
+	if (!block) { return NULL; }
+	multi_queue_t* mq = (multi_queue_t*)(((uintptr_t)block + MULTI_QUEUE_CACHE_LINE - 1) & ~(uintptr_t)(MULTI_QUEUE_CACHE_LINE - 1));
+	mq->_block = block;
+	mq->_count = count;
+	mq->_element_size = element_size;
+	mq->_value_size = value_size;
+	atomic_init(&mq->_length, 0);
+
+	// Create one heap per shard
+	for(size_t i=0; i<count; ++i) {
+		_multi_queue_shard_t* shard = &mq->_shards[i];
+		atomic_flag_clear(&shard->_lock);
+		atomic_init(&shard->_length, 0);
+		shard->_qu = _priority_queue_factory(element_size, value_size, PRIORITY_QUEUE_DEFAULT_CAPACITY, flags, compare);
+		if (!shard->_qu) {
+			_multi_queue_destroy(mq);
+			return NULL;
+		}
+	}
+	return mq;
+}
+
+void _multi_queue_destroy(multi_queue_t* mq) {
+	// Error check
+	if (!mq) { return; }
+
+	// Deallocate every heap
+	for(size_t i=0; i<mq->_count; ++i) {
+		CC_FREE(mq->_shards[i]._qu);
+	}
+	CC_FREE(mq->_block);
+}
+
+size_t _multi_queue_random(size_t bound) {
+	// Seed each thread from the address of its own state
+	if (_multi_queue_seed == 0) {
+		_multi_queue_seed = ((uint64_t)(uintptr_t)&_multi_queue_seed * 0x9E3779B97F4A7C15ULL) | 1;
+	}
+
+	// xorshift64*, mapped onto the range with a multiply instead of a modulo
+	_multi_queue_seed ^= _multi_queue_seed >> 12;
+	_multi_queue_seed ^= _multi_queue_seed << 25;
+	_multi_queue_seed ^= _multi_queue_seed >> 27;
+	uint64_t r = (_multi_queue_seed * 0x2545F4914F6CDD1DULL) >> 32;
+	return (size_t)((r * (uint64_t)bound) >> 32);
+}
+
+bool _multi_queue_try_lock(_multi_queue_shard_t* shard) {
+	return !atomic_flag_test_and_set_explicit(&shard->_lock, memory_order_acquire);
+}
+
+void _multi_queue_lock(_multi_queue_shard_t* shard) {
+	while(atomic_flag_test_and_set_explicit(&shard->_lock, memory_order_acquire)) { thrd_yield(); }
+}
+
+void _multi_queue_unlock(_multi_queue_shard_t* shard) {
+	atomic_flag_clear_explicit(&shard->_lock, memory_order_release);
+}
+
+bool _multi_queue_insert(multi_queue_t* mq, const void* key, void* data) {
+	// Error check
+	if (!mq || !key || !data) { return false; }
+
+	// Push onto whichever random heap is free first
+	_multi_queue_shard_t* shard;
+	do {
+		shard = &mq->_shards[_multi_queue_random(mq->_count)];
+	} while(!_multi_queue_try_lock(shard));
+	bool result = _priority_queue_insert(&shard->_qu, key, data) != NULL;
+	if (result) {
+		atomic_fetch_add_explicit(&shard->_length, 1, memory_order_relaxed);
+		atomic_fetch_add_explicit(&mq->_length, 1, memory_order_relaxed);
+	}
+	_multi_queue_unlock(shard);
+	return result;
+}
+
+void _multi_queue_pop_shard(multi_queue_t* mq, _multi_queue_shard_t* shard, void* key, void* data) {
+	// Copy out the top of a locked, non-empty heap & remove it
+	priority_queue_t* qu = shard->_qu;
+	if (key) { memcpy_s(key, mq->_value_size, _priority_queue_value_pos(qu, 0), mq->_value_size); }
+	if (data) { memcpy_s(data, mq->_element_size, _priority_queue_data_pos(qu, 0), mq->_element_size); }
+	_priority_queue_remove_index(qu, 0);
+	atomic_fetch_sub_explicit(&shard->_length, 1, memory_order_relaxed);
+	atomic_fetch_sub_explicit(&mq->_length, 1, memory_order_relaxed);
+}
+
+bool _multi_queue_remove(multi_queue_t* mq, void* key, void* data) {
+	// Error check
+	if (!mq) { return false; }
+
+	size_t misses = 0;
+	while(atomic_load_explicit(&mq->_length, memory_order_relaxed) > 0) {
+		// Mostly empty queues rarely land on a busy heap by chance, so sweep them in order instead
+		if (misses >= mq->_count) {
+			for(size_t i=0; i<mq->_count; ++i) {
+				_multi_queue_shard_t* shard = &mq->_shards[i];
+				if (atomic_load_explicit(&shard->_length, memory_order_relaxed) == 0) { continue; }
+				_multi_queue_lock(shard);
+				if (shard->_qu->_length > 0) {
+					_multi_queue_pop_shard(mq, shard, key, data);
+					_multi_queue_unlock(shard);
+					return true;
+				}
+				_multi_queue_unlock(shard);
+			}
+			misses = 0;
+			thrd_yield();
+			continue;
+		}
+
+		// Pick two distinct heaps, skipping the pair if both look empty
+		size_t i = _multi_queue_random(mq->_count);
+		size_t j = _multi_queue_random(mq->_count - 1);
+		if (j >= i) { j++; }
+		_multi_queue_shard_t* a = &mq->_shards[i];
+		_multi_queue_shard_t* b = &mq->_shards[j];
+		if (atomic_load_explicit(&a->_length, memory_order_relaxed) == 0) {
+			_multi_queue_shard_t* t = a;
+			a = b;
+			b = t;
+		}
+		if (atomic_load_explicit(&a->_length, memory_order_relaxed) == 0 || !_multi_queue_try_lock(a)) {
+			misses++;
+			continue;
+		}
+
+		// Compare against the second top if that heap is free, otherwise settle for the first
+		if (atomic_load_explicit(&b->_length, memory_order_relaxed) > 0 && _multi_queue_try_lock(b)) {
+			if (b->_qu->_length > 0 && (a->_qu->_length == 0 || _priority_queue_before(a->_qu, _priority_queue_value_pos(b->_qu, 0), _priority_queue_value_pos(a->_qu, 0)))) {
+				_multi_queue_shard_t* t = a;
+				a = b;
+				b = t;
+			}
+			_multi_queue_unlock(b);
+		}
+		if (a->_qu->_length == 0) {
+			_multi_queue_unlock(a);
+			misses++;
+			continue;
+		}
+		_multi_queue_pop_shard(mq, a, key, data);
+		_multi_queue_unlock(a);
+		return true;
+	}
+	return false;
+}
+
+void _multi_queue_clear(multi_queue_t* mq) {
+	// Error check
+	if (!mq) { return; }
+
+	// Empty every heap under its lock
+	for(size_t i=0; i<mq->_count; ++i) {
+		_multi_queue_shard_t* shard = &mq->_shards[i];
+		_multi_queue_lock(shard);
+		atomic_fetch_sub_explicit(&mq->_length, shard->_qu->_length, memory_order_relaxed);
+		_priority_queue_remove(shard->_qu, shard->_qu->_length);
+		atomic_store_explicit(&shard->_length, 0, memory_order_relaxed);
+		_multi_queue_unlock(shard);
+	}
+}
+
+size_t _multi_queue_bytes(multi_queue_t* mq) {
+	// Error check
+	if (!mq) { return 0; }
+
+	size_t bytes = sizeof(multi_queue_t) + (mq->_count * sizeof(_multi_queue_shard_t)) + MULTI_QUEUE_CACHE_LINE - 1;
+	for(size_t i=0; i<mq->_count; ++i) {
+		priority_queue_t* qu = mq->_shards[i]._qu;
+		bytes += _priority_queue_size(qu->_element_size, qu->_value_size, qu->_capacity, qu->_flags);
+	}
+	return bytes;
+}
@@ -0,0 +1,231 @@
+#include "cc/object_pool.h"
+#include <string.h>
+
+object_pool_t* _object_pool_factory(size_t element_size) {
+	object_pool_t* pool = CC_CALLOC(1, sizeof *pool);
+	if (!pool) { return NULL; }
+	pool->_element_size = element_size;
+
+	// Objects live in a paged list so they never move, each behind a header
+	pool->_list = _free_list_factory(_object_pool_header_size + _object_pool_align(element_size), FREE_LIST_PAGE_SIZE, FREE_LIST_FLAG_PAGED);
+	if (!pool->_list) {
+		CC_FREE(pool);
+		return NULL;
+	}
+	if (mtx_init(&pool->_lock, mtx_plain) != thrd_success) {
+		_free_list_destroy(pool->_list);
+		CC_FREE(pool);
+		return NULL;
+	}
+	if (tss_create(&pool->_key, _object_pool_thread_exit) != thrd_success) {
+		mtx_destroy(&pool->_lock);
+		_free_list_destroy(pool->_list);
+		CC_FREE(pool);
+		return NULL;
+	}
+	return pool;
+}
+
+void _object_pool_destroy(object_pool_t* pool) {
+	// Error check
+	if (!pool) { return; }
+
+	// Deleting the key first keeps exiting threads from touching the caches
+	tss_delete(pool->_key);
+	_object_pool_cache_t* cache = pool->_caches;
+	while(cache) {
+		_object_pool_cache_t* next = cache->_next;
+		CC_FREE(cache);
+		cache = next;
+	}
+	mtx_destroy(&pool->_lock);
+	_free_list_destroy(pool->_list);
+	CC_FREE(pool);
+}
+
+_object_pool_cache_t* _object_pool_cache(object_pool_t* pool) {
+	// Fast path, the thread already has a cache
+	_object_pool_cache_t* cache = tss_get(pool->_key);
+	if (cache) { return cache; }
+
+	// Adopt a cache left behind by a thread that exited, or make a new one
+	mtx_lock(&pool->_lock);
+	for(cache = pool->_caches; cache && !cache->_abandoned; cache = cache->_next);
+	if (cache) {
+		// Fold the old thread's counters into the pool totals
+		pool->_retired.allocs += atomic_exchange_explicit(&cache->_allocs, 0, memory_order_relaxed);
+		pool->_retired.hits += atomic_exchange_explicit(&cache->_hits, 0, memory_order_relaxed);
+		pool->_retired.frees += atomic_exchange_explicit(&cache->_frees, 0, memory_order_relaxed);
+		pool->_retired.remote_frees += atomic_exchange_explicit(&cache->_remote_frees, 0, memory_order_relaxed);
+		cache->_abandoned = false;
+	}
+	else {
+		cache = CC_CALLOC(1, sizeof *cache);
+		if (cache) {
+			atomic_init(&cache->_remote, NULL);
+			cache->_pool = pool;
+			cache->_next = pool->_caches;
+			pool->_caches = cache;
+		}
+	}
+	if (cache && tss_set(pool->_key, cache) != thrd_success) {
+		// Leave it for another thread to adopt
+		cache->_abandoned = true;
+		cache = NULL;
+	}
+	mtx_unlock(&pool->_lock);
+	return cache;
+}
+
+void _object_pool_release(object_pool_t* pool, _object_pool_block_t* chain) {
+	// Return a chain of blocks to the shared list, the lock must be held
+	while(chain) {
+		_free_list_remove(pool->_list, chain->_index, 1);
+		chain = chain->_next;
+	}
+}
+
+void _object_pool_thread_exit(void* data) {
+	// Hand everything the thread held back to the shared list & leave the cache for adoption
+	_object_pool_cache_t* cache = data;
+	object_pool_t* pool = cache->_pool;
+	mtx_lock(&pool->_lock);
+	for(size_t i=0; i<cache->_count; ++i) {
+		_free_list_remove(pool->_list, cache->_blocks[i]->_index, 1);
+	}
+	cache->_count = 0;
+	_object_pool_release(pool, atomic_exchange_explicit(&cache->_remote, NULL, memory_order_acquire));
+	cache->_abandoned = true;
+	mtx_unlock(&pool->_lock);
+}
+
+bool _object_pool_refill(object_pool_t* pool, _object_pool_cache_t* cache) {
+	// Take back every object other threads freed in one swap
+	_object_pool_block_t* chain = atomic_exchange_explicit(&cache->_remote, NULL, memory_order_acquire);
+	while(chain && cache->_count < OBJECT_POOL_CACHE_SIZE) {
+		cache->_blocks[cache->_count++] = chain;
+		chain = chain->_next;
+	}
+	if (chain) {
+		mtx_lock(&pool->_lock);
+		_object_pool_release(pool, chain);
+		mtx_unlock(&pool->_lock);
+	}
+	if (cache->_count > 0) { return true; }
+
+	// Carve a batch from the shared list under one lock
+	mtx_lock(&pool->_lock);
+	for(size_t i=0; i<OBJECT_POOL_BATCH_SIZE; ++i) {
+		size_t index;
+		_object_pool_block_t* block = _free_list_insert(&pool->_list, &index, NULL);
+		if (!block) { break; }
+		block->_index = index;
+		cache->_blocks[cache->_count++] = block;
+	}
+	mtx_unlock(&pool->_lock);
+	return cache->_count > 0;
+}
+
+void* _object_pool_alloc(object_pool_t* pool) {
+	// Error check
+	if (!pool) { return NULL; }
+	_object_pool_cache_t* cache = _object_pool_cache(pool);
+	if (!cache) { return NULL; }
+
+	// Counters only have one writer, so plain load & store is enough, & a failed refill counts nothing
+	if (cache->_count > 0) {
+		atomic_store_explicit(&cache->_hits, atomic_load_explicit(&cache->_hits, memory_order_relaxed) + 1, memory_order_relaxed);
+	}
+	else if (!_object_pool_refill(pool, cache)) {
+		return NULL;
+	}
+	atomic_store_explicit(&cache->_allocs, atomic_load_explicit(&cache->_allocs, memory_order_relaxed) + 1, memory_order_relaxed);
+
+	// Pop from the cache & claim the block
+	_object_pool_block_t* block = cache->_blocks[--cache->_count];
+	block->_owner = cache;
+	return _object_pool_object(block);
+}
+
+void _object_pool_free(object_pool_t* pool, void* object) {
+	// Error check
+	if (!pool || !object) { return; }
+	_object_pool_block_t* block = _object_pool_block(object);
+	_object_pool_cache_t* cache = _object_pool_cache(pool);
+
+	// Blocks owned by another cache are pushed onto its remote stack
+	_object_pool_cache_t* owner = block->_owner;
+	if (owner != cache) {
+		_object_pool_block_t* head = atomic_load_explicit(&owner->_remote, memory_order_relaxed);
+		do {
+			block->_next = head;
+		} while(!atomic_compare_exchange_weak_explicit(&owner->_remote, &head, block, memory_order_release, memory_order_relaxed));
+		if (cache) {
+			atomic_store_explicit(&cache->_frees, atomic_load_explicit(&cache->_frees, memory_order_relaxed) + 1, memory_order_relaxed);
+			atomic_store_explicit(&cache->_remote_frees, atomic_load_explicit(&cache->_remote_frees, memory_order_relaxed) + 1, memory_order_relaxed);
+		}
+		return;
+	}
+	atomic_store_explicit(&cache->_frees, atomic_load_explicit(&cache->_frees, memory_order_relaxed) + 1, memory_order_relaxed);
+
+	// Spill the oldest batch to the shared list once the cache is full
+	if (cache->_count == OBJECT_POOL_CACHE_SIZE) {
+		mtx_lock(&pool->_lock);
+		for(size_t i=0; i<OBJECT_POOL_BATCH_SIZE; ++i) {
+			_free_list_remove(pool->_list, cache->_blocks[i]->_index, 1);
+		}
+		mtx_unlock(&pool->_lock);
+		cache->_count -= OBJECT_POOL_BATCH_SIZE;
+		memmove(&cache->_blocks[0], &cache->_blocks[OBJECT_POOL_BATCH_SIZE], cache->_count * sizeof(_object_pool_block_t*));
+	}
+	cache->_blocks[cache->_count++] = block;
+}
+
+void _object_pool_flush(object_pool_t* pool) {
+	// Error check
+	if (!pool) { return; }
+	_object_pool_cache_t* cache = tss_get(pool->_key);
+	if (!cache) { return; }
+
+	// Return the cache & any remote frees in one lock
+	_object_pool_block_t* chain = atomic_exchange_explicit(&cache->_remote, NULL, memory_order_acquire);
+	mtx_lock(&pool->_lock);
+	for(size_t i=0; i<cache->_count; ++i) {
+		_free_list_remove(pool->_list, cache->_blocks[i]->_index, 1);
+	}
+	_object_pool_release(pool, chain);
+	mtx_unlock(&pool->_lock);
+	cache->_count = 0;
+}
+
+void _object_pool_stats(object_pool_t* pool, object_pool_stats_t* stats, bool thread) {
+	// Error check
+	if (!pool || !stats) { return; }
+	memset(stats, 0, sizeof *stats);
+
+	// Sum the counters of the caches asked for
+	mtx_lock(&pool->_lock);
+	size_t allocs = pool->_retired.allocs;
+	size_t frees = pool->_retired.frees;
+	if (!thread) { *stats = pool->_retired; }
+	_object_pool_cache_t* self = tss_get(pool->_key);
+	for(_object_pool_cache_t* cache = pool->_caches; cache; cache = cache->_next) {
+		size_t a = atomic_load_explicit(&cache->_allocs, memory_order_relaxed);
+		size_t f = atomic_load_explicit(&cache->_frees, memory_order_relaxed);
+		allocs += a;
+		frees += f;
+		if (thread && cache != self) { continue; }
+		stats->allocs += a;
+		stats->hits += atomic_load_explicit(&cache->_hits, memory_order_relaxed);
+		stats->frees += f;
+		stats->remote_frees += atomic_load_explicit(&cache->_remote_frees, memory_order_relaxed);
+	}
+
+	// Everything carved from the list is either live or sitting free in a cache
+	stats->live = (allocs > frees) ? allocs - frees : 0;
+	stats->capacity = pool->_list->_capacity;
+	stats->cached = (pool->_list->_length > stats->live) ? pool->_list->_length - stats->live : 0;
+	mtx_unlock(&pool->_lock);
+	stats->hit_rate = (stats->allocs > 0) ? (double)stats->hits / (double)stats->allocs : 0.0;
+	stats->fragmentation = (stats->capacity > 0) ? 1.0 - ((double)stats->live / (double)stats->capacity) : 0.0;
+}
@@ -1,21 +1,37 @@
 #include "cc/priority_queue.h"
 #include <math.h>
 
-size_t _priority_queue_size(size_t element_size, size_t capacity) {
+size_t _priority_queue_size(size_t element_size, size_t value_size, size_t capacity, size_t flags) {
 	size_t c = element_size * capacity;
 	if (c / capacity != element_size) { return 0; }
-	size_t o = sizeof(priority_queue_value_t) * capacity;
-	if (c > SIZE_MAX - o) { return 0; }
-	return CC_MAX(sizeof(priority_queue_t), offsetof(priority_queue_t, _buffer) + o + c);
+	size_t o = value_size * capacity;
+	if (o / capacity != value_size || c > SIZE_MAX - o) { return 0; }
+	size_t i = _priority_queue_index_size(flags, capacity);
+	if (c + o > SIZE_MAX - i) { return 0; }
+	return CC_MAX(sizeof(priority_queue_t), offsetof(priority_queue_t, _buffer) + i + o + c);
 }
 
-priority_queue_t* _priority_queue_factory(size_t element_size, size_t capacity) {
-	size_t buffer_size = _priority_queue_size(element_size, capacity);
+priority_queue_t* _priority_queue_factory(size_t element_size, size_t value_size, size_t capacity, size_t flags, priority_queue_compare_t compare) {
+	// Custom keys need a comparison function
+	if (value_size == 0 || ((flags & _PRIORITY_QUEUE_KEY_MASK) == PRIORITY_QUEUE_KEY_CUSTOM && !compare)) { return NULL; }
+	if ((flags & PRIORITY_QUEUE_FLAG_INDEXED) && capacity > _PRIORITY_QUEUE_MAX_SLOTS) { return NULL; }
+	size_t buffer_size = _priority_queue_size(element_size, value_size, capacity, flags);
 	if (buffer_size == 0) { return NULL; }
 	priority_queue_t* qu = CC_CALLOC(1, buffer_size);
 	if (!qu) { return NULL; }
 	qu->_capacity = capacity;
 	qu->_element_size = element_size;
+	qu->_value_size = value_size;
+	qu->_flags = flags;
+	qu->_compare = compare;
+
+	// Every handle starts out free, parked in the heap slot of the same index
+	if (flags & PRIORITY_QUEUE_FLAG_INDEXED) {
+		for(size_t i=0; i<capacity; ++i) {
+			_priority_queue_heap_handle(qu, i) = i;
+			_priority_queue_handle_index(qu, i) = i;
+		}
+	}
 	return qu;
 }
 
@@ -25,39 +41,213 @@ priority_queue_t* _priority_queue_resize(priority_queue_t* qu, size_t new_capaci
 		size_t c = CC_NEXT_POW2(qu->_capacity + 1);
 		new_capacity = CC_MIN(c, PRIORITY_QUEUE_MAX_CAPACITY);
 	}
-	if (new_capacity > PRIORITY_QUEUE_MAX_CAPACITY || new_capacity < qu->_length) { return NULL; }
+	if (new_capacity > PRIORITY_QUEUE_MAX_CAPACITY || new_capacity <= qu->_length) { return NULL; }
+
+	// Handles index the old capacity, so indexed queues can only grow & must fit their slots in half a handle
+	if ((qu->_flags & PRIORITY_QUEUE_FLAG_INDEXED) && (new_capacity < qu->_capacity || new_capacity > _PRIORITY_QUEUE_MAX_SLOTS)) { return NULL; }
 
 	// Create new priority queue & copy data to it
-	priority_queue_t* new_qu = _priority_queue_factory(qu->_element_size, new_capacity);
+	priority_queue_t* new_qu = _priority_queue_factory(qu->_element_size, qu->_value_size, new_capacity, qu->_flags, qu->_compare);
 	if (!new_qu) { return NULL; }
-	size_t value_dest_size = qu->_capacity * sizeof(priority_queue_value_t);
+	size_t value_dest_size = qu->_length * qu->_value_size;
 	memcpy_s(_priority_queue_value_pos(new_qu, 0), value_dest_size, _priority_queue_value_pos(qu, 0), value_dest_size);
-	size_t data_dest_size = qu->_capacity * qu->_element_size;
+	size_t data_dest_size = qu->_length * qu->_element_size;
 	memcpy_s(_priority_queue_data_pos(new_qu, 0), data_dest_size, _priority_queue_data_pos(qu, 0), data_dest_size);
+	if (qu->_flags & PRIORITY_QUEUE_FLAG_INDEXED) {
+		size_t index_dest_size = qu->_capacity * sizeof(size_t);
+		memcpy_s(&_priority_queue_heap_handle(new_qu, 0), index_dest_size, &_priority_queue_heap_handle(qu, 0), index_dest_size);
+		memcpy_s(&_priority_queue_handle_index(new_qu, 0), index_dest_size, &_priority_queue_handle_index(qu, 0), index_dest_size);
+		memcpy_s(&_priority_queue_generation(new_qu, 0), index_dest_size, &_priority_queue_generation(qu, 0), index_dest_size);
+	}
 
 	new_qu->_length = qu->_length;
 	CC_FREE(qu);
-	_priority_queue_sort(new_qu);
 	return new_qu;
 }
 
-void* _priority_queue_insert(priority_queue_t** qu, priority_queue_value_t value, void* data) {
+priority_queue_t* _priority_queue_bounded(priority_queue_t* qu, size_t bound) {
+	// Error check
+	if (!qu) { return NULL; }
+	if (bound == 0 || qu->_length > 0) {
+		CC_FREE(qu);
+		return NULL;
+	}
+
+	// Size the queue for the bound up front so pushes never reallocate
+	size_t c = CC_NEXT_POW2(CC_MAX(bound + 1, PRIORITY_QUEUE_DEFAULT_CAPACITY));
+	if (c > qu->_capacity) {
+		priority_queue_t* temp = _priority_queue_resize(qu, CC_MIN(c, PRIORITY_QUEUE_MAX_CAPACITY));
+		if (!temp) {
+			CC_FREE(qu);
+			return NULL;
+		}
+		qu = temp;
+	}
+	qu->_flags |= PRIORITY_QUEUE_FLAG_BOUNDED;
+	qu->_bound = bound;
+	return qu;
+}
+
+priority_queue_t* _priority_queue_from_arrays(size_t element_size, size_t value_size, size_t flags, priority_queue_compare_t compare, const void* keys, const void* data, size_t count) {
+	// Error check
+	if ((count > 0 && (!keys || !data)) || count >= PRIORITY_QUEUE_MAX_CAPACITY) { return NULL; }
+
+	// Allocate room for every element plus the spare slot
+	size_t c = CC_MAX(count + 1, PRIORITY_QUEUE_DEFAULT_CAPACITY);
+	size_t capacity = CC_NEXT_POW2(c);
+	priority_queue_t* qu = _priority_queue_factory(element_size, value_size, CC_MIN(capacity, PRIORITY_QUEUE_MAX_CAPACITY), flags, compare);
+	if (!qu) { return NULL; }
+
+	// Copy both arrays in one go & heapify
+	memcpy_s(_priority_queue_value_pos(qu, 0), qu->_capacity * value_size, keys, count * value_size);
+	memcpy_s(_priority_queue_data_pos(qu, 0), qu->_capacity * element_size, data, count * element_size);
+	qu->_length = count;
+	_priority_queue_heapify(qu);
+	return qu;
+}
+
+bool _priority_queue_before(priority_queue_t* qu, const void* a, const void* b) {
+	// Compare built-in key types inline, only custom keys go through the comparison function
+	int c;
+	switch(_priority_queue_key_type(qu)) {
+	case PRIORITY_QUEUE_KEY_I32: {
+		int32_t x = *(const int32_t*)a, y = *(const int32_t*)b;
+		c = (x > y) - (x < y);
+		break;
+	}
+	case PRIORITY_QUEUE_KEY_I64: {
+		int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+		c = (x > y) - (x < y);
+		break;
+	}
+	case PRIORITY_QUEUE_KEY_U64: {
+		uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+		c = (x > y) - (x < y);
+		break;
+	}
+	case PRIORITY_QUEUE_KEY_F64: {
+		double x = *(const double*)a, y = *(const double*)b;
+		c = (x > y) - (x < y);
+		break;
+	}
+	default:
+		c = qu->_compare(a, b);
+		break;
+	}
+	// Bounded queues keep their worst element on top
+	bool min = (qu->_flags & PRIORITY_QUEUE_FLAG_MIN) != 0;
+	bool bounded = (qu->_flags & PRIORITY_QUEUE_FLAG_BOUNDED) != 0;
+	return (min != bounded) ? c < 0 : c > 0;
+}
+
+void _priority_queue_copy(priority_queue_t* qu, size_t dest, size_t src) {
+	// Copy the value & data of one slot into another
+	memcpy_s(_priority_queue_value_pos(qu, dest), qu->_value_size, _priority_queue_value_pos(qu, src), qu->_value_size);
+	memcpy_s(_priority_queue_data_pos(qu, dest), qu->_element_size, _priority_queue_data_pos(qu, src), qu->_element_size);
+}
+
+size_t _priority_queue_sift_up(priority_queue_t* qu, size_t i) {
+	// Nothing to do if the parent already comes first
+	if (i == 0 || !_priority_queue_before(qu, _priority_queue_value_pos(qu, i), _priority_queue_value_pos(qu, (i - 1) / 2))) { return i; }
+
+	// Lift the element into the spare slot past the end & move parents down into the hole
+	size_t spare = qu->_capacity - 1;
+	bool indexed = qu->_flags & PRIORITY_QUEUE_FLAG_INDEXED;
+	size_t handle = (indexed) ? _priority_queue_heap_handle(qu, i) : 0;
+	_priority_queue_copy(qu, spare, i);
+	while(i > 0) {
+		size_t parent = (i - 1) / 2;
+		if (!_priority_queue_before(qu, _priority_queue_value_pos(qu, spare), _priority_queue_value_pos(qu, parent))) { break; }
+		_priority_queue_copy(qu, i, parent);
+		if (indexed) {
+			_priority_queue_heap_handle(qu, i) = _priority_queue_heap_handle(qu, parent);
+			_priority_queue_handle_index(qu, _priority_queue_heap_handle(qu, i)) = i;
+		}
+		i = parent;
+	}
+
+	// Drop the element into the final hole
+	_priority_queue_copy(qu, i, spare);
+	if (indexed) {
+		_priority_queue_heap_handle(qu, i) = handle;
+		_priority_queue_handle_index(qu, handle) = i;
+	}
+	return i;
+}
+
+size_t _priority_queue_sift_down(priority_queue_t* qu, size_t i) {
+	// Nothing to do if neither child comes first
+	size_t child = 2 * i + 1;
+	if (child >= qu->_length) { return i; }
+	if (child + 1 < qu->_length && _priority_queue_before(qu, _priority_queue_value_pos(qu, child + 1), _priority_queue_value_pos(qu, child))) { child++; }
+	if (!_priority_queue_before(qu, _priority_queue_value_pos(qu, child), _priority_queue_value_pos(qu, i))) { return i; }
+
+	// Lift the element into the spare slot past the end & move children up into the hole
+	size_t spare = qu->_capacity - 1;
+	bool indexed = qu->_flags & PRIORITY_QUEUE_FLAG_INDEXED;
+	size_t handle = (indexed) ? _priority_queue_heap_handle(qu, i) : 0;
+	_priority_queue_copy(qu, spare, i);
+	while((child = 2 * i + 1) < qu->_length) {
+		if (child + 1 < qu->_length && _priority_queue_before(qu, _priority_queue_value_pos(qu, child + 1), _priority_queue_value_pos(qu, child))) { child++; }
+		if (!_priority_queue_before(qu, _priority_queue_value_pos(qu, child), _priority_queue_value_pos(qu, spare))) { break; }
+		_priority_queue_copy(qu, i, child);
+		if (indexed) {
+			_priority_queue_heap_handle(qu, i) = _priority_queue_heap_handle(qu, child);
+			_priority_queue_handle_index(qu, _priority_queue_heap_handle(qu, i)) = i;
+		}
+		i = child;
+	}
+
+	// Drop the element into the final hole
+	_priority_queue_copy(qu, i, spare);
+	if (indexed) {
+		_priority_queue_heap_handle(qu, i) = handle;
+		_priority_queue_handle_index(qu, handle) = i;
+	}
+	return i;
+}
+
+void _priority_queue_heapify(priority_queue_t* qu) {
+	// Floyd's construction, sifting down every parent from the last one up
+	for(size_t i = qu->_length / 2; i > 0; --i) {
+		_priority_queue_sift_down(qu, i - 1);
+	}
+}
+
+size_t _priority_queue_insert_index(priority_queue_t** qu, const void* key, void* data) {
 	// Error check
-	if (!qu || !(*qu)) { return NULL; }
+	if (!qu || !(*qu)) { return SIZE_MAX; }
 	priority_queue_t* _qu = *qu;
 
-	// Resize container
-	if (_qu->_length >= _qu->_capacity) {
+	// Full bounded queues replace their worst element, rejecting anything that would not beat it
+	if ((_qu->_flags & PRIORITY_QUEUE_FLAG_BOUNDED) && _qu->_length >= _qu->_bound) {
+		if (!_priority_queue_before(_qu, _priority_queue_value_pos(_qu, 0), key)) { return SIZE_MAX; }
+		memcpy_s(_priority_queue_value_pos(_qu, 0), _qu->_value_size, key, _qu->_value_size);
+		memcpy_s(_priority_queue_data_pos(_qu, 0), _qu->_element_size, data, _qu->_element_size);
+		if (_qu->_flags & PRIORITY_QUEUE_FLAG_INDEXED) {
+			// Retire the evicted handle & swap it with the free one parked past the end
+			size_t handle = _priority_queue_heap_handle(_qu, 0);
+			_priority_queue_generation(_qu, handle)++;
+			_priority_queue_heap_handle(_qu, 0) = _priority_queue_heap_handle(_qu, _qu->_length);
+			_priority_queue_handle_index(_qu, _priority_queue_heap_handle(_qu, 0)) = 0;
+			_priority_queue_heap_handle(_qu, _qu->_length) = handle;
+			_priority_queue_handle_index(_qu, handle) = _qu->_length;
+		}
+		return _priority_queue_sift_down(_qu, 0);
+	}
+
+	// Resize container, always keeping the last slot spare for sifting
+	if (_qu->_length + 1 >= _qu->_capacity) {
 		priority_queue_t* temp = _priority_queue_resize(_qu, 0);
-		if (!temp) { return NULL; }
+		if (!temp) { return SIZE_MAX; }
 		(*qu) = temp;
 		_qu = temp;
 	}
 
-	// Copy value to end
+	// Copy key to end
 	void* value_dest = (void*)(_priority_queue_value_pos(_qu, _qu->_length));
-	size_t value_dest_size = sizeof(priority_queue_value_t);
-	memcpy_s(value_dest, value_dest_size, &value, value_dest_size);
+	size_t value_dest_size = _qu->_value_size;
+	memcpy_s(value_dest, value_dest_size, key, value_dest_size);
 
 	// Copy data to end
 	void* data_dest = (void*)(_priority_queue_data_pos(_qu, _qu->_length));
@@ -65,126 +255,217 @@ void* _priority_queue_insert(priority_queue_t** qu, priority_queue_value_t value
 	memcpy_s(data_dest, data_dest_size, data, data_dest_size);
 	_qu->_length++;
 
-	// Sort list
-	_priority_queue_sort(_qu);
-	return _priority_queue_find(_qu, value, data);
+	// Restore heap order
+	return _priority_queue_sift_up(_qu, _qu->_length - 1);
 }
 
-void _priority_queue_remove(priority_queue_t* qu, size_t count) {
+void* _priority_queue_insert(priority_queue_t** qu, const void* key, void* data) {
+	size_t i = _priority_queue_insert_index(qu, key, data);
+	return (i != SIZE_MAX) ? _priority_queue_data_pos(*qu, i) : NULL;
+}
+
+priority_queue_handle_t _priority_queue_insert_handle(priority_queue_t** qu, const void* key, void* data) {
 	// Error check
-	if (!qu || qu->_length < count) { return; }
+	if (!qu || !(*qu) || !((*qu)->_flags & PRIORITY_QUEUE_FLAG_INDEXED)) { return PRIORITY_QUEUE_INVALID_HANDLE; }
 
-	// Decrement length
-	qu->_length -= count;
+	// The new element takes over the free handle parked in its slot
+	size_t i = _priority_queue_insert_index(qu, key, data);
+	return (i != SIZE_MAX) ? _priority_queue_slot_handle(*qu, _priority_queue_heap_handle(*qu, i)) : PRIORITY_QUEUE_INVALID_HANDLE;
 }
 
-void _priority_queue_remove_value(priority_queue_t* qu, priority_queue_value_t value, void* data) {
+bool _priority_queue_insert_n(priority_queue_t** qu, const void* keys, const void* data, size_t count) {
 	// Error check
-	if (!qu || qu->_length == 0) { return; }
+	if (!qu || !(*qu) || (count > 0 && (!keys || !data))) { return false; }
+	priority_queue_t* _qu = *qu;
+	if (count == 0) { return true; }
+	if (count >= PRIORITY_QUEUE_MAX_CAPACITY - _qu->_length) { return false; }
+
+	// Bounded queues filter every element against their cutoff
+	if (_qu->_flags & PRIORITY_QUEUE_FLAG_BOUNDED) {
+		const uint8_t* k = keys;
+		const uint8_t* d = data;
+		for(size_t i=0; i<count; ++i) {
+			_priority_queue_insert_index(qu, k + (i * _qu->_value_size), (void*)(d + (i * _qu->_element_size)));
+		}
+		return true;
+	}
 
-	size_t it = _priority_queue_find_index(qu, value, data);
-	if (it < qu->_capacity) {
-		// Shift value block
-		void* dest = (void*)(_priority_queue_value_pos(qu, it));
-		void* src = (void*)(_priority_queue_value_pos(qu, it + 1));
-		size_t move_size = ((qu->_capacity - it - 1) * sizeof(priority_queue_value_t)) + (qu->_capacity * qu->_element_size);
-		memmove_s(dest, move_size, src, move_size);
+	// Resize once for the whole batch, keeping the last slot spare
+	if (_qu->_length + count >= _qu->_capacity) {
+		size_t c = CC_NEXT_POW2(_qu->_length + count + 1);
+		priority_queue_t* temp = _priority_queue_resize(_qu, CC_MIN(c, PRIORITY_QUEUE_MAX_CAPACITY));
+		if (!temp) { return false; }
+		(*qu) = temp;
+		_qu = temp;
+	}
 
-		// Shift data block
-		dest = (void*)(_priority_queue_data_pos(qu, it));
-		src = (void*)(_priority_queue_data_pos(qu, it + 1));
-		move_size = (qu->_capacity - it - 1) * qu->_element_size;
-		memmove_s(dest, move_size, src, move_size);
+	// Append keys & data
+	size_t start = _qu->_length;
+	memcpy_s(_priority_queue_value_pos(_qu, start), (_qu->_capacity - start) * _qu->_value_size, keys, count * _qu->_value_size);
+	memcpy_s(_priority_queue_data_pos(_qu, start), (_qu->_capacity - start) * _qu->_element_size, data, count * _qu->_element_size);
+	_qu->_length += count;
 
-		qu->_length--;
+	// Rebuilding is linear, so it wins once the batch is as large as the existing heap
+	if (count >= start) {
+		_priority_queue_heapify(_qu);
 	}
+	else {
+		for(size_t i=start; i<_qu->_length; ++i) {
+			_priority_queue_sift_up(_qu, i);
+		}
+	}
+	return true;
+}
+
+bool _priority_queue_merge(priority_queue_t** qu, priority_queue_t* other) {
+	// Error check, merging a queue into itself would read from the block the resize frees
+	if (!qu || !(*qu) || !other || *qu == other) { return false; }
+	priority_queue_t* _qu = *qu;
+	size_t order_mask = _PRIORITY_QUEUE_KEY_MASK | PRIORITY_QUEUE_FLAG_MIN;
+	if (_qu->_element_size != other->_element_size || _qu->_value_size != other->_value_size ||
+		(_qu->_flags & order_mask) != (other->_flags & order_mask) || _qu->_compare != other->_compare) {
+		return false;
+	}
+
+	// The other queues key & data blocks are already contiguous
+	return _priority_queue_insert_n(qu, _priority_queue_value_pos(other, 0), _priority_queue_data_pos(other, 0), other->_length);
 }
 
-void _priority_queue_sort(priority_queue_t* qu) {
-	// Insertion sort
-	size_t dest_elem_size = qu->_element_size;
-	size_t dest_value_size = sizeof(priority_queue_value_t);
-	void* tmp_data = CC_MALLOC(qu->_element_size);
-	priority_queue_value_t tmp_value = 0;
-	for(size_t i=1; i<qu->_length; ++i) {
-		// Copy element to temp buffer
-		memcpy_s(tmp_data, dest_elem_size, _priority_queue_data_pos(qu, i), dest_elem_size);
-		tmp_value = _priority_queue_value(qu, i);
-
-		// Shift elements
-		size_t j=i;
-		for(; j > 0 && _priority_queue_value(qu, j-1) > tmp_value; --j) {
-			memcpy_s(_priority_queue_data_pos(qu, j), dest_elem_size, _priority_queue_data_pos(qu, j-1), dest_elem_size);
-			memcpy_s(_priority_queue_value_pos(qu, j), dest_value_size, _priority_queue_value_pos(qu, j-1), dest_value_size);
+void _priority_queue_remove_index(priority_queue_t* qu, size_t i) {
+	// Retire the removed handle so copies of it go stale
+	bool indexed = qu->_flags & PRIORITY_QUEUE_FLAG_INDEXED;
+	if (indexed) { _priority_queue_generation(qu, _priority_queue_heap_handle(qu, i))++; }
+
+	// Move the last element into the hole
+	size_t last = qu->_length - 1;
+	if (i != last) {
+		_priority_queue_copy(qu, i, last);
+		if (indexed) {
+			// Park the freed handle past the end
+			size_t handle = _priority_queue_heap_handle(qu, i);
+			_priority_queue_heap_handle(qu, i) = _priority_queue_heap_handle(qu, last);
+			_priority_queue_handle_index(qu, _priority_queue_heap_handle(qu, i)) = i;
+			_priority_queue_heap_handle(qu, last) = handle;
+			_priority_queue_handle_index(qu, handle) = last;
 		}
+	}
+	qu->_length--;
 
-		// Re-insert temp
-		memcpy_s(_priority_queue_data_pos(qu, j), dest_elem_size, tmp_data, dest_elem_size);
-		memcpy_s(_priority_queue_value_pos(qu, j), dest_value_size, &tmp_value, dest_value_size);
+	// Restore heap order
+	if (i < qu->_length && _priority_queue_sift_up(qu, i) == i) {
+		_priority_queue_sift_down(qu, i);
 	}
-	// Free temp buffer
-	CC_FREE(tmp_data);
 }
 
-size_t _priority_queue_find_index(priority_queue_t* qu, priority_queue_value_t value, void* data) {
-	// Binary search
-	size_t hi = qu->_length - 1;
-	size_t lo = 0;
-	size_t md = 0;
-	priority_queue_value_t hi_val = 0;
-	priority_queue_value_t lo_val = 0;
-	priority_queue_value_t md_val = 0;
-	size_t r = qu->_capacity;
-	do {
-		md = lo + (hi - lo) / 2;
-		hi_val = _priority_queue_value(qu, hi);
-		lo_val = _priority_queue_value(qu, lo);
-		md_val = _priority_queue_value(qu, md);
-		if (md_val == value) {
-			// Value found
-			r = md;
-			break;
-		}
-		else if (md_val < value) {
-			// Midpoint too low, move window up
-			lo = md + 1;
-		}
-		else {
-			// Midpoint too high, move window down
-			hi = md - 1;
+void _priority_queue_remove(priority_queue_t* qu, size_t count) {
+	// Error check
+	if (!qu || qu->_length < count) { return; }
+
+	// Clearing needs no reordering, only the live handles are retired
+	if (count == qu->_length) {
+		if (qu->_flags & PRIORITY_QUEUE_FLAG_INDEXED) {
+			for(size_t i=0; i<qu->_length; ++i) {
+				_priority_queue_generation(qu, _priority_queue_heap_handle(qu, i))++;
+			}
 		}
+		qu->_length = 0;
+		return;
 	}
-	while (hi != lo);
 
-	// Move to the start of a sequential run
-	while(r < (qu->_capacity - 1) && _priority_queue_value(qu, r+1) == _priority_queue_value(qu, r)) {
-		r++;
+	// Pop from the top
+	for(size_t i=0; i<count; ++i) {
+		_priority_queue_remove_index(qu, 0);
 	}
+}
 
-	// Check the run for matching data
-	if (data) {
-		do {
-			if (memcmp(_priority_queue_data_pos(qu, r), data, qu->_element_size) == 0) {
-				break;
-			}
-			if (r == 0 || _priority_queue_value(qu, r) != value) {
-				return qu->_capacity;
-			}
-			r--;
-		} while(1);
+size_t _priority_queue_drain(priority_queue_t* qu, void* keys, void* data) {
+	// Error check
+	if (!qu) { return 0; }
+
+	// Pop every element, filling bounded queues from the back since they pop worst first
+	size_t count = qu->_length;
+	bool reverse = (qu->_flags & PRIORITY_QUEUE_FLAG_BOUNDED) != 0;
+	uint8_t* k = keys;
+	uint8_t* d = data;
+	for(size_t i=0; i<count; ++i) {
+		size_t dest = (reverse) ? count - i - 1 : i;
+		if (k) { memcpy_s(k + (dest * qu->_value_size), qu->_value_size, _priority_queue_value_pos(qu, 0), qu->_value_size); }
+		if (d) { memcpy_s(d + (dest * qu->_element_size), qu->_element_size, _priority_queue_data_pos(qu, 0), qu->_element_size); }
+		_priority_queue_remove_index(qu, 0);
+	}
+	return count;
+}
+
+void _priority_queue_remove_value(priority_queue_t* qu, const void* key, void* data) {
+	// Error check
+	if (!qu || qu->_length == 0) { return; }
+
+	size_t it = _priority_queue_find_index(qu, key, data);
+	if (it < qu->_capacity) {
+		_priority_queue_remove_index(qu, it);
+	}
+}
+
+bool _priority_queue_contains(priority_queue_t* qu, priority_queue_handle_t handle) {
+	// Live handles sit in the first length slots of the heap & still carry their slots generation
+	if (!qu || !(qu->_flags & PRIORITY_QUEUE_FLAG_INDEXED)) { return false; }
+	size_t slot = _priority_queue_handle_slot(handle);
+	if (slot >= qu->_capacity || _priority_queue_slot_handle(qu, slot) != handle) { return false; }
+	return _priority_queue_handle_index(qu, slot) < qu->_length;
+}
+
+void _priority_queue_update(priority_queue_t* qu, priority_queue_handle_t handle, const void* key) {
+	// Error check
+	if (!_priority_queue_contains(qu, handle)) { return; }
+
+	// Overwrite the key & move the element whichever way it now belongs
+	size_t i = _priority_queue_handle_index(qu, _priority_queue_handle_slot(handle));
+	memcpy_s(_priority_queue_value_pos(qu, i), qu->_value_size, key, qu->_value_size);
+	if (_priority_queue_sift_up(qu, i) == i) {
+		_priority_queue_sift_down(qu, i);
 	}
-	return r;
 }
 
-void* _priority_queue_find(priority_queue_t* qu, priority_queue_value_t value, void* data) {
+void _priority_queue_remove_handle(priority_queue_t* qu, priority_queue_handle_t handle) {
+	// Error check
+	if (!_priority_queue_contains(qu, handle)) { return; }
+	_priority_queue_remove_index(qu, _priority_queue_handle_index(qu, _priority_queue_handle_slot(handle)));
+}
+
+void* _priority_queue_get(priority_queue_t* qu, priority_queue_handle_t handle) {
+	// Error check
+	if (!_priority_queue_contains(qu, handle)) { return NULL; }
+	return _priority_queue_data_pos(qu, _priority_queue_handle_index(qu, _priority_queue_handle_slot(handle)));
+}
+
+size_t _priority_queue_find_index(priority_queue_t* qu, const void* key, void* data) {
+	// Linear search, heap order only bounds keys along each path from the top
+	for(size_t i=0; i<qu->_length; ++i) {
+		void* k = _priority_queue_value_pos(qu, i);
+		if (_priority_queue_before(qu, k, key) || _priority_queue_before(qu, key, k)) { continue; }
+		if (!data || memcmp(_priority_queue_data_pos(qu, i), data, qu->_element_size) == 0) {
+			return i;
+		}
+	}
+	return qu->_capacity;
+}
+
+void* _priority_queue_find(priority_queue_t* qu, const void* key, void* data) {
 	// Error check
 	if (!qu || qu->_length == 0) { return NULL; }
 
-	// Binary search
-	size_t it = _priority_queue_find_index(qu, value, data);
+	size_t it = _priority_queue_find_index(qu, key, data);
 	return (it < qu->_capacity) ? _priority_queue_data_pos(qu, it) : NULL;
 }
 
+void _priority_queue_it_load(priority_queue_it_t* it) {
+	// Record the current positions data, key & int32 value
+	priority_queue_t* qu = it->_qu;
+	it->data = _priority_queue_data_pos(qu, it->_index);
+	it->key = _priority_queue_value_pos(qu, it->_index);
+	it->value = (_priority_queue_key_type(qu) == PRIORITY_QUEUE_KEY_I32) ? _priority_queue_value(qu, it->_index) : 0;
+}
+
 priority_queue_it_t* _priority_queue_it(priority_queue_t* qu, bool begin) {
 	// Error check
 	if (!qu || qu->_length == 0) { return NULL; }
@@ -194,17 +475,16 @@ priority_queue_it_t* _priority_queue_it(priority_queue_t* qu, bool begin) {
 	priority_queue_it_t* it = CC_CALLOC(1, buffer_size);
 	if (!it) { return NULL; }
 
-	// Find first valid entry in map
+	// Start at the top or the last slot of the heap
 	it->_qu = qu;
-	if (begin) { it->_index = (qu->_length - 1); }
-	else { it->_index = 0; }
-	it->data = _priority_queue_data_pos(qu, it->_index);
-	it->value = _priority_queue_value(qu, it->_index);
+	if (begin) { it->_index = 0; }
+	else { it->_index = (qu->_length - 1); }
+	_priority_queue_it_load(it);
 
 	return it;
 }
 
-priority_queue_it_t* _priority_queue_it_value(priority_queue_t* qu, priority_queue_value_t value) {
+priority_queue_it_t* _priority_queue_it_value(priority_queue_t* qu, const void* key) {
 	// Error check
 	if (!qu || qu->_length == 0) { return NULL; }
 
@@ -212,12 +492,13 @@ priority_queue_it_t* _priority_queue_it_value(priority_queue_t* qu, priority_que
 	size_t buffer_size = sizeof(priority_queue_it_t);
 	priority_queue_it_t* it = CC_CALLOC(1, buffer_size);
 	if (!it) { return NULL; }
-	it->_index = _priority_queue_find_index(qu, value, NULL);
+	it->_index = _priority_queue_find_index(qu, key, NULL);
 	if (it->_index == qu->_capacity) {
 		CC_FREE(it);
 		return NULL;
 	}
 	it->_qu = qu;
+	_priority_queue_it_load(it);
 	return it;
 }
 
@@ -227,11 +508,10 @@ priority_queue_it_t* _priority_queue_it_next(priority_queue_it_t* it) {
 
 	// Find the next valid position in the buffer
 	priority_queue_t* _qu = it->_qu;
-	if (it->_index > 0) {
+	if (it->_index + 1 < _qu->_length) {
 		// Record next positions data
-		it->_index--;
-		it->data = _priority_queue_data_pos(_qu, it->_index);
-		it->value = _priority_queue_value(_qu, it->_index);
+		it->_index++;
+		_priority_queue_it_load(it);
 		return it;
 	}
 	else {
@@ -245,13 +525,11 @@ priority_queue_it_t* _priority_queue_it_prev(priority_queue_it_t* it) {
 	// Error check
 	if (!it) { return NULL; }
 
-	// Find the next valid position in the buffer
-	priority_queue_t* _qu = it->_qu;
-	if (it->_index < _qu->_length) {
-		// Record next positions data
-		it->_index++;
-		it->data = _priority_queue_data_pos(_qu, it->_index);
-		it->value = _priority_queue_value(_qu, it->_index);
+	// Find the previous valid position in the buffer
+	if (it->_index > 0) {
+		// Record previous positions data
+		it->_index--;
+		_priority_queue_it_load(it);
 		return it;
 	}
 	else {
@@ -264,8 +542,15 @@ priority_queue_it_t* _priority_queue_it_prev(priority_queue_it_t* it) {
 #define strappend(dest, dest_size, dest_len, src) \
 do { \
 	size_t _src_len_ = strlen(src); \
+	while (dest_len + _src_len_ + 1 > dest_size) { \
+		char* _dest_temp_ = CC_REALLOC(dest, dest_size * 2); \
+		if (!_dest_temp_) { goto _priority_queue_print_fail; } \
+		dest = _dest_temp_; \
+		dest_size *= 2; \
+	} \
 	memcpy_s(dest + dest_len, dest_size - dest_len, src, _src_len_); \
 	dest_len += _src_len_; \
+	dest[dest_len] = '\0'; \
 } while(0)
 
 char* _priority_queue_print(priority_queue_t* qu) {
@@ -286,28 +571,27 @@ char* _priority_queue_print(priority_queue_t* qu) {
 	// Iterate through container
 	memcpy_s(buff, buff_size, "[", 1);
 	buff_len = 1;
-	for(priority_queue_it_t* it = priority_queue_it_begin(qu); it; priority_queue_it_next(it)) {
-		// Print value
-		char value_buff[16];
-		sprintf_s(value_buff, 16, "%d", it->value);
+	for(priority_queue_it_t* it = priority_queue_it_begin(qu); it; it = priority_queue_it_next(it)) {
+		// Print key
+		char value_buff[32];
+		switch(_priority_queue_key_type(qu)) {
+		case PRIORITY_QUEUE_KEY_I32: sprintf_s(value_buff, 32, "%d", it->value); break;
+		case PRIORITY_QUEUE_KEY_I64: sprintf_s(value_buff, 32, "%lld", (long long)*(int64_t*)it->key); break;
+		case PRIORITY_QUEUE_KEY_U64: sprintf_s(value_buff, 32, "%llu", (unsigned long long)*(uint64_t*)it->key); break;
+		case PRIORITY_QUEUE_KEY_F64: sprintf_s(value_buff, 32, "%g", *(double*)it->key); break;
+		default: sprintf_s(value_buff, 32, "?"); break;
+		}
 		strappend(buff, buff_size, buff_len, value_buff);
 		strappend(buff, buff_size, buff_len, ":");
 
 		// Print data
 		char data_buff[32];
-		long data = *(long*)(it->data);
+		long data = 0;
+		memcpy_s(&data, sizeof data, it->data, CC_MIN(qu->_element_size, sizeof data));
 		sprintf_s(data_buff, 32, "%d", data);
 		strappend(buff, buff_size, buff_len, "0x");
 		strappend(buff, buff_size, buff_len, data_buff);
 		strappend(buff, buff_size, buff_len, ", ");
-
-		// Reisze buffer if needed
-		if (buff_len > (buff_size / 2)) {
-			buff_size *= 2;
-			char* buff_temp = realloc(buff, buff_size);
-			if (!buff_temp) {  goto _priority_queue_print_fail; }
-			buff = buff_temp;
-		}
 	}
 
 	// Finish string
@@ -315,7 +599,6 @@ char* _priority_queue_print(priority_queue_t* qu) {
 	sprintf_s(count_buff, 16, "%d", (int)qu->_length);
 	strappend(buff, buff_size, buff_len, "]");
 	strappend(buff, buff_size, buff_len, count_buff);
-	strappend(buff, buff_size, buff_len, "\0");
 
 	return buff;
 _priority_queue_print_fail:
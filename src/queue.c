@@ -25,24 +25,19 @@ queue_t* _queue_resize(queue_t* qu, size_t new_capacity) {
 	}
 	if (new_capacity > QUEUE_MAX_CAPACITY || new_capacity < qu->_length) { return NULL; }
 
-	// Create new queue & copy data to it
+	// Create new queue & copy data to it, in two parts if it wraps around the circular buffer
 	queue_t* new_qu = _queue_factory(qu->_element_size, new_capacity);
 	if (!new_qu) { return NULL; }
-	if (qu->_tail <= qu->_head) {
-		// Queue wraps around circular buffer, copy in two parts
-		size_t _qu_end = (qu->_capacity - qu->_head);
-		size_t dest_size_start = _qu_end * qu->_element_size;
-		size_t dest_size_end = (qu->_length - _qu_end) * qu->_element_size;
-		memcpy_s(_queue_pos(new_qu, 0), dest_size_start, _queue_pos(qu, qu->_head), dest_size_start);
-		memcpy_s(_queue_pos(new_qu, _qu_end), dest_size_end, _queue_pos(qu, 0), dest_size_end);
-	}
-	else {
-		// Queue is contained in circular buffer, one copy will get everything
-		size_t dest_size = qu->_length * qu->_element_size;
-		memcpy_s(new_qu->_buffer, dest_size, _queue_pos(qu, qu->_head), dest_size);
+	queue_span_t spans[2];
+	size_t n = _queue_spans(qu, spans);
+	size_t offset = 0;
+	for(size_t i=0; i<n; ++i) {
+		size_t dest_size = spans[i].count * qu->_element_size;
+		memcpy_s(_queue_pos(new_qu, offset), dest_size, spans[i].data, dest_size);
+		offset += spans[i].count;
 	}
 	new_qu->_head = 0;
-	new_qu->_tail = qu->_length;
+	new_qu->_tail = qu->_length % new_capacity;
 	new_qu->_length = qu->_length;
 	CC_FREE(qu);
 	return new_qu;
@@ -70,12 +65,55 @@ void* _queue_insert(queue_t** qu, void* data) {
 	return dest;
 }
 
-void _queue_remove(queue_t* qu, size_t count) {
+bool _queue_insert_n(queue_t** qu, void* data, size_t count) {
+	// Error check
+	if (!qu || !(*qu) || (!data && count > 0)) { return false; }
+	queue_t* _qu = *qu;
+	if (count > QUEUE_MAX_CAPACITY - _qu->_length) { return false; }
+
+	// Resize container
+	if (_qu->_length + count > _qu->_capacity) {
+		size_t c = CC_NEXT_POW2(_qu->_length + count);
+		queue_t* temp = _queue_resize(_qu, CC_MIN(c, QUEUE_MAX_CAPACITY));
+		if (!temp) { return false; }
+		(*qu) = temp;
+		_qu = temp;
+	}
+
+	// Append to tail, in two parts if it wraps around the circular buffer
+	size_t first = CC_MIN(count, _qu->_capacity - _qu->_tail);
+	size_t dest_size = first * _qu->_element_size;
+	memcpy_s(_queue_pos(_qu, _qu->_tail), dest_size, data, dest_size);
+	if (first < count) {
+		dest_size = (count - first) * _qu->_element_size;
+		memcpy_s(_queue_pos(_qu, 0), dest_size, (uint8_t*)data + (first * _qu->_element_size), dest_size);
+	}
+	_qu->_tail = (_qu->_tail + count) % _qu->_capacity;
+	_qu->_length += count;
+	return true;
+}
+
+size_t _queue_spans(queue_t* qu, queue_span_t* spans) {
+	// Error check
+	if (!qu || !spans || qu->_length == 0) { return 0; }
+
+	// Split at the end of the circular buffer
+	size_t first = CC_MIN(qu->_length, qu->_capacity - qu->_head);
+	spans[0].data = _queue_pos(qu, qu->_head);
+	spans[0].count = first;
+	if (first == qu->_length) { return 1; }
+	spans[1].data = _queue_pos(qu, 0);
+	spans[1].count = qu->_length - first;
+	return 2;
+}
+
+size_t _queue_remove(queue_t* qu, size_t count) {
 	// Error check
-	if (!qu || qu->_length < count) { return; }
+	if (!qu) { return 0; }
+	count = CC_MIN(count, qu->_length);
 
 	// Increment head
-	size_t new_head = (qu->_head + count) % qu->_capacity;
-	qu->_head = (qu->_head <= qu->_tail && new_head > qu->_tail) ? qu->_tail : new_head;
+	qu->_head = (qu->_head + count) % qu->_capacity;
 	qu->_length -= count;
+	return count;
 }
\ No newline at end of file
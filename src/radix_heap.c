@@ -0,0 +1,125 @@
+#include "cc/radix_heap.h"
+#include <string.h>
+
+radix_heap_t* _radix_heap_factory(size_t element_size) {
+	radix_heap_t* qu = CC_CALLOC(1, sizeof *qu);
+	if (!qu) { return NULL; }
+	qu->_element_size = element_size;
+	return qu;
+}
+
+void _radix_heap_destroy(radix_heap_t* qu) {
+	// Error check
+	if (!qu) { return; }
+
+	// Deallocate all buckets
+	for(size_t i=0; i<RADIX_HEAP_NUM_BUCKETS; ++i) {
+		CC_FREE(qu->_buckets[i]._keys);
+		CC_FREE(qu->_buckets[i]._data);
+	}
+	CC_FREE(qu);
+}
+
+int _radix_heap_reserve(radix_heap_t* qu, size_t bucket, size_t count) {
+	// Check if the bucket already has room
+	_radix_heap_bucket_t* b = &qu->_buckets[bucket];
+	if (b->_length + count <= b->_capacity) { return 1; }
+
+	// Grow the key & data arrays geometrically
+	size_t capacity = CC_MAX(b->_capacity, RADIX_HEAP_BUCKET_DEFAULT_CAPACITY);
+	while(capacity < b->_length + count) { capacity *= 2; }
+	priority_queue_value_t* keys = CC_REALLOC(b->_keys, capacity * sizeof *keys);
+	if (!keys) { return 0; }
+	b->_keys = keys;
+	uint8_t* data = CC_REALLOC(b->_data, capacity * qu->_element_size);
+	if (!data) { return 0; }
+	b->_data = data;
+	b->_capacity = capacity;
+	return 1;
+}
+
+void* _radix_heap_insert(radix_heap_t* qu, priority_queue_value_t value, void* data) {
+	// Error check
+	if (!qu) { return NULL; }
+
+	// An empty heap restarts at the new value, otherwise values may not go below the last one popped
+	if (qu->_length == 0) { qu->_last = value; }
+	else if (value < qu->_last) { return NULL; }
+
+	// Append to the bucket of the highest bit that differs from the last popped value
+	size_t bucket = _radix_heap_bucket(qu->_last, value);
+	if (!_radix_heap_reserve(qu, bucket, 1)) { return NULL; }
+	_radix_heap_bucket_t* b = &qu->_buckets[bucket];
+	b->_keys[b->_length] = value;
+	void* dest = _radix_heap_data_pos(qu, bucket, b->_length);
+	memcpy_s(dest, qu->_element_size, data, qu->_element_size);
+	b->_length++;
+	qu->_length++;
+	return dest;
+}
+
+bool _radix_heap_refill(radix_heap_t* qu) {
+	// Find the lowest non-empty bucket
+	size_t bucket = 1;
+	while(bucket < RADIX_HEAP_NUM_BUCKETS && qu->_buckets[bucket]._length == 0) { bucket++; }
+	if (bucket == RADIX_HEAP_NUM_BUCKETS) { return true; }
+	_radix_heap_bucket_t* b = &qu->_buckets[bucket];
+
+	// Its minimum becomes the new last value
+	priority_queue_value_t last = b->_keys[0];
+	for(size_t i=1; i<b->_length; ++i) {
+		if (b->_keys[i] < last) { last = b->_keys[i]; }
+	}
+
+	// Reserve room in the lower buckets first so redistribution cannot fail halfway
+	size_t counts[RADIX_HEAP_NUM_BUCKETS] = { 0 };
+	for(size_t i=0; i<b->_length; ++i) {
+		counts[_radix_heap_bucket(last, b->_keys[i])]++;
+	}
+	for(size_t i=0; i<bucket; ++i) {
+		if (counts[i] && !_radix_heap_reserve(qu, i, counts[i])) { return false; }
+	}
+
+	// Every element moves to a strictly lower bucket
+	qu->_last = last;
+	for(size_t i=0; i<b->_length; ++i) {
+		size_t dest = _radix_heap_bucket(last, b->_keys[i]);
+		_radix_heap_bucket_t* d = &qu->_buckets[dest];
+		d->_keys[d->_length] = b->_keys[i];
+		memcpy_s(_radix_heap_data_pos(qu, dest, d->_length), qu->_element_size, _radix_heap_data_pos(qu, bucket, i), qu->_element_size);
+		d->_length++;
+	}
+	b->_length = 0;
+	return true;
+}
+
+bool _radix_heap_remove(radix_heap_t* qu) {
+	// Error check
+	if (!qu || qu->_length == 0) { return false; }
+
+	// Make sure the top bucket holds the minimum
+	if (qu->_buckets[0]._length == 0) {
+		if (!_radix_heap_refill(qu) || qu->_buckets[0]._length == 0) { return false; }
+	}
+	qu->_buckets[0]._length--;
+	qu->_length--;
+
+	// Keep the next minimum ready for the top macros, putting the element back if that fails
+	if (qu->_buckets[0]._length == 0 && qu->_length > 0 && !_radix_heap_refill(qu)) {
+		qu->_buckets[0]._length++;
+		qu->_length++;
+		return false;
+	}
+	return true;
+}
+
+void _radix_heap_clear(radix_heap_t* qu) {
+	// Error check
+	if (!qu) { return; }
+
+	// Keep bucket storage for reuse
+	for(size_t i=0; i<RADIX_HEAP_NUM_BUCKETS; ++i) {
+		qu->_buckets[i]._length = 0;
+	}
+	qu->_length = 0;
+}
@@ -1,23 +1,49 @@
 #include "cc/stack.h"
 #include <math.h>
 
-size_t _stack_size(size_t element_size, size_t capacity) {
+size_t _stack_size(size_t element_size, size_t capacity, size_t flags) {
+	// Segmented stacks keep their elements out of line
+	if (flags & STACK_FLAG_SEGMENTED) { return sizeof(stack_t); }
 	size_t c = element_size * capacity;
 	if (c / capacity != element_size) { return 0; }
 	return CC_MAX(sizeof(stack_t), offsetof(stack_t, _buffer) + c);
 }
 
-stack_t* _stack_factory(size_t element_size, size_t capacity) {
-	size_t buffer_size = _stack_size(element_size, capacity); 
+stack_t* _stack_factory(size_t element_size, size_t capacity, size_t flags) {
+	size_t buffer_size = _stack_size(element_size, capacity, flags); 
 	if (buffer_size == 0) { return NULL; }
 	stack_t* stk = CC_CALLOC(1, buffer_size);
 	if (!stk) { return NULL; }
 	stk->_capacity = capacity;
 	stk->_element_size = element_size;
+	stk->_flags = flags;
+
+	// Segments are allocated on the first push
+	if (flags & STACK_FLAG_SEGMENTED) {
+		stk->_capacity = 0;
+		stk->_segment_length = CC_MAX(STACK_SEGMENT_BYTES / CC_MAX(element_size, (size_t)1), (size_t)1);
+	}
 	return stk;
 }
 
+void _stack_destroy(stack_t* stk) {
+	// Error check
+	if (!stk) { return; }
+
+	// Deallocate the live segments & the spare
+	while(stk->_top) {
+		_stack_segment_t* prev = stk->_top->_prev;
+		CC_FREE(stk->_top);
+		stk->_top = prev;
+	}
+	CC_FREE(stk->_spare);
+	CC_FREE(stk);
+}
+
 stack_t* _stack_resize(stack_t* stk, size_t new_capacity) {
+	// Segmented stacks grow a segment at a time in _stack_insert
+	if (stk->_flags & STACK_FLAG_SEGMENTED) { return NULL; }
+
 	// Calculate new capacity
 	if (new_capacity == 0) {
 		size_t c = CC_NEXT_POW2(stk->_capacity + 1);
@@ -26,7 +52,7 @@ stack_t* _stack_resize(stack_t* stk, size_t new_capacity) {
 	if (new_capacity > STACK_MAX_CAPACITY || new_capacity < stk->_length) { return NULL; }
 
 	// Create new stack & copy data to it
-	stack_t* new_stk = _stack_factory(stk->_element_size, new_capacity);
+	stack_t* new_stk = _stack_factory(stk->_element_size, new_capacity, stk->_flags);
 	if (!new_stk) { return NULL; }
 	size_t dest_size = stk->_length * stk->_element_size;
 	memcpy_s(new_stk->_buffer, dest_size, stk->_buffer, dest_size);
@@ -37,21 +63,42 @@ stack_t* _stack_resize(stack_t* stk, size_t new_capacity) {
 
 void* _stack_insert(stack_t** stk, void* data) {
 	// Error check
-	if (!stk || !(*stk) || !data) { return NULL; }
+	if (!stk || !(*stk)) { return NULL; }
 	stack_t* _stk = *stk;
 
-	// Resize container
-	if (_stk->_length >= _stk->_capacity) {
-		stack_t* temp = _stack_resize(_stk, 0);
-		if (!temp) { return NULL; }
-		(*stk) = temp;
-		_stk = temp;
+	void* dest;
+	if (_stk->_flags & STACK_FLAG_SEGMENTED) {
+		// Link a new segment on top once the current one is full, reusing the spare first
+		if (_stk->_length == _stk->_capacity) {
+			if (_stk->_capacity > STACK_MAX_CAPACITY - _stk->_segment_length) { return NULL; }
+			_stack_segment_t* seg = _stk->_spare;
+			if (seg) { _stk->_spare = NULL; }
+			else {
+				seg = CC_MALLOC(_stack_segment_size(_stk));
+				if (!seg) { return NULL; }
+			}
+			seg->_prev = _stk->_top;
+			_stk->_top = seg;
+			_stk->_capacity += _stk->_segment_length;
+		}
+		dest = (void*)(_stack_segment_pos(_stk, _stk->_length));
+	}
+	else {
+		// Resize container
+		if (_stk->_length >= _stk->_capacity) {
+			stack_t* temp = _stack_resize(_stk, 0);
+			if (!temp) { return NULL; }
+			(*stk) = temp;
+			_stk = temp;
+		}
+		dest = (void*)(_stack_pos(_stk, _stk->_length));
 	}
 
 	// Copy element
-	void* dest = (void*)(_stack_pos(_stk, _stk->_length));
-	size_t dest_size = _stk->_element_size;
-	memcpy_s(dest, dest_size, data, dest_size);
+	if (data) {
+		size_t dest_size = _stk->_element_size;
+		memcpy_s(dest, dest_size, data, dest_size);
+	}
 	_stk->_length++;
 	return dest;
 }
@@ -62,4 +109,34 @@ void _stack_remove(stack_t* stk, size_t count) {
 
 	// Decrement _length
 	stk->_length -= count;
-}
\ No newline at end of file
+	if (!(stk->_flags & STACK_FLAG_SEGMENTED)) { return; }
+
+	// Unlink the segments left empty, keeping one around so pushing & popping across a boundary doesn't thrash
+	while(stk->_top && stk->_capacity - stk->_segment_length >= stk->_length) {
+		_stack_segment_t* seg = stk->_top;
+		stk->_top = seg->_prev;
+		stk->_capacity -= stk->_segment_length;
+		if (!stk->_spare) { stk->_spare = seg; }
+		else { CC_FREE(seg); }
+	}
+}
+
+bool _stack_rewind(stack_t* stk, size_t mark) {
+	// Error check
+	if (!stk || mark > stk->_length) { return false; }
+
+	// Drop everything above the mark at once
+	_stack_remove(stk, stk->_length - mark);
+	return true;
+}
+
+size_t _stack_bytes(stack_t* stk) {
+	// Error check
+	if (!stk) { return 0; }
+	size_t bytes = _stack_size(stk->_element_size, stk->_capacity, stk->_flags);
+	if (!(stk->_flags & STACK_FLAG_SEGMENTED)) { return bytes; }
+
+	// Add the live segments & the spare
+	size_t segments = (stk->_capacity / stk->_segment_length) + ((stk->_spare) ? 1 : 0);
+	return bytes + (segments * _stack_segment_size(stk));
+}
@@ -0,0 +1,302 @@
+#include "cc/timing_wheel.h"
+#include <string.h>
+#include <math.h>
+
+size_t _timing_wheel_size(size_t element_size, size_t capacity) {
+	size_t stride = _timing_wheel_stride(element_size);
+	size_t c = stride * capacity;
+	if (c / capacity != stride) { return 0; }
+	if (c > SIZE_MAX - offsetof(timing_wheel_t, _buffer)) { return 0; }
+	return offsetof(timing_wheel_t, _buffer) + c;
+}
+
+timing_wheel_t* _timing_wheel_factory(size_t element_size, size_t capacity, uint64_t now) {
+	if (capacity == 0 || capacity > TIMING_WHEEL_MAX_CAPACITY) { return NULL; }
+	size_t buffer_size = _timing_wheel_size(element_size, capacity);
+	if (buffer_size == 0) { return NULL; }
+	timing_wheel_t* wheel = CC_CALLOC(1, buffer_size);
+	if (!wheel) { return NULL; }
+	wheel->_element_size = element_size;
+	wheel->_now = now;
+	_timing_wheel_clear(wheel);
+	wheel->_capacity = capacity;
+
+	// Chain every record onto the free list
+	for(size_t i=0; i<capacity; ++i) {
+		_timing_wheel_entry_t* entry = _timing_wheel_entry(wheel, i);
+		entry->_slot = _TIMING_WHEEL_FREE;
+		entry->_next = (i + 1 < capacity) ? (uint32_t)(i + 1) : _TIMING_WHEEL_NIL;
+	}
+	wheel->_free = 0;
+	return wheel;
+}
+
+timing_wheel_t* _timing_wheel_resize(timing_wheel_t* wheel, size_t new_capacity) {
+	// Calculate new capacity
+	if (new_capacity == 0) {
+		size_t c = CC_NEXT_POW2(wheel->_capacity + 1);
+		new_capacity = CC_MIN(c, TIMING_WHEEL_MAX_CAPACITY);
+	}
+	if (new_capacity > TIMING_WHEEL_MAX_CAPACITY || new_capacity <= wheel->_capacity) { return NULL; }
+
+	// Records are addressed by index, so the block can move
+	size_t buffer_size = _timing_wheel_size(wheel->_element_size, new_capacity);
+	if (buffer_size == 0) { return NULL; }
+	timing_wheel_t* new_wheel = CC_REALLOC(wheel, buffer_size);
+	if (!new_wheel) { return NULL; }
+
+	// Chain the new records onto the free list
+	for(size_t i=new_wheel->_capacity; i<new_capacity; ++i) {
+		_timing_wheel_entry_t* entry = _timing_wheel_entry(new_wheel, i);
+		entry->_generation = 0;
+		entry->_slot = _TIMING_WHEEL_FREE;
+		entry->_next = (i + 1 < new_capacity) ? (uint32_t)(i + 1) : new_wheel->_free;
+	}
+	new_wheel->_free = (uint32_t)new_wheel->_capacity;
+	new_wheel->_capacity = new_capacity;
+	return new_wheel;
+}
+
+_timing_wheel_entry_t* _timing_wheel_lookup(timing_wheel_t* wheel, timing_wheel_handle_t handle) {
+	// Check the handle is in range & its generation is still live
+	if (!wheel) { return NULL; }
+	uint32_t index = (uint32_t)(handle & UINT32_MAX);
+	if (index >= wheel->_capacity) { return NULL; }
+	_timing_wheel_entry_t* entry = _timing_wheel_entry(wheel, index);
+	if (entry->_slot == _TIMING_WHEEL_FREE || entry->_generation != (uint32_t)(handle >> 32)) { return NULL; }
+	return entry;
+}
+
+void _timing_wheel_link(timing_wheel_t* wheel, uint32_t index) {
+	_timing_wheel_entry_t* entry = _timing_wheel_entry(wheel, index);
+
+	// Deadlines that have passed go to the back of the expired list
+	if (entry->_deadline <= wheel->_now) {
+		entry->_slot = _TIMING_WHEEL_READY;
+		entry->_next = _TIMING_WHEEL_NIL;
+		entry->_prev = wheel->_ready_tail;
+		if (wheel->_ready_tail != _TIMING_WHEEL_NIL) { _timing_wheel_entry(wheel, wheel->_ready_tail)->_next = index; }
+		else { wheel->_ready_head = index; }
+		wheel->_ready_tail = index;
+		wheel->_ready_length++;
+		return;
+	}
+
+	// Pick the lowest level whose span covers the time left
+	uint64_t delta = entry->_deadline - wheel->_now;
+	size_t level = 0;
+	while(level < TIMING_WHEEL_LEVELS - 1 && (delta >> (TIMING_WHEEL_BITS * (level + 1))) != 0) { level++; }
+	size_t slot = (size_t)(entry->_deadline >> (TIMING_WHEEL_BITS * level)) & _TIMING_WHEEL_MASK;
+
+	// Deadlines past the top level wait in the current top slot, which comes around again after a full turn
+	if ((delta >> (TIMING_WHEEL_BITS * TIMING_WHEEL_LEVELS)) != 0) {
+		slot = (size_t)(wheel->_now >> (TIMING_WHEEL_BITS * level)) & _TIMING_WHEEL_MASK;
+	}
+
+	// Push onto the front of the slot
+	uint32_t* head = &wheel->_heads[(level * TIMING_WHEEL_SLOTS) + slot];
+	entry->_slot = (uint32_t)((level * TIMING_WHEEL_SLOTS) + slot);
+	entry->_prev = _TIMING_WHEEL_NIL;
+	entry->_next = *head;
+	if (*head != _TIMING_WHEEL_NIL) { _timing_wheel_entry(wheel, *head)->_prev = index; }
+	*head = index;
+	wheel->_occupied[level][slot / 64] |= (1ULL << (slot % 64));
+}
+
+void _timing_wheel_unlink(timing_wheel_t* wheel, uint32_t index) {
+	_timing_wheel_entry_t* entry = _timing_wheel_entry(wheel, index);
+	if (entry->_slot == _TIMING_WHEEL_READY) {
+		// Remove from the expired list
+		if (entry->_prev != _TIMING_WHEEL_NIL) { _timing_wheel_entry(wheel, entry->_prev)->_next = entry->_next; }
+		else { wheel->_ready_head = entry->_next; }
+		if (entry->_next != _TIMING_WHEEL_NIL) { _timing_wheel_entry(wheel, entry->_next)->_prev = entry->_prev; }
+		else { wheel->_ready_tail = entry->_prev; }
+		wheel->_ready_length--;
+		return;
+	}
+
+	// Remove from the slot, clearing its occupancy bit once empty
+	uint32_t* head = &wheel->_heads[entry->_slot];
+	if (entry->_prev != _TIMING_WHEEL_NIL) { _timing_wheel_entry(wheel, entry->_prev)->_next = entry->_next; }
+	else { *head = entry->_next; }
+	if (entry->_next != _TIMING_WHEEL_NIL) { _timing_wheel_entry(wheel, entry->_next)->_prev = entry->_prev; }
+	if (*head == _TIMING_WHEEL_NIL) {
+		size_t level = entry->_slot / TIMING_WHEEL_SLOTS;
+		size_t slot = entry->_slot % TIMING_WHEEL_SLOTS;
+		wheel->_occupied[level][slot / 64] &= ~(1ULL << (slot % 64));
+	}
+}
+
+void _timing_wheel_release(timing_wheel_t* wheel, uint32_t index) {
+	// Return the record to the free list
+	_timing_wheel_entry_t* entry = _timing_wheel_entry(wheel, index);
+	entry->_slot = _TIMING_WHEEL_FREE;
+	entry->_next = wheel->_free;
+	wheel->_free = index;
+	wheel->_length--;
+}
+
+timing_wheel_handle_t _timing_wheel_insert(timing_wheel_t** wheel, uint64_t deadline, void* data) {
+	// Error check
+	if (!wheel || !(*wheel)) { return TIMING_WHEEL_INVALID_HANDLE; }
+	timing_wheel_t* _wheel = *wheel;
+
+	// Resize container
+	if (_wheel->_free == _TIMING_WHEEL_NIL) {
+		timing_wheel_t* temp = _timing_wheel_resize(_wheel, 0);
+		if (!temp) { return TIMING_WHEEL_INVALID_HANDLE; }
+		(*wheel) = temp;
+		_wheel = temp;
+	}
+
+	// Take a free record, bumping its generation so old handles to it go stale
+	uint32_t index = _wheel->_free;
+	_timing_wheel_entry_t* entry = _timing_wheel_entry(_wheel, index);
+	_wheel->_free = entry->_next;
+	if (++entry->_generation == 0) { entry->_generation = 1; }
+	entry->_deadline = deadline;
+	memcpy_s(_timing_wheel_data_pos(_wheel, index), _wheel->_element_size, data, _wheel->_element_size);
+	_wheel->_length++;
+	_timing_wheel_link(_wheel, index);
+	return _timing_wheel_handle(entry->_generation, index);
+}
+
+bool _timing_wheel_reschedule(timing_wheel_t* wheel, timing_wheel_handle_t handle, uint64_t deadline) {
+	// Error check
+	_timing_wheel_entry_t* entry = _timing_wheel_lookup(wheel, handle);
+	if (!entry) { return false; }
+
+	// Move the record to its new slot
+	uint32_t index = (uint32_t)(handle & UINT32_MAX);
+	_timing_wheel_unlink(wheel, index);
+	entry->_deadline = deadline;
+	_timing_wheel_link(wheel, index);
+	return true;
+}
+
+bool _timing_wheel_cancel(timing_wheel_t* wheel, timing_wheel_handle_t handle) {
+	// Error check
+	if (!_timing_wheel_lookup(wheel, handle)) { return false; }
+
+	uint32_t index = (uint32_t)(handle & UINT32_MAX);
+	_timing_wheel_unlink(wheel, index);
+	_timing_wheel_release(wheel, index);
+	return true;
+}
+
+void* _timing_wheel_get(timing_wheel_t* wheel, timing_wheel_handle_t handle) {
+	// Error check
+	if (!_timing_wheel_lookup(wheel, handle)) { return NULL; }
+	return _timing_wheel_data_pos(wheel, handle & UINT32_MAX);
+}
+
+size_t _timing_wheel_next_slot(timing_wheel_t* wheel, size_t level, size_t slot) {
+	// Scan the occupancy bitmap for the first busy slot at or after the given one
+	size_t word = slot / 64;
+	uint64_t bits = wheel->_occupied[level][word] & (~0ULL << (slot % 64));
+	while(!bits) {
+		if (++word == TIMING_WHEEL_SLOTS / 64) { return TIMING_WHEEL_SLOTS; }
+		bits = wheel->_occupied[level][word];
+	}
+	return (word * 64) + CC_CTZ64(bits);
+}
+
+uint64_t _timing_wheel_next_tick(timing_wheel_t* wheel, uint64_t tick) {
+	// Find the earliest tick at or after the given one where any level has a slot to expire or cascade
+	uint64_t next = UINT64_MAX;
+	for(size_t level=0; level<TIMING_WHEEL_LEVELS; ++level) {
+		size_t shift = TIMING_WHEEL_BITS * level;
+		uint64_t turn = 1ULL << (shift + TIMING_WHEEL_BITS);
+		uint64_t start = ((tick + (1ULL << shift) - 1) >> shift) << shift;
+		if (start < tick) { continue; }
+
+		// Busy slots behind the current one come around in the next turn
+		uint64_t base = start & ~(turn - 1);
+		size_t slot = _timing_wheel_next_slot(wheel, level, (size_t)(start >> shift) & _TIMING_WHEEL_MASK);
+		if (slot == TIMING_WHEEL_SLOTS) {
+			slot = _timing_wheel_next_slot(wheel, level, 0);
+			if (slot == TIMING_WHEEL_SLOTS) { continue; }
+			base += turn;
+		}
+		uint64_t at = base + ((uint64_t)slot << shift);
+		if (at >= tick && at < next) { next = at; }
+	}
+	return next;
+}
+
+void _timing_wheel_tick(timing_wheel_t* wheel, uint64_t tick) {
+	wheel->_now = tick;
+
+	// Cascade every level whose lower digits just wrapped, top down, then expire the bottom slot
+	for(size_t level = TIMING_WHEEL_LEVELS; level > 0; --level) {
+		size_t l = level - 1;
+		if (l > 0 && (tick & ((1ULL << (TIMING_WHEEL_BITS * l)) - 1)) != 0) { continue; }
+		size_t slot = (size_t)(tick >> (TIMING_WHEEL_BITS * l)) & _TIMING_WHEEL_MASK;
+		uint32_t index = wheel->_heads[(l * TIMING_WHEEL_SLOTS) + slot];
+		if (index == _TIMING_WHEEL_NIL) { continue; }
+
+		// Detach the whole slot & relink each record against the new time
+		wheel->_heads[(l * TIMING_WHEEL_SLOTS) + slot] = _TIMING_WHEEL_NIL;
+		wheel->_occupied[l][slot / 64] &= ~(1ULL << (slot % 64));
+		while(index != _TIMING_WHEEL_NIL) {
+			uint32_t next = _timing_wheel_entry(wheel, index)->_next;
+			_timing_wheel_link(wheel, index);
+			index = next;
+		}
+	}
+}
+
+size_t _timing_wheel_advance(timing_wheel_t* wheel, uint64_t now, void* out, size_t max) {
+	// Error check
+	if (!wheel || (max > 0 && !out)) { return 0; }
+
+	// Jump from one busy tick to the next
+	while(wheel->_now < now) {
+		if (wheel->_length == wheel->_ready_length) {
+			// Nothing left in the wheel itself
+			wheel->_now = now;
+			break;
+		}
+		uint64_t tick = _timing_wheel_next_tick(wheel, wheel->_now + 1);
+		if (tick > now) {
+			wheel->_now = now;
+			break;
+		}
+		_timing_wheel_tick(wheel, tick);
+	}
+
+	// Copy out expired records oldest first
+	size_t count = 0;
+	uint8_t* dest = out;
+	while(count < max && wheel->_ready_head != _TIMING_WHEEL_NIL) {
+		uint32_t index = wheel->_ready_head;
+		memcpy_s(dest + (count * wheel->_element_size), wheel->_element_size, _timing_wheel_data_pos(wheel, index), wheel->_element_size);
+		_timing_wheel_unlink(wheel, index);
+		_timing_wheel_release(wheel, index);
+		count++;
+	}
+	return count;
+}
+
+void _timing_wheel_clear(timing_wheel_t* wheel) {
+	// Error check
+	if (!wheel) { return; }
+
+	// Empty every slot & the expired list
+	memset(wheel->_heads, 0xFF, sizeof wheel->_heads);
+	memset(wheel->_occupied, 0, sizeof wheel->_occupied);
+	wheel->_ready_head = _TIMING_WHEEL_NIL;
+	wheel->_ready_tail = _TIMING_WHEEL_NIL;
+	wheel->_ready_length = 0;
+
+	// Return every live record to the free list
+	for(size_t i=0; i<wheel->_capacity; ++i) {
+		_timing_wheel_entry_t* entry = _timing_wheel_entry(wheel, i);
+		if (entry->_slot != _TIMING_WHEEL_FREE) {
+			entry->_slot = _TIMING_WHEEL_FREE;
+			entry->_next = wheel->_free;
+			wheel->_free = (uint32_t)i;
+		}
+	}
+	wheel->_length = 0;
+}
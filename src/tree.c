@@ -1,98 +1,379 @@
 #include "cc/tree.h"
 #include <string.h>
 #include <math.h>
+#include <threads.h>
+#include <stdatomic.h>
 
-_tree_node_t* _tree_find_node(tree_t* tree, _tree_node_t* node, _tree_node_t** parent, size_t* child_idx, int force, char* key, char* sep) {
-	char* ctx;
-	char* pch = strtok_r(key, sep, &ctx);
-	//printf("Finding [%s]\n", key);
+/// @brief Shared state for a traversal split across threads.
+typedef struct {
+	tree_t* _tree;
+	_tree_node_t** _roots;
+	size_t _count;
+	atomic_size_t _next;
+	atomic_int _stop;
+	int _op;
+	tree_visit_t _fn;
+	void* _ctx;
+} _tree_task_t;
+
+/// @brief Per-thread results of a split traversal.
+typedef struct {
+	_tree_task_t* _task;
+	size_t _count;
+	size_t _depth;
+	size_t _nodes;
+	void* _free_nodes;
+	void* _free_nodes_tail;
+	void* _free_payloads;
+	void* _free_payloads_tail;
+	char* _free_keys[TREE_KEY_CLASSES];
+	char* _free_keys_tail[TREE_KEY_CLASSES];
+	size_t* _depth_counts;
+} _tree_worker_t;
+
+void* _tree_pool_alloc(_tree_pool_t* pool) {
+	// Reuse a previously freed record
+	if (pool->_free) {
+		void* record = pool->_free;
+		pool->_free = *(void**)record;
+		memset(record, 0, pool->_record_size);
+		return record;
+	}
+
+	// Add a new slab once the current one is full
+	_tree_slab_t* slab = pool->_slabs;
+	if (!slab || slab->_used + pool->_record_size > slab->_capacity) {
+		size_t capacity = (pool->_slab_capacity == 0) ? TREE_SLAB_DEFAULT_CAPACITY : pool->_slab_capacity;
+		size_t slab_size = capacity * pool->_record_size;
+		slab = CC_MALLOC(offsetof(_tree_slab_t, _buffer) + slab_size);
+		if (!slab) { return NULL; }
+		slab->_next = pool->_slabs;
+		slab->_used = 0;
+		slab->_capacity = slab_size;
+		pool->_slabs = slab;
+		pool->_slab_capacity = CC_MIN(capacity * 2, TREE_SLAB_MAX_CAPACITY);
+	}
+
+	// Carve the record from the slab
+	void* record = (uint8_t*)slab->_buffer + slab->_used;
+	slab->_used += pool->_record_size;
+	memset(record, 0, pool->_record_size);
+	return record;
+}
+
+void _tree_pool_free(_tree_pool_t* pool, void* record) {
+	// Push the record onto the free list
+	if (!record) { return; }
+	*(void**)record = pool->_free;
+	pool->_free = record;
+}
+
+void _tree_pool_release(_tree_pool_t* pool) {
+	// Deallocate every slab at once
+	_tree_slab_t* slab = pool->_slabs;
+	while(slab) {
+		_tree_slab_t* next = slab->_next;
+		CC_FREE(slab);
+		slab = next;
+	}
+	pool->_slabs = NULL;
+	pool->_free = NULL;
+	pool->_slab_capacity = 0;
+}
+
+size_t _tree_key_class(size_t size) {
+	// Keys are stored in power of 2 blocks, big enough to hold a free list link
+	size_t c = 0;
+	while(c + 1 < TREE_KEY_CLASSES && (_TREE_KEY_MIN_SIZE << c) < size) { c++; }
+	return c;
+}
+
+char* _tree_key_alloc(tree_t* tree, const char* key, size_t len) {
+	// Reuse a block released by a deleted node
+	size_t c = _tree_key_class(len + 1);
+	size_t block = _TREE_KEY_MIN_SIZE << c;
+	if (block < len + 1) { return NULL; }
+	char* dest = tree->_key_free[c];
+	if (dest) { memcpy_s(&tree->_key_free[c], sizeof(char*), dest, sizeof(char*)); }
+	else {
+		// Add a new slab once the current one is full, oversized keys get their own
+		_tree_slab_t* slab = tree->_keys;
+		if (!slab || slab->_used + block > slab->_capacity) {
+			size_t slab_size = CC_MAX(block, TREE_KEY_SLAB_SIZE);
+			slab = CC_MALLOC(offsetof(_tree_slab_t, _buffer) + slab_size);
+			if (!slab) { return NULL; }
+			slab->_next = tree->_keys;
+			slab->_used = 0;
+			slab->_capacity = slab_size;
+			tree->_keys = slab;
+		}
+		dest = (char*)slab->_buffer + slab->_used;
+		slab->_used += block;
+	}
+
+	// Copy the key into the block (or just reserve space if there is no key yet)
+	if (key) { memcpy_s(dest, len + 1, key, len); }
+	dest[len] = '\0';
+	return dest;
+}
+
+void _tree_key_free(tree_t* tree, char* key) {
+	// Push the block onto the free list of its size class
+	if (!key) { return; }
+	size_t c = _tree_key_class(strlen(key) + 1);
+	memcpy_s(key, sizeof(char*), &tree->_key_free[c], sizeof(char*));
+	tree->_key_free[c] = key;
+}
+
+size_t _tree_key_segments(const char* key, size_t len) {
+	// Count the path segments folded into a radix edge
+	size_t count = 1;
+	const char* end = key + len;
+	while((key = memchr(key, TREE_RADIX_SEP, (size_t)(end - key))) != NULL) {
+		count++;
+		key++;
+	}
+	return count;
+}
+
+_tree_node_t* _tree_node_create(tree_t* tree, _tree_node_t* parent, char* key, size_t depth) {
+	// Allocate node & payload, the node owns the key so it's returned to its free list on failure
+	if (!key) { return NULL; }
+	if (depth >= tree->_depth_capacity) {
+		size_t capacity = CC_MAX(depth + 1, tree->_depth_capacity * 2);
+		size_t* counts = CC_REALLOC(tree->_depth_counts, capacity * sizeof *counts);
+		if (!counts) { goto tree_node_create_fail; }
+		memset(counts + tree->_depth_capacity, 0, (capacity - tree->_depth_capacity) * sizeof *counts);
+		tree->_depth_counts = counts;
+		tree->_depth_capacity = capacity;
+	}
+	_tree_node_t* node = _tree_pool_alloc(&tree->_nodes);
+	if (!node) { goto tree_node_create_fail; }
+	node->_key = key;
+	node->_buffer = (_tree_data_inline(tree)) ? _tree_node_inline(node) : _tree_pool_alloc(&tree->_payloads);
+	if (!node->_buffer) {
+		_tree_pool_free(&tree->_nodes, node);
+		goto tree_node_create_fail;
+	}
+
+	// Count the node in the depth histogram
+	node->_depth = depth;
+	tree->_depth_counts[depth]++;
+	if (depth > tree->_max_depth) { tree->_max_depth = depth; }
+
+	// Append to the parents children
+	if (parent) {
+		node->_parent = parent;
+		if (parent->_last_child) { parent->_last_child->_next_sibling = node; }
+		else { parent->_first_child = node; }
+		parent->_last_child = node;
+		parent->_num_children++;
+	}
+	tree->_length++;
+	return node;
+tree_node_create_fail:
+	_tree_key_free(tree, key);
+	return NULL;
+}
+
+void _tree_node_release(tree_t* tree, _tree_node_t* node) {
+	// Return node, payload & key to their pools
+	if (node->_flags & _TREE_NODE_ENTRY) { tree->_entries--; }
+	if (!_tree_data_inline(tree)) { _tree_pool_free(&tree->_payloads, node->_buffer); }
+	_tree_key_free(tree, node->_key);
+	_tree_depth_remove(tree, node->_depth, 1);
+	_tree_pool_free(&tree->_nodes, node);
+	tree->_length--;
+}
+
+void _tree_depth_remove(tree_t* tree, size_t depth, size_t count) {
+	// Drop nodes from the depth histogram, lowering the max depth past emptied levels
+	tree->_depth_counts[depth] -= count;
+	while(tree->_max_depth > 0 && tree->_depth_counts[tree->_max_depth] == 0) {
+		tree->_max_depth--;
+	}
+}
+
+void _tree_node_unlink(_tree_node_t* node) {
+	// Remove the node from its parents children
+	_tree_node_t* parent = node->_parent;
+	_tree_node_t* prev = NULL;
+	for(_tree_node_t* v = parent->_first_child; v != node; v = v->_next_sibling) {
+		prev = v;
+	}
+	if (prev) { prev->_next_sibling = node->_next_sibling; }
+	else { parent->_first_child = node->_next_sibling; }
+	if (parent->_last_child == node) { parent->_last_child = prev; }
+	parent->_num_children--;
+	node->_next_sibling = NULL;
+}
+
+const char* _tree_token(const char** cursor, const char* sep, size_t* len) {
+	// Skip leading seperators & measure the next path segment
+	const char* pch = *cursor + strspn(*cursor, sep);
+	(*len) = strcspn(pch, sep);
+	(*cursor) = pch + (*len);
+	return ((*len) > 0) ? pch : NULL;
+}
+
+#define _tree_segment_eq(seg, tok, len) \
+	(strncmp(seg, tok, len) == 0 && ((seg)[len] == '\0' || (seg)[len] == TREE_RADIX_SEP))
+
+_tree_node_t* _tree_find_node(tree_t* tree, _tree_node_t* node, int force, const char* key, const char* sep) {
+	const char* cursor = key;
+	size_t len = 0;
+	const char* pch = _tree_token(&cursor, sep, &len);
 	while(pch) {
-		int found = 0;
 		// Check if any children match the current token
-		for(size_t i=0; i<node->_num_children; ++i) {
-			_tree_node_t* child = node->_children[i];
-			if (strcmp(pch, child->_key) == 0) {
-				if (parent && child_idx) {
-					(*parent) = node;
-					(*child_idx) = i;
-				}
-				node = child;
-				found = 1;
-				break;
-			}
+		_tree_node_t* child = node->_first_child;
+		while(child && !(strncmp(pch, child->_key, len) == 0 && child->_key[len] == '\0')) {
+			child = child->_next_sibling;
 		}
-		if (found == 1) {
-			// Get the next token
-			pch = strtok_r(NULL, sep, &ctx);
-		}
-		else {
+		if (!child) {
 			// No children match the token
 			if (force == 0) { return NULL; }
 
 			// Create a new node
-			_tree_node_t* new_node = CC_CALLOC(1, sizeof *new_node);
-			if (!new_node) { return NULL; }
+			child = _tree_node_create(tree, node, _tree_key_alloc(tree, pch, len), node->_depth + 1);
+			if (!child) { return NULL; }
+			child->_flags |= _TREE_NODE_ENTRY;
+			tree->_entries++;
+		}
+		node = child;
 
-			new_node->_key = strdup(pch);
-			if (!new_node->_key) {
-				CC_FREE(new_node);
-				return NULL;
-			}
+		// Get the next token
+		pch = _tree_token(&cursor, sep, &len);
+	}
+	return node;
+}
 
-			new_node->_buffer = CC_CALLOC(1, tree->_element_size);
-			if (!new_node->_buffer) {
-				CC_FREE(new_node->_key);
-				CC_FREE(new_node);
-				return NULL;
-			}
+_tree_node_t* _tree_radix_find_node(tree_t* tree, int force, int prefix, const char* key, const char* sep) {
+	_tree_node_t* node = tree->_root;
+	const char* cursor = key;
+	size_t len = 0;
+	const char* pch = _tree_token(&cursor, sep, &len);
+	while(pch) {
+		// Find the edge that starts with the current token
+		_tree_node_t* child = node->_first_child;
+		while(child && !_tree_segment_eq(child->_key, pch, len)) {
+			child = child->_next_sibling;
+		}
+		if (!child) {
+			if (force == 0) { return NULL; }
 
-			_tree_node_t** new_children = CC_CALLOC(node->_num_children + 1, sizeof *new_children);
-			if (!new_children) {
-				CC_FREE(new_node->_key);
-				CC_FREE(new_node->_buffer);
-				CC_FREE(new_node);
-				return NULL; 
+			// Measure the rest of the path, then store it as a single edge
+			size_t edge_len = len;
+			const char* rest = cursor;
+			size_t rest_len = 0;
+			while(_tree_token(&rest, sep, &rest_len)) {
+				edge_len += rest_len + 1;
 			}
-			memcpy_s(new_children, sizeof *new_children * (node->_num_children + 1), node->_children, sizeof *new_children * node->_num_children);
-			CC_FREE(node->_children);
-			node->_children = new_children;
-			node->_children[node->_num_children] = new_node;
-			node->_num_children++;
-			node = new_node;
-			tree->_length++;
+			char* edge = _tree_key_alloc(tree, NULL, edge_len);
+			if (!edge) { return NULL; }
+			char* ech = edge;
+			size_t segments = 0;
+			while(pch) {
+				if (ech != edge) { *ech++ = TREE_RADIX_SEP; }
+				memcpy_s(ech, len, pch, len);
+				ech += len;
+				segments++;
+				pch = _tree_token(&cursor, sep, &len);
+			}
+			return _tree_node_create(tree, node, edge, node->_depth + segments);
+		}
+
+		// Match as many segments of the edge as possible
+		const char* ech = child->_key + len;
+		pch = _tree_token(&cursor, sep, &len);
+		while(*ech == TREE_RADIX_SEP && pch && _tree_segment_eq(ech + 1, pch, len)) {
+			ech += len + 1;
+			pch = _tree_token(&cursor, sep, &len);
+		}
+		if (*ech == '\0') {
+			// Whole edge matched
+			node = child;
+			continue;
+		}
+
+		// Path diverges or ends partway along the edge
+		if (prefix && !pch) { return child; }
+		if (force == 0) { return NULL; }
 
-			// Get the next token
-			pch = strtok_r(NULL, sep, &ctx);
+		// Split the edge, the child keeps a copy of the tail of its key
+		size_t head_len = (size_t)(ech - child->_key);
+		size_t mid_depth = node->_depth + _tree_key_segments(child->_key, head_len);
+		char* tail = _tree_key_alloc(tree, ech + 1, strlen(ech + 1));
+		char* head = _tree_key_alloc(tree, child->_key, head_len);
+		_tree_node_t* mid = _tree_node_create(tree, NULL, head, mid_depth);
+		if (!mid) {
+			_tree_key_free(tree, tail);
+			return NULL;
 		}
+		if (!tail) {
+			_tree_node_release(tree, mid);
+			return NULL;
+		}
+		mid->_parent = node;
+		mid->_next_sibling = child->_next_sibling;
+		if (node->_first_child == child) { node->_first_child = mid; }
+		else {
+			_tree_node_t* prev = node->_first_child;
+			while(prev->_next_sibling != child) { prev = prev->_next_sibling; }
+			prev->_next_sibling = mid;
+		}
+		if (node->_last_child == child) { node->_last_child = mid; }
+		_tree_key_free(tree, child->_key);
+		child->_key = tail;
+		child->_parent = mid;
+		child->_next_sibling = NULL;
+		mid->_first_child = child;
+		mid->_last_child = child;
+		mid->_num_children = 1;
+		node = mid;
 	}
 	return node;
 }
 
-tree_t* _tree_factory(size_t element_size, int string) {
+_tree_node_t* _tree_locate(tree_t* tree, int force, int prefix, const char* key, const char* sep) {
+	// Follow the key path with the lookup matching the tree layout
+	if (!key) { return tree->_root; }
+	if (tree->_flags & TREE_FLAG_RADIX) {
+		// A segment holding the edge seperator would match across segment boundaries
+		if (strchr(key, TREE_RADIX_SEP) && !strchr(sep, TREE_RADIX_SEP)) { return NULL; }
+		return _tree_radix_find_node(tree, force, prefix, key, sep);
+	}
+	return _tree_find_node(tree, tree->_root, force, key, sep);
+}
+
+tree_t* _tree_factory(size_t element_size, int flags) {
 	tree_t* tree = CC_CALLOC(1, sizeof *tree);
 	if (!tree) { return NULL; }
 	tree->_element_size = element_size;
-	tree->_root = CC_CALLOC(1, sizeof *(tree->_root));
+	tree->_nodes._record_size = _tree_node_size(tree);
+	tree->_payloads._record_size = _tree_align(element_size);
+	tree->_root = _tree_node_create(tree, NULL, _tree_key_alloc(tree, "(root)", 6), 0);
 	if (!tree->_root) { 
-		CC_FREE(tree);
-		return NULL;
-	}
-	tree->_root->_key = strdup("(root)");
-	if (!tree->_root->_key) {
-		CC_FREE(tree->_root);
-		CC_FREE(tree);
+		_tree_destroy(tree);
 		return NULL;
 	}
-	tree->_length = 1;
-	if (string == 1) { tree->_flags |= TREE_FLAG_STR; }
+	tree->_flags = (char)flags;
 	return tree;
 }
 
 void _tree_destroy(tree_t* tree) {
 	// Error check
-	if (!tree || tree->_length == 0) { return; }
+	if (!tree) { return; }
 	
-	_tree_delete(tree, NULL, NULL);
+	// Deallocate all slabs
+	CC_FREE(tree->_depth_counts);
+	_tree_pool_release(&tree->_nodes);
+	_tree_pool_release(&tree->_payloads);
+	_tree_slab_t* slab = tree->_keys;
+	while(slab) {
+		_tree_slab_t* next = slab->_next;
+		CC_FREE(slab);
+		slab = next;
+	}
 	CC_FREE(tree);
 	return;
 }
@@ -101,167 +382,630 @@ void _tree_clear(tree_t* tree) {
 	// Error check
 	if (!tree || tree->_length == 0) { return; }
 
-	// Clear all elements from the root
-	_tree_delete(tree, NULL, NULL);
+	// Drop every slab but the most recent of each pool
+	_tree_pool_t* pools[2] = { &tree->_nodes, &tree->_payloads };
+	for(size_t i=0; i<2; ++i) {
+		_tree_slab_t* slab = pools[i]->_slabs;
+		if (!slab) { continue; }
+		_tree_pool_t keep = *pools[i];
+		keep._slabs = slab->_next;
+		_tree_pool_release(&keep);
+		slab->_next = NULL;
+		slab->_used = 0;
+		pools[i]->_free = NULL;
+	}
+	_tree_slab_t* slab = tree->_keys;
+	if (slab) {
+		_tree_slab_t* next = slab->_next;
+		while(next) {
+			_tree_slab_t* temp = next->_next;
+			CC_FREE(next);
+			next = temp;
+		}
+		slab->_next = NULL;
+		slab->_used = 0;
+	}
+	memset(tree->_key_free, 0, sizeof tree->_key_free);
 
 	// Create a new root
-	tree->_root = CC_CALLOC(1, sizeof *(tree->_root));
-	if (!tree->_root) { 
-		_tree_destroy(tree);
-		return; 
-	}
-	tree->_length = 1;
+	tree->_length = 0;
+	tree->_entries = 0;
+	tree->_max_depth = 0;
+	if (tree->_depth_counts) { memset(tree->_depth_counts, 0, tree->_depth_capacity * sizeof *tree->_depth_counts); }
+	tree->_root = _tree_node_create(tree, NULL, _tree_key_alloc(tree, "(root)", 6), 0);
 	return;
 }
 
-void* _tree_find(tree_t* tree, char* key, char* sep) {
+void* _tree_find(tree_t* tree, const char* key, const char* sep) {
 	// Error check
 	if (!tree || tree->_length == 0) { return NULL; }
 
-	_tree_node_t* node = _tree_find_node(tree, tree->_root, NULL, NULL, 0, key, sep);
-	if (!node) { return NULL; }
+	_tree_node_t* node = _tree_locate(tree, 0, 0, key, sep);
+	if (!node || !(node->_flags & _TREE_NODE_ENTRY)) { return NULL; }
 	return node->_buffer;
 }
 
-void* _tree_insert(tree_t* tree, char* key, char* sep, void* data) {
+void* _tree_insert(tree_t* tree, const char* key, const char* sep, void* data) {
 	// Error check
 	if (!tree || tree->_length == 0) { return NULL; }
 
-	_tree_node_t* node = _tree_find_node(tree, tree->_root, NULL, NULL, 1, key, sep);
-	if (!node) { return NULL; }
+	_tree_node_t* node = _tree_locate(tree, 1, 0, key, sep);
+	if (!node || node == tree->_root) { return NULL; }
+	if (!(node->_flags & _TREE_NODE_ENTRY)) {
+		node->_flags |= _TREE_NODE_ENTRY;
+		tree->_entries++;
+	}
 	memcpy_s(node->_buffer, tree->_element_size, data, tree->_element_size);
 	return node->_buffer;
 }
 
-void _tree_delete(tree_t* tree, char* key, char* sep) {
+void _tree_subtree_release(tree_t* tree, _tree_node_t* node) {
+	// Post-order walk returning every node in an unlinked subtree to the pool
+	_tree_node_t* v = node;
+	while(v) {
+		if (v->_first_child) {
+			v = v->_first_child;
+			continue;
+		}
+		_tree_node_t* next = (v == node) ? NULL : v->_next_sibling;
+		_tree_node_t* up = (v == node) ? NULL : v->_parent;
+		if (up && !next) { up->_first_child = NULL; }
+		_tree_node_release(tree, v);
+		v = (next) ? next : up;
+	}
+}
+
+void _tree_radix_merge(tree_t* tree, _tree_node_t* parent) {
+	// Merge a radix branch node that was left with a single child back into that child
+	if (!(tree->_flags & TREE_FLAG_RADIX) || parent == tree->_root) { return; }
+	if (parent->_num_children != 1 || (parent->_flags & _TREE_NODE_ENTRY)) { return; }
+	_tree_node_t* child = parent->_first_child;
+	size_t head_len = strlen(parent->_key);
+	size_t tail_len = strlen(child->_key);
+	char* edge = _tree_key_alloc(tree, NULL, head_len + tail_len + 1);
+	if (!edge) { return; }
+	memcpy_s(edge, head_len, parent->_key, head_len);
+	edge[head_len] = TREE_RADIX_SEP;
+	memcpy_s(edge + head_len + 1, tail_len, child->_key, tail_len);
+	_tree_key_free(tree, child->_key);
+	child->_key = edge;
+	child->_parent = parent->_parent;
+	child->_next_sibling = parent->_next_sibling;
+	_tree_node_t* grand = parent->_parent;
+	if (grand->_first_child == parent) { grand->_first_child = child; }
+	else {
+		_tree_node_t* prev = grand->_first_child;
+		while(prev->_next_sibling != parent) { prev = prev->_next_sibling; }
+		prev->_next_sibling = child;
+	}
+	if (grand->_last_child == parent) { grand->_last_child = child; }
+	_tree_node_release(tree, parent);
+}
+
+void _tree_delete(tree_t* tree, const char* key, const char* sep) {
 	// Error check
 	if (!tree || tree->_length == 0) { return; }
 
-	// Depth-first search to collect all nodes in the subtree
-	_tree_node_t* parent = NULL;
-	size_t child_idx = 0;
-	_tree_node_t* node = (key) ? _tree_find_node(tree, tree->_root, &parent, &child_idx, 0, key, sep) : tree->_root;
+	// Deleting from the root empties the whole tree
+	_tree_node_t* node = _tree_locate(tree, 0, 1, key, sep);
 	if (!node) { return; }
-	_tree_node_t** stack = NULL;
-	_tree_node_t** vec = NULL;
-	size_t stack_capacity = tree->_length;
-	size_t stack_size = 0;
-	size_t vec_capacity = stack_capacity;
-	size_t vec_size = 0;
-	stack = CC_CALLOC(stack_capacity, sizeof *stack);
-	vec = CC_CALLOC(vec_capacity, sizeof *vec);
-	if (!vec || !stack) { goto tree_delete_end; }
-	stack[stack_size++] = node;
-	while(stack_size > 0) {
-		_tree_node_t* v = stack[--stack_size];
-		vec[vec_size++] = v;
-		for(size_t i=0; i<v->_num_children; ++i) {
-			stack[stack_size++] = v->_children[i];
+	if (node == tree->_root) {
+		_tree_clear(tree);
+		return;
+	}
+
+	// Unlink the subtree from its parent & release it
+	_tree_node_t* parent = node->_parent;
+	_tree_node_unlink(node);
+	_tree_subtree_release(tree, node);
+	_tree_radix_merge(tree, parent);
+	return;
+}
+
+int _tree_depth(tree_t* tree, const char* key, const char* sep) {
+	// Error check
+	if (!tree || tree->_length == 0) { return -1; }
+
+	// Max depth is tracked by the histogram
+	if (!key) { return (int)tree->_max_depth; }
+
+	// Otherwise read the depth stored in the node
+	_tree_node_t* node = _tree_locate(tree, 0, 0, key, sep);
+	return (node) ? (int)node->_depth : -1;
+}
+
+_tree_node_t* _tree_next_node(_tree_node_t* root, _tree_node_t* node, size_t limit) {
+	// Pre-order step that never leaves the subtree under root or goes deeper than the limit
+	if (node->_depth < limit) {
+		for(_tree_node_t* child = node->_first_child; child; child = child->_next_sibling) {
+			if (child->_depth <= limit) { return child; }
 		}
 	}
+	while(node != root) {
+		for(_tree_node_t* sibling = node->_next_sibling; sibling; sibling = sibling->_next_sibling) {
+			if (sibling->_depth <= limit) { return sibling; }
+		}
+		node = node->_parent;
+	}
+	return NULL;
+}
+
+tree_it_t* _tree_it(tree_t* tree, const char* key, const char* sep, size_t max_depth) {
+	// Error check
+	if (!tree || tree->_length == 0) { return NULL; }
+	_tree_node_t* root = _tree_locate(tree, 0, 1, key, sep);
+	if (!root) { return NULL; }
 
-	// Delete all nodes in the subtree
-	for(size_t i=0; i<vec_size; ++i) {
-		_tree_node_t* v = vec[i];
-		CC_FREE(v->_children);
-		CC_FREE(v->_key);
-		CC_FREE(v->_buffer);
-		CC_FREE(v);
-		tree->_length--;
+	// Construct iterator
+	tree_it_t* it = CC_CALLOC(1, sizeof *it);
+	if (!it) { return NULL; }
+	it->_tree = tree;
+	it->_root = root;
+	it->_node = root;
+	it->_limit = (max_depth > SIZE_MAX - root->_depth) ? SIZE_MAX : root->_depth + max_depth;
+
+	// Start at the subtree root if it holds an element, otherwise find the first one below it
+	if (root->_flags & _TREE_NODE_ENTRY) {
+		it->data = root->_buffer;
+		it->key = root->_key;
+		it->depth = root->_depth;
+		return it;
 	}
-	if (parent) {
-		for(size_t i=child_idx; i<parent->_num_children - 1; ++i) {
-			parent->_children[i] = parent->_children[i + 1];
+	return _tree_it_next(it);
+}
+
+tree_it_t* _tree_it_next(tree_it_t* it) {
+	// Error check
+	if (!it) { return NULL; }
+
+	// Find the next node holding an element
+	_tree_node_t* node = it->_node;
+	while((node = _tree_next_node(it->_root, node, it->_limit)) != NULL) {
+		if (node->_flags & _TREE_NODE_ENTRY) {
+			it->_node = node;
+			it->data = node->_buffer;
+			it->key = node->_key;
+			it->depth = node->_depth;
+			return it;
 		}
-		parent->_children[parent->_num_children - 1] = NULL;
-		parent->_num_children--;
 	}
-	
-tree_delete_end:
-	CC_FREE(stack);
-	CC_FREE(vec);
-	return;
+
+	// End reached, invalidate iterator
+	CC_FREE(it);
+	return NULL;
 }
 
-int _tree_depth(tree_t* tree, char* key, char* sep) {
+size_t _tree_walk(tree_t* tree, const char* key, const char* sep, size_t max_depth, tree_visit_t fn, void* ctx) {
 	// Error check
-	if (!tree || tree->_length == 0) { return -1; }
+	if (!tree || tree->_length == 0 || !fn) { return 0; }
+	_tree_node_t* root = _tree_locate(tree, 0, 1, key, sep);
+	if (!root) { return 0; }
 
-	// Follow the path through the tree if provided
-	if (key) {
-		_tree_node_t* node = _tree_find_node(tree, tree->_root, NULL, NULL, 0, key, sep);
-		if (!node) { return -1; }
-		int count = 0;
-		char *pch = key;
-		while((pch = strpbrk(pch, sep)) != NULL) {
+	// Visit the subtree in pre-order without any auxiliary storage, pruning below the depth limit
+	size_t count = 0;
+	size_t limit = (max_depth > SIZE_MAX - root->_depth) ? SIZE_MAX : root->_depth + max_depth;
+	for(_tree_node_t* node = root; node; node = _tree_next_node(root, node, limit)) {
+		if (node->_flags & _TREE_NODE_ENTRY) {
 			count++;
-			pch++;
+			if (fn(node->_buffer, node->_key, ctx) != 0) { break; }
 		}
-		return count - 1;
 	}
+	return count;
+}
 
-	// Breadth-first search to find max depth
-	int depth = -1;
-	_tree_node_t* node = tree->_root;
-	_tree_node_t** queue = NULL;
-	size_t queue_capacity = tree->_length;
-	size_t queue_head = 0;
-	size_t queue_tail = 0;
-	queue = CC_CALLOC(queue_capacity, sizeof *queue);
-	if (!queue) { goto tree_depth_end; }
-
-	queue[queue_tail++] = node;
-	while((queue_tail - queue_head) > 0) {
-		node = queue[queue_head++];
-		depth++;
-		for(size_t i=0; i<node->_num_children; ++i) {
-			queue[queue_tail++] = node->_children[i];
-		}
-	}
-
-tree_depth_end:
-	CC_FREE(queue);
-	return depth;
-}
-
-char* _tree_print(_tree_node_t* node, size_t level) {
-	// Build string for current node
-	if (!node) { return NULL; }
-	char* str = NULL;
-	size_t key_len = strlen(node->_key);
-	size_t len = key_len + (level * 2) + 1;
-	str = CC_CALLOC(len, sizeof *str);
-	if (!str) { return NULL; }
-	for(size_t i=0; i<level; ++i) {
-		if (i == level - 1) {
-			strcat_s(str, len, "|-");
+void _tree_worker_chain(void** head, void** tail, void* record) {
+	// Push a released record onto a thread-private free chain
+	*(void**)record = *head;
+	*head = record;
+	if (!*tail) { *tail = record; }
+}
+
+int _tree_worker_run(void* arg) {
+	_tree_worker_t* worker = arg;
+	_tree_task_t* task = worker->_task;
+	tree_t* tree = task->_tree;
+
+	// Claim subtrees until none are left
+	size_t i;
+	while((i = atomic_fetch_add(&task->_next, 1)) < task->_count) {
+		if (atomic_load(&task->_stop)) { break; }
+		_tree_node_t* root = task->_roots[i];
+		if (task->_op == _TREE_TASK_VISIT) {
+			// Pre-order visit of the subtree
+			for(_tree_node_t* node = root; node; node = _tree_next_node(root, node, SIZE_MAX)) {
+				if (node->_flags & _TREE_NODE_ENTRY) {
+					worker->_count++;
+					if (task->_fn(node->_buffer, node->_key, task->_ctx) != 0) {
+						atomic_store(&task->_stop, 1);
+						break;
+					}
+				}
+			}
+		}
+		else if (task->_op == _TREE_TASK_DEPTH) {
+			// Pre-order walk for the deepest stored depth
+			for(_tree_node_t* node = root; node; node = _tree_next_node(root, node, SIZE_MAX)) {
+				if (node->_depth > worker->_depth) { worker->_depth = node->_depth; }
+			}
 		}
 		else {
-			strcat_s(str, len, "  ");
+			// Post-order walk collecting released nodes on private chains
+			_tree_node_t* v = root;
+			while(v) {
+				if (v->_first_child) {
+					v = v->_first_child;
+					continue;
+				}
+				_tree_node_t* next = (v == root) ? NULL : v->_next_sibling;
+				_tree_node_t* up = (v == root) ? NULL : v->_parent;
+				if (up && !next) { up->_first_child = NULL; }
+				if (v->_flags & _TREE_NODE_ENTRY) { worker->_count++; }
+				if (worker->_depth_counts) { worker->_depth_counts[v->_depth]++; }
+				worker->_nodes++;
+				if (!_tree_data_inline(tree)) {
+					_tree_worker_chain(&worker->_free_payloads, &worker->_free_payloads_tail, v->_buffer);
+				}
+				size_t c = _tree_key_class(strlen(v->_key) + 1);
+				_tree_worker_chain((void**)&worker->_free_keys[c], (void**)&worker->_free_keys_tail[c], v->_key);
+				_tree_worker_chain(&worker->_free_nodes, &worker->_free_nodes_tail, v);
+				v = (next) ? next : up;
+			}
+		}
+	}
+	return 0;
+}
+
+int _tree_task_split(_tree_task_t* task, _tree_node_t* start, size_t target, _tree_node_t*** upper, size_t* upper_count) {
+	_tree_node_t** roots = CC_MALLOC(sizeof *roots);
+	size_t count = 1;
+	if (!roots) { return 0; }
+	roots[0] = start;
+
+	// Expand the frontier one level at a time until there are enough subtrees to share out
+	while(count < target) {
+		size_t next_count = 0;
+		size_t expand = 0;
+		for(size_t i=0; i<count; ++i) {
+			next_count += (roots[i]->_num_children > 0) ? roots[i]->_num_children : 1;
+			expand += (roots[i]->_num_children > 0) ? 1 : 0;
+		}
+		if (expand == 0) { break; }
+		_tree_node_t** next_roots = CC_MALLOC(next_count * sizeof *next_roots);
+		_tree_node_t** next_upper = CC_REALLOC(*upper, (*upper_count + expand) * sizeof **upper);
+		if (next_upper) { *upper = next_upper; }
+		if (!next_roots || !next_upper) {
+			CC_FREE(next_roots);
+			break;
+		}
+
+		// Nodes with children move above the frontier, leaves stay on it
+		size_t n = 0;
+		for(size_t i=0; i<count; ++i) {
+			if (roots[i]->_num_children == 0) {
+				next_roots[n++] = roots[i];
+				continue;
+			}
+			(*upper)[(*upper_count)++] = roots[i];
+			for(_tree_node_t* child = roots[i]->_first_child; child; child = child->_next_sibling) {
+				next_roots[n++] = child;
+			}
+		}
+		CC_FREE(roots);
+		roots = next_roots;
+		count = n;
+	}
+	task->_roots = roots;
+	task->_count = count;
+	return 1;
+}
+
+void _tree_task_run(_tree_task_t* task, _tree_node_t* start, size_t threads, _tree_worker_t* result) {
+	tree_t* tree = task->_tree;
+	_tree_node_t** upper = NULL;
+	size_t upper_count = 0;
+	_tree_worker_t* workers = NULL;
+	thrd_t* handles = NULL;
+	size_t* counts = NULL;
+
+	// Split large subtrees across threads, otherwise walk everything on the calling thread
+	int split = 0;
+	if (threads > 1 && tree->_length >= TREE_PARALLEL_MIN_NODES) {
+		workers = CC_CALLOC(threads, sizeof *workers);
+		handles = CC_CALLOC(threads, sizeof *handles);
+		if (task->_op == _TREE_TASK_DELETE && threads <= SIZE_MAX / sizeof *counts / CC_MAX(tree->_depth_capacity, (size_t)1)) {
+			counts = CC_CALLOC(threads * tree->_depth_capacity, sizeof *counts);
+		}
+		split = (workers && handles && (counts || task->_op != _TREE_TASK_DELETE)) &&
+			_tree_task_split(task, start, threads * TREE_PARALLEL_GRAIN, &upper, &upper_count);
+	}
+	if (!split) {
+		CC_FREE(upper);
+		CC_FREE(workers);
+		CC_FREE(handles);
+		CC_FREE(counts);
+
+		// Serial deletes go straight through the pools
+		if (task->_op == _TREE_TASK_DELETE) {
+			_tree_subtree_release(tree, start);
+			return;
+		}
+		upper = NULL;
+		upper_count = 0;
+		workers = result;
+		handles = NULL;
+		threads = 1;
+		task->_roots = &start;
+		task->_count = 1;
+	}
+
+	// Deleting threads count released depths in private histograms
+	if (counts) {
+		for(size_t i=0; i<threads; ++i) {
+			workers[i]._depth_counts = counts + i * tree->_depth_capacity;
+		}
+	}
+	atomic_store(&task->_next, 0);
+	atomic_store(&task->_stop, 0);
+
+	// Handle the nodes above the frontier on the calling thread
+	for(size_t i=0; i<upper_count; ++i) {
+		_tree_node_t* node = upper[i];
+		if (task->_op == _TREE_TASK_VISIT && (node->_flags & _TREE_NODE_ENTRY) && !atomic_load(&task->_stop)) {
+			result->_count++;
+			if (task->_fn(node->_buffer, node->_key, task->_ctx) != 0) { atomic_store(&task->_stop, 1); }
+		}
+		else if (task->_op == _TREE_TASK_DEPTH && node->_depth > result->_depth) {
+			result->_depth = node->_depth;
+		}
+	}
+
+	// Share the subtrees out between the calling thread & the helpers
+	size_t started = 1;
+	for(size_t i=1; i<threads; ++i) {
+		workers[i]._task = task;
+		if (thrd_create(&handles[i], _tree_worker_run, &workers[i]) != thrd_success) { break; }
+		started++;
+	}
+	workers[0]._task = task;
+	_tree_worker_run(&workers[0]);
+	for(size_t i=1; i<started; ++i) {
+		thrd_join(handles[i], NULL);
+	}
+
+	// Combine per-thread results, splicing released nodes back into the pools
+	for(size_t i=0; i<started; ++i) {
+		_tree_worker_t* worker = &workers[i];
+		if (worker != result) {
+			result->_count += worker->_count;
+			result->_nodes += worker->_nodes;
+			if (worker->_depth > result->_depth) { result->_depth = worker->_depth; }
+		}
+		if (worker->_free_nodes) {
+			*(void**)worker->_free_nodes_tail = tree->_nodes._free;
+			tree->_nodes._free = worker->_free_nodes;
+		}
+		if (worker->_free_payloads) {
+			*(void**)worker->_free_payloads_tail = tree->_payloads._free;
+			tree->_payloads._free = worker->_free_payloads;
+		}
+		for(size_t c=0; c<TREE_KEY_CLASSES; ++c) {
+			if (!worker->_free_keys[c]) { continue; }
+			memcpy_s(worker->_free_keys_tail[c], sizeof(char*), &tree->_key_free[c], sizeof(char*));
+			tree->_key_free[c] = worker->_free_keys[c];
+		}
+		if (worker->_depth_counts) {
+			for(size_t d=0; d<tree->_depth_capacity; ++d) {
+				if (worker->_depth_counts[d]) { _tree_depth_remove(tree, d, worker->_depth_counts[d]); }
+			}
+		}
+	}
+	if (task->_op == _TREE_TASK_DELETE) {
+		tree->_length -= result->_nodes;
+		tree->_entries -= result->_count;
+		for(size_t i=0; i<upper_count; ++i) {
+			_tree_node_release(tree, upper[i]);
+		}
+	}
+
+	// Cleanup
+	if (split) {
+		CC_FREE(task->_roots);
+		CC_FREE(workers);
+		CC_FREE(handles);
+	}
+	CC_FREE(counts);
+	CC_FREE(upper);
+}
+
+size_t _tree_walk_parallel(tree_t* tree, const char* key, const char* sep, tree_visit_t fn, void* ctx, size_t threads) {
+	// Error check
+	if (!tree || tree->_length == 0 || !fn) { return 0; }
+	_tree_node_t* root = _tree_locate(tree, 0, 1, key, sep);
+	if (!root) { return 0; }
+
+	_tree_task_t task = { 0 };
+	task._tree = tree;
+	task._op = _TREE_TASK_VISIT;
+	task._fn = fn;
+	task._ctx = ctx;
+	_tree_worker_t result = { 0 };
+	_tree_task_run(&task, root, threads, &result);
+	return result._count;
+}
+
+void _tree_delete_parallel(tree_t* tree, const char* key, const char* sep, size_t threads) {
+	// Error check
+	if (!tree || tree->_length == 0) { return; }
+
+	// Deleting from the root empties the whole tree
+	_tree_node_t* node = _tree_locate(tree, 0, 1, key, sep);
+	if (!node) { return; }
+	if (node == tree->_root) {
+		_tree_clear(tree);
+		return;
+	}
+
+	// Unlink the subtree from its parent & release it
+	_tree_node_t* parent = node->_parent;
+	_tree_node_unlink(node);
+	_tree_task_t task = { 0 };
+	task._tree = tree;
+	task._op = _TREE_TASK_DELETE;
+	_tree_worker_t result = { 0 };
+	_tree_task_run(&task, node, threads, &result);
+	_tree_radix_merge(tree, parent);
+}
+
+int _tree_depth_parallel(tree_t* tree, const char* key, const char* sep, size_t threads) {
+	// Error check
+	if (!tree || tree->_length == 0) { return -1; }
+	_tree_node_t* root = _tree_locate(tree, 0, 0, key, sep);
+	if (!root) { return -1; }
+
+	_tree_task_t task = { 0 };
+	task._tree = tree;
+	task._op = _TREE_TASK_DEPTH;
+	_tree_worker_t result = { 0 };
+	_tree_task_run(&task, root, threads, &result);
+	return (int)(result._depth - root->_depth);
+}
+
+void _tree_writer_put(_tree_writer_t* writer, const char* str, size_t len) {
+	// Error check
+	if (writer->_error || len == 0) { return; }
+
+	// Stream straight to the file
+	if (writer->_file) {
+		if (fwrite(str, 1, len, writer->_file) != len) { writer->_error = 1; }
+		writer->_length += len;
+		return;
+	}
+
+	// Grow the string geometrically, keeping room for the terminator
+	if (writer->_length + len + 1 > writer->_capacity) {
+		size_t capacity = CC_MAX(writer->_capacity, TREE_PRINT_DEFAULT_CAPACITY);
+		while(writer->_length + len + 1 > capacity) { capacity *= 2; }
+		char* temp = CC_REALLOC(writer->_buffer, capacity);
+		if (!temp) {
+			writer->_error = 1;
+			return;
 		}
+		writer->_buffer = temp;
+		writer->_capacity = capacity;
 	}
-	strcat_s(str, len, node->_key);
+	memcpy_s(writer->_buffer + writer->_length, writer->_capacity - writer->_length, str, len);
+	writer->_length += len;
+	writer->_buffer[writer->_length] = '\0';
+}
 
-	// Iterate to children
-	for(size_t i=0; i<node->_num_children; ++i) {
-		char* child = _tree_print(node->_children[i], level + 1);
-		size_t child_len = strlen(child);
-		size_t cat_len = len + child_len + 1;
-		char* cat = CC_CALLOC(cat_len, sizeof *cat);
-		if (!cat) { 
-			CC_FREE(child);
-			CC_FREE(str);
-			return NULL; 
+void _tree_writer_key(_tree_writer_t* writer, const char* key, int json) {
+	// Write runs of plain characters in one go, translating radix seperators & JSON escapes
+	static const char hex[] = "0123456789abcdef";
+	const char* run = key;
+	const char* pch = key;
+	for(; *pch; ++pch) {
+		unsigned char c = (unsigned char)*pch;
+		if (c == TREE_RADIX_SEP) {
+			_tree_writer_put(writer, run, (size_t)(pch - run));
+			char sep = TREE_PRINT_SEP;
+			_tree_writer_put(writer, &sep, 1);
+			run = pch + 1;
+		}
+		else if (json && (c == '"' || c == '\\' || c < 0x20)) {
+			_tree_writer_put(writer, run, (size_t)(pch - run));
+			char esc[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+			if (c == '"' || c == '\\') {
+				esc[1] = (char)c;
+				_tree_writer_put(writer, esc, 2);
+			}
+			else {
+				_tree_writer_put(writer, esc, 6);
+			}
+			run = pch + 1;
 		}
-		strcat_s(cat, cat_len, str);
-		strcat_s(cat, cat_len, "\n");
-		strcat_s(cat, cat_len, child);
-		CC_FREE(str);
-		CC_FREE(child);
-		str = cat;
-		len = cat_len;
 	}
-	return str;
+	_tree_writer_put(writer, run, (size_t)(pch - run));
+}
+
+void _tree_write(tree_t* tree, _tree_writer_t* writer, int format) {
+	// Single pre-order pass, emitting an open on the way down & a close on the way back up
+	_tree_node_t* root = tree->_root;
+	_tree_node_t* node = root;
+	size_t level = 0;
+	int enter = 1;
+	while(node && !writer->_error) {
+		if (enter) {
+			// Open the node
+			if (format == TREE_PRINT_JSON) {
+				if (node == root) {
+					_tree_writer_put(writer, "{", 1);
+				}
+				else {
+					if (node != node->_parent->_first_child) { _tree_writer_put(writer, ", ", 2); }
+					_tree_writer_put(writer, "\"", 1);
+					_tree_writer_key(writer, node->_key, 1);
+					_tree_writer_put(writer, "\": {", 4);
+				}
+			}
+			else {
+				if (format == TREE_PRINT_TEXT) {
+					if (node != root) { _tree_writer_put(writer, "\n", 1); }
+					for(size_t i=1; i<level; ++i) { _tree_writer_put(writer, "  ", 2); }
+					if (level > 0) { _tree_writer_put(writer, "|-", 2); }
+				}
+				else {
+					for(size_t i=0; i<level; ++i) { _tree_writer_put(writer, "  ", 2); }
+				}
+				_tree_writer_key(writer, node->_key, 0);
+				if (format == TREE_PRINT_INDENT) { _tree_writer_put(writer, "\n", 1); }
+			}
+
+			// Descend to the first child
+			if (node->_first_child) {
+				node = node->_first_child;
+				level++;
+				continue;
+			}
+		}
+
+		// Close the node, then move across to its sibling or back up to its parent
+		if (format == TREE_PRINT_JSON) { _tree_writer_put(writer, "}", 1); }
+		if (node == root) { break; }
+		if (node->_next_sibling) {
+			node = node->_next_sibling;
+			enter = 1;
+		}
+		else {
+			node = node->_parent;
+			level--;
+			enter = 0;
+		}
+	}
+}
+
+char* _tree_print(tree_t* tree, int format) {
+	// Error check
+	if (!tree || tree->_length == 0) { return NULL; }
+
+	// Write into a single growable string
+	_tree_writer_t writer = { 0 };
+	_tree_write(tree, &writer, format);
+	if (writer._error) {
+		CC_FREE(writer._buffer);
+		return NULL;
+	}
+	return writer._buffer;
+}
+
+size_t _tree_fprint(tree_t* tree, FILE* file, int format) {
+	// Error check
+	if (!tree || tree->_length == 0 || !file) { return 0; }
+
+	// Stream directly to the file
+	_tree_writer_t writer = { 0 };
+	writer._file = file;
+	_tree_write(tree, &writer, format);
+	return (writer._error) ? 0 : writer._length;
 }
 
 size_t _tree_serialize(tree_t* tree, char* str) {
@@ -318,13 +1062,13 @@ size_t _tree_serialize(tree_t* tree, char* str) {
 
 			pch += node_len;
 			len += node_len;
-		}
 
-		// Add nodes children
-		for(size_t i=0; i<v->_num_children; ++i) {
-			stack[stack_size++] = v->_children[i];
+			// Add nodes children
+			for(_tree_node_t* child = v->_first_child; child; child = child->_next_sibling) {
+				stack[stack_size++] = child;
+			}
+			stack[stack_size++] = NULL;
 		}
-		stack[stack_size++] = NULL;
 	}
 	
 	// Write final length to the start of the block
@@ -1,5 +1,35 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
 #include "cc/vector.h"
+#include <string.h>
 #include <math.h>
+#include <stdbool.h>
+
+#if !defined(_WIN32)
+#define CC_VEC_MAPPED
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#if !defined(MAP_ANONYMOUS)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CC_VEC_X86
+#include <immintrin.h>
+#include <threads.h>
+#if defined(_MSC_VER)
+#define CC_VEC_TARGET_SSE2
+#define CC_VEC_TARGET_AVX2
+#else
+#define CC_VEC_TARGET_SSE2 __attribute__((target("sse2")))
+#define CC_VEC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
 
 size_t _vec_size(size_t element_size, size_t capacity) {
 	size_t c = element_size * capacity;
@@ -17,6 +47,200 @@ vector_t* _vec_factory(size_t element_size, size_t capacity) {
 	return vec;
 }
 
+vector_t* _vec_factory_inline(void* storage, size_t storage_size, size_t element_size) {
+	// Error check
+	if (!storage || element_size == 0 || storage_size < _vec_inline_size(element_size, 1)) { return NULL; }
+
+	// Lay the header over the caller's storage, the rest is the element buffer
+	vector_t* vec = storage;
+	memset(vec, 0, sizeof(vector_t));
+	vec->_capacity = (storage_size - offsetof(vector_t, _buffer)) / element_size;
+	vec->_element_size = element_size;
+	vec->_flags = VECTOR_FLAG_INLINE;
+	return vec;
+}
+
+void _vec_destroy(vector_t* vec) {
+	// Inline storage belongs to the caller
+	if (!vec || (vec->_flags & VECTOR_FLAG_INLINE)) { return; }
+	if (vec->_flags & VECTOR_FLAG_MAPPED) {
+		_vec_close(vec);
+		return;
+	}
+	CC_FREE(vec);
+}
+
+#if defined(CC_VEC_MAPPED)
+static uint8_t* _vec_map(int fd, size_t page, size_t bytes) {
+	// Reserve a private page for the handle & vector header, then lay the elements of the file right after it
+	uint8_t* base = mmap(NULL, page + bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED) { return NULL; }
+	void* data = mmap(base + page, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, VECTOR_MAPPED_HEAD);
+	if (data == MAP_FAILED) {
+		munmap(base, page + bytes);
+		return NULL;
+	}
+	return base;
+}
+#endif
+
+vector_t* _vec_open(const char* path, size_t element_size) {
+#if defined(CC_VEC_MAPPED)
+	// Error check
+	if (!path || element_size == 0) { return NULL; }
+	long page_size = sysconf(_SC_PAGESIZE);
+	size_t page = (size_t)((page_size > 0) ? page_size : 4096);
+	size_t head = _vec_mapped_size + offsetof(vector_t, _buffer);
+	if (VECTOR_MAPPED_HEAD % page != 0 || page < head) { return NULL; }
+	int fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (fd < 0) { return NULL; }
+
+	// One writer at a time, each keeps its own length until it writes it back
+	if (flock(fd, LOCK_EX | LOCK_NB) != 0) { goto vec_open_close; }
+	struct stat st;
+	if (fstat(fd, &st) != 0) { goto vec_open_close; }
+
+	// A new file gets one page of elements, the capacity of an old one follows from its size
+	size_t size = (size_t)st.st_size;
+	bool fresh = (size == 0);
+	if (fresh) {
+		size = VECTOR_MAPPED_HEAD + CC_MAX(page, element_size);
+		if (ftruncate(fd, (off_t)size) != 0) { goto vec_open_close; }
+	}
+	if (size < VECTOR_MAPPED_HEAD + element_size) { goto vec_open_close; }
+	size_t capacity = (size - VECTOR_MAPPED_HEAD) / element_size;
+
+	// Stamp a new file, or check an old one was written by a vector of the same element size
+	_vec_file_t* file = mmap(NULL, sizeof(_vec_file_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (file == MAP_FAILED) { goto vec_open_close; }
+	if (fresh) {
+		file->_magic = VECTOR_MAPPED_MAGIC;
+		file->_element_size = element_size;
+		file->_length = 0;
+	}
+	else if (file->_magic != VECTOR_MAPPED_MAGIC || file->_element_size != element_size || file->_length > capacity) {
+		goto vec_open_unmap;
+	}
+	uint8_t* base = _vec_map(fd, page, capacity * element_size);
+	if (!base) { goto vec_open_unmap; }
+
+	// Fill in the local handle & header
+	vector_t* vec = (vector_t*)(base + page - offsetof(vector_t, _buffer));
+	_vec_mapped_t* map = _vec_mapped(vec);
+	map->_fd = fd;
+	map->_page = page;
+	map->_map_size = page + (capacity * element_size);
+	map->_base = base;
+	map->_file = file;
+	vec->_length = (size_t)file->_length;
+	vec->_capacity = capacity;
+	vec->_element_size = element_size;
+	vec->_flags = VECTOR_FLAG_MAPPED;
+	return vec;
+
+vec_open_unmap:
+	munmap(file, sizeof(_vec_file_t));
+vec_open_close:
+	close(fd);
+	return NULL;
+#else
+	// No mmap, file-backed vectors are unavailable
+	(void)path;
+	(void)element_size;
+	return NULL;
+#endif
+}
+
+void _vec_close(vector_t* vec) {
+#if defined(CC_VEC_MAPPED)
+	// Error check
+	if (!vec || !(vec->_flags & VECTOR_FLAG_MAPPED)) { return; }
+
+	// Store the length, dirty pages reach the file through the page cache even without a flush
+	_vec_mapped_t map = *_vec_mapped(vec);
+	map._file->_length = vec->_length;
+	munmap(map._file, sizeof(_vec_file_t));
+	munmap(map._base, map._map_size);
+	close(map._fd);
+#else
+	(void)vec;
+#endif
+}
+
+vector_t* _vec_remap(vector_t* vec, size_t new_capacity) {
+#if defined(CC_VEC_MAPPED)
+	// Grow or shrink the file first, then the mapping over it
+	_vec_mapped_t* map = _vec_mapped(vec);
+	if (_vec_size(vec->_element_size, new_capacity) == 0) { return NULL; }
+	size_t bytes = new_capacity * vec->_element_size;
+	if (bytes > SIZE_MAX - VECTOR_MAPPED_HEAD - map->_page) { return NULL; }
+	if (ftruncate(map->_fd, (off_t)(VECTOR_MAPPED_HEAD + bytes)) != 0) { return NULL; }
+	map->_file->_length = vec->_length;
+#if defined(MREMAP_MAYMOVE)
+	// The elements must stay right behind the local page, so only resize in place, without letting the kernel move them
+	if (mremap(map->_base + map->_page, map->_map_size - map->_page, bytes, 0) != MAP_FAILED) {
+		map->_map_size = map->_page + bytes;
+		vec->_capacity = new_capacity;
+		return vec;
+	}
+#endif
+
+	// Map the file again behind a new local page & carry the handle & header over
+	uint8_t* base = _vec_map(map->_fd, map->_page, bytes);
+	if (!base) { return NULL; }
+	size_t head = _vec_mapped_size + offsetof(vector_t, _buffer);
+	memcpy_s(base + map->_page - head, head, map, head);
+	vec = (vector_t*)(base + map->_page - offsetof(vector_t, _buffer));
+	munmap(map->_base, map->_map_size);
+	map = _vec_mapped(vec);
+	map->_base = base;
+	map->_map_size = map->_page + bytes;
+	vec->_capacity = new_capacity;
+	return vec;
+#else
+	(void)vec;
+	(void)new_capacity;
+	return NULL;
+#endif
+}
+
+bool _vec_flush(vector_t* vec) {
+#if defined(CC_VEC_MAPPED)
+	// Error check
+	if (!vec || !(vec->_flags & VECTOR_FLAG_MAPPED)) { return false; }
+	_vec_mapped_t* map = _vec_mapped(vec);
+	map->_file->_length = vec->_length;
+	return msync(map->_base + map->_page, map->_map_size - map->_page, MS_SYNC) == 0 && msync(map->_file, sizeof(_vec_file_t), MS_SYNC) == 0;
+#else
+	(void)vec;
+	return false;
+#endif
+}
+
+bool _vec_advise(vector_t* vec, vector_advice_t advice) {
+#if defined(CC_VEC_MAPPED)
+	// Error check
+	if (!vec || !(vec->_flags & VECTOR_FLAG_MAPPED)) { return false; }
+
+	// Translate to the madvise hint
+	int flag;
+	switch(advice) {
+		case VECTOR_ADVICE_NORMAL: flag = MADV_NORMAL; break;
+		case VECTOR_ADVICE_SEQUENTIAL: flag = MADV_SEQUENTIAL; break;
+		case VECTOR_ADVICE_RANDOM: flag = MADV_RANDOM; break;
+		case VECTOR_ADVICE_WILLNEED: flag = MADV_WILLNEED; break;
+		case VECTOR_ADVICE_DONTNEED: flag = MADV_DONTNEED; break;
+		default: return false;
+	}
+	_vec_mapped_t* map = _vec_mapped(vec);
+	return madvise(map->_base + map->_page, map->_map_size - map->_page, flag) == 0;
+#else
+	(void)vec;
+	(void)advice;
+	return false;
+#endif
+}
+
 vector_t* _vec_resize(vector_t* vec, size_t new_capacity) {
 	// Calculate new capacity
 	if (new_capacity == 0) {
@@ -25,13 +249,17 @@ vector_t* _vec_resize(vector_t* vec, size_t new_capacity) {
 	}
 	if (new_capacity > VECTOR_MAX_CAPACITY || new_capacity < vec->_length) { return NULL; }
 
+	// File-backed vectors resize in place in the file
+	if (vec->_flags & VECTOR_FLAG_MAPPED) { return _vec_remap(vec, new_capacity); }
+
 	// Create new vector & copy data to it
 	vector_t* new_vec = _vec_factory(vec->_element_size, new_capacity);
 	if (!new_vec) { return NULL; }
 	size_t dest_size = vec->_length * vec->_element_size;
 	memcpy_s(new_vec->_buffer, dest_size, vec->_buffer, dest_size);
 	new_vec->_length = vec->_length;
-	CC_FREE(vec);
+	new_vec->_flags = vec->_flags & ~VECTOR_FLAG_INLINE;
+	_vec_destroy(vec);
 	return new_vec;
 }
 
@@ -69,13 +297,12 @@ void* _vec_insert(vector_t** vec, size_t index, void* data) {
 void _vec_remove(vector_t* vec, size_t index, size_t count) {
 	// Error check
 	if (!vec) { return; }
-	if ((index + count) >= vec->_length) { return; }
+	if (count > vec->_length || index > vec->_length - count) { return; }
 	
 	// Shift over elements
-	if (index < vec->_length) {
+	if (index + count < vec->_length) {
 		void* dest = (void*)(_vec_pos(vec, index));
 		void* src = (void*)(_vec_pos(vec, index + count));
-		if (!dest || !src) { return; }
 		size_t move_size = vec->_element_size * (vec->_length - index - count);
 		memmove_s(dest, move_size, src, move_size);
 	}
@@ -84,23 +311,458 @@ void _vec_remove(vector_t* vec, size_t index, size_t count) {
 	vec->_length -= count;
 }
 
+void _vec_swap_remove(vector_t* vec, size_t index) {
+	// Error check
+	if (!vec || index >= vec->_length) { return; }
+
+	// Fill the hole with the last element
+	vec->_length--;
+	if (index < vec->_length) {
+		memcpy_s(_vec_pos(vec, index), vec->_element_size, _vec_pos(vec, vec->_length), vec->_element_size);
+	}
+}
+
+size_t _vec_erase_if(vector_t* vec, vector_predicate_t pred, void* ctx) {
+	// Error check
+	if (!vec || !pred) { return 0; }
+
+	// Slide each run of survivors down over the gaps in one memmove
+	size_t write = 0;
+	size_t run = 0;
+	for(size_t i=0; i<vec->_length; ++i) {
+		if (!pred(_vec_pos(vec, i), ctx)) { continue; }
+		if (i > run) {
+			if (write != run) { memmove_s(_vec_pos(vec, write), (i - run) * vec->_element_size, _vec_pos(vec, run), (i - run) * vec->_element_size); }
+			write += i - run;
+		}
+		run = i + 1;
+	}
+	if (vec->_length > run) {
+		if (write != run) { memmove_s(_vec_pos(vec, write), (vec->_length - run) * vec->_element_size, _vec_pos(vec, run), (vec->_length - run) * vec->_element_size); }
+		write += vec->_length - run;
+	}
+	size_t removed = vec->_length - write;
+	vec->_length = write;
+	return removed;
+}
+
+size_t _vec_erase_indices(vector_t* vec, const size_t* indices, size_t count) {
+	// Error check, the indices must be sorted & in range, repeats are removed once
+	if (!vec || (!indices && count > 0)) { return 0; }
+	for(size_t i=0; i<count; ++i) {
+		if (indices[i] >= vec->_length || (i > 0 && indices[i] < indices[i - 1])) { return 0; }
+	}
+
+	// Move the survivors between consecutive indices down in one pass
+	size_t write = (count > 0) ? indices[0] : vec->_length;
+	for(size_t i=0; i<count; ++i) {
+		if (i > 0 && indices[i] == indices[i - 1]) { continue; }
+		size_t run = indices[i] + 1;
+		size_t end = vec->_length;
+		for(size_t j=i+1; j<count; ++j) {
+			if (indices[j] != indices[i]) {
+				end = indices[j];
+				break;
+			}
+		}
+		if (end > run) {
+			memmove_s(_vec_pos(vec, write), (end - run) * vec->_element_size, _vec_pos(vec, run), (end - run) * vec->_element_size);
+			write += end - run;
+		}
+	}
+	size_t removed = vec->_length - write;
+	vec->_length = write;
+	return removed;
+}
+
+void _vec_swap_bytes(uint8_t* a, uint8_t* b, size_t size) {
+	// Exchange through a small stack buffer, a chunk at a time for large elements
+	uint8_t tmp[VECTOR_SWAP_CHUNK];
+	while(size > 0) {
+		size_t n = CC_MIN(size, (size_t)VECTOR_SWAP_CHUNK);
+		memcpy(tmp, a, n);
+		memcpy(a, b, n);
+		memcpy(b, tmp, n);
+		a += n;
+		b += n;
+		size -= n;
+	}
+}
+
 void _vec_swap(vector_t* vec, size_t a, size_t b) {
 	// Error check
 	if (!vec) { return; }
-	if (a >= vec->_length || b >= vec->_length) { return; }
+	if (a >= vec->_length || b >= vec->_length || a == b) { return; }
+	_vec_swap_bytes(_vec_pos(vec, a), _vec_pos(vec, b), vec->_element_size);
+}
 
-	// Swap elements with temp buffer
-	uint8_t* pos_a = _vec_pos(vec, a);
-	uint8_t* pos_b = _vec_pos(vec, b);
-	uint8_t* _tmp_buffer = CC_MALLOC(vec->_element_size);
-	if (!_tmp_buffer) { return; }
-	memmove_s(_tmp_buffer, vec->_element_size, pos_a, vec->_element_size);
-	memmove_s(pos_a, vec->_element_size, pos_b, vec->_element_size);
-	memmove_s(pos_b, vec->_element_size, _tmp_buffer, vec->_element_size);
-	CC_FREE(_tmp_buffer);
+void _vec_reverse(vector_t* vec, size_t first, size_t last) {
+	// Error check
+	if (!vec || first > last || last > vec->_length) { return; }
+
+	// Swap inwards from both ends of [first, last)
+	while(last - first > 1) {
+		last--;
+		_vec_swap_bytes(_vec_pos(vec, first), _vec_pos(vec, last), vec->_element_size);
+		first++;
+	}
+}
+
+void _vec_rotate(vector_t* vec, size_t count) {
+	// Error check
+	if (!vec || vec->_length == 0) { return; }
+	count %= vec->_length;
+	if (count == 0) { return; }
+
+	// Three reversals move [count, length) in front of [0, count) without a buffer
+	_vec_reverse(vec, 0, count);
+	_vec_reverse(vec, count, vec->_length);
+	_vec_reverse(vec, 0, vec->_length);
+}
+
+void _vec_shuffle(vector_t* vec, uint64_t seed) {
+	// Error check
+	if (!vec || vec->_length < 2) { return; }
+
+	// Fisher-Yates driven by xorshift64*, seeded through splitmix64 so nearby seeds diverge
+	uint64_t state = seed + 0x9E3779B97F4A7C15ULL;
+	state = (state ^ (state >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	state = (state ^ (state >> 27)) * 0x94D049BB133111EBULL;
+	state = (state ^ (state >> 31)) | 1;
+	for(size_t i=vec->_length-1; i>0; --i) {
+		// Reject the top sliver of the range so every index is equally likely
+		uint64_t bound = (uint64_t)i + 1;
+		uint64_t threshold = (0 - bound) % bound;
+		uint64_t r;
+		do {
+			state ^= state >> 12;
+			state ^= state << 25;
+			state ^= state >> 27;
+			r = state * 0x2545F4914F6CDD1DULL;
+		} while(r < threshold);
+		size_t j = (size_t)(r % bound);
+		if (j != i) { _vec_swap_bytes(_vec_pos(vec, i), _vec_pos(vec, j), vec->_element_size); }
+	}
+}
+
+bool _vec_apply_permutation(vector_t* vec, size_t* perm) {
+	// Error check
+	if (!vec || !perm) { return false; }
+	size_t n = vec->_length;
+	const size_t mark = ~(SIZE_MAX >> 1);
+
+	// Flag every index as a target once, borrowing the top bit of the table, to prove it is a permutation
+	for(size_t i=0; i<n; ++i) {
+		size_t t = perm[i] & ~mark;
+		if (t >= n || (perm[t] & mark)) {
+			for(size_t j=0; j<n; ++j) { perm[j] &= ~mark; }
+			return false;
+		}
+		perm[t] |= mark;
+	}
+
+	// Walk each cycle with swaps, clearing the flags as positions are filled so the table ends up as it started
+	for(size_t i=0; i<n; ++i) {
+		if (!(perm[i] & mark)) { continue; }
+		size_t j = i;
+		while((perm[j] & ~mark) != i) {
+			size_t next = perm[j] & ~mark;
+			_vec_swap_bytes(_vec_pos(vec, j), _vec_pos(vec, next), vec->_element_size);
+			perm[j] &= ~mark;
+			j = next;
+		}
+		perm[j] &= ~mark;
+	}
+	return true;
 }
 
 void _vec_sort(vector_t* vec) {
 	// Error check
 	if (!vec) { return; }
-}
\ No newline at end of file
+}
+
+// Scalar kernel, walking keys at any stride. Written as !(in range) so NaN never matches.
+#define _VEC_SCAN_SCALAR(name, T) \
+static size_t name(const uint8_t* data, size_t count, size_t stride, const void* lo, const void* hi, int op, uint8_t* out) { \
+	T l, h; \
+	memcpy(&l, lo, sizeof(T)); \
+	memcpy(&h, hi, sizeof(T)); \
+	size_t hits = 0; \
+	for(size_t i=0; i<count; ++i) { \
+		T x; \
+		memcpy(&x, data + (i * stride), sizeof(T)); \
+		if (!(x >= l && x <= h)) { continue; } \
+		if (op == _VEC_SCAN_FIND) { return i; } \
+		if (op == _VEC_SCAN_COPY) { memcpy(out + (hits * stride), data + (i * stride), stride); } \
+		hits++; \
+	} \
+	return (op == _VEC_SCAN_FIND) ? count : hits; \
+}
+
+_VEC_SCAN_SCALAR(_vec_scan_scalar_i8, int8_t)
+_VEC_SCAN_SCALAR(_vec_scan_scalar_u8, uint8_t)
+_VEC_SCAN_SCALAR(_vec_scan_scalar_i16, int16_t)
+_VEC_SCAN_SCALAR(_vec_scan_scalar_u16, uint16_t)
+_VEC_SCAN_SCALAR(_vec_scan_scalar_i32, int32_t)
+_VEC_SCAN_SCALAR(_vec_scan_scalar_u32, uint32_t)
+_VEC_SCAN_SCALAR(_vec_scan_scalar_i64, int64_t)
+_VEC_SCAN_SCALAR(_vec_scan_scalar_u64, uint64_t)
+_VEC_SCAN_SCALAR(_vec_scan_scalar_f32, float)
+_VEC_SCAN_SCALAR(_vec_scan_scalar_f64, double)
+
+static const _vec_scan_fn _vec_scan_scalar[VECTOR_KEY_COUNT] = {
+	_vec_scan_scalar_i8, _vec_scan_scalar_u8, _vec_scan_scalar_i16, _vec_scan_scalar_u16, _vec_scan_scalar_i32,
+	_vec_scan_scalar_u32, _vec_scan_scalar_i64, _vec_scan_scalar_u64, _vec_scan_scalar_f32, _vec_scan_scalar_f64
+};
+
+static const size_t _vec_key_size[VECTOR_KEY_COUNT] = { 1, 1, 2, 2, 4, 4, 8, 8, 4, 8 };
+
+#if defined(CC_VEC_X86)
+
+// Act on a byte mask of matching lanes of W bytes each, then let the scalar kernel finish the tail
+#define _VEC_SCAN_MASK(m, W) \
+	if (m == 0) { continue; } \
+	if (op == _VEC_SCAN_FIND) { return i + (CC_CTZ64(m) / W); } \
+	if (op == _VEC_SCAN_COUNT) { \
+		hits += CC_POPCOUNT64(m) / W; \
+		continue; \
+	} \
+	while(m) { \
+		size_t j = CC_CTZ64(m) / W; \
+		memcpy(out + (hits * W), data + ((i + j) * W), W); \
+		hits++; \
+		m &= ~((((uint64_t)1 << W) - 1) << (j * W)); \
+	}
+#define _VEC_SCAN_TAIL(tail, W) \
+	size_t r = tail(data + (i * W), count - i, W, lo, hi, op, out + (hits * W)); \
+	return (op == _VEC_SCAN_FIND) ? i + r : hits + r;
+
+// Integer kernels compare signed, so unsigned keys are biased by their sign bit first
+#define _VEC_SCAN_SSE2_INT(name, tail, T, W, SET1, CMPGT, BIAS) \
+CC_VEC_TARGET_SSE2 static size_t name(const uint8_t* data, size_t count, size_t stride, const void* lo, const void* hi, int op, uint8_t* out) { \
+	(void)stride; \
+	T l, h; \
+	memcpy(&l, lo, sizeof(T)); \
+	memcpy(&h, hi, sizeof(T)); \
+	__m128i bias = SET1(BIAS); \
+	__m128i vlo = _mm_xor_si128(SET1(l), bias); \
+	__m128i vhi = _mm_xor_si128(SET1(h), bias); \
+	size_t i = 0; \
+	size_t hits = 0; \
+	for(; i + (16 / W) <= count; i += 16 / W) { \
+		__m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(data + (i * W))), bias); \
+		__m128i outside = _mm_or_si128(CMPGT(vlo, x), CMPGT(x, vhi)); \
+		uint64_t m = (uint64_t)(~_mm_movemask_epi8(outside) & 0xFFFF); \
+		_VEC_SCAN_MASK(m, W) \
+	} \
+	_VEC_SCAN_TAIL(tail, W) \
+}
+
+#define _VEC_SCAN_AVX2_INT(name, tail, T, W, SET1, CMPGT, BIAS) \
+CC_VEC_TARGET_AVX2 static size_t name(const uint8_t* data, size_t count, size_t stride, const void* lo, const void* hi, int op, uint8_t* out) { \
+	(void)stride; \
+	T l, h; \
+	memcpy(&l, lo, sizeof(T)); \
+	memcpy(&h, hi, sizeof(T)); \
+	__m256i bias = SET1(BIAS); \
+	__m256i vlo = _mm256_xor_si256(SET1(l), bias); \
+	__m256i vhi = _mm256_xor_si256(SET1(h), bias); \
+	size_t i = 0; \
+	size_t hits = 0; \
+	for(; i + (32 / W) <= count; i += 32 / W) { \
+		__m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(data + (i * W))), bias); \
+		__m256i outside = _mm256_or_si256(CMPGT(vlo, x), CMPGT(x, vhi)); \
+		uint64_t m = (uint64_t)(uint32_t)~_mm256_movemask_epi8(outside); \
+		_VEC_SCAN_MASK(m, W) \
+	} \
+	_VEC_SCAN_TAIL(tail, W) \
+}
+
+// Float kernels use ordered compares, so NaN is never in range
+#define _VEC_SCAN_SSE2_FLOAT(name, tail, T, W, SUFFIX, VEC) \
+CC_VEC_TARGET_SSE2 static size_t name(const uint8_t* data, size_t count, size_t stride, const void* lo, const void* hi, int op, uint8_t* out) { \
+	(void)stride; \
+	T l, h; \
+	memcpy(&l, lo, sizeof(T)); \
+	memcpy(&h, hi, sizeof(T)); \
+	VEC vlo = _mm_set1_##SUFFIX(l); \
+	VEC vhi = _mm_set1_##SUFFIX(h); \
+	size_t i = 0; \
+	size_t hits = 0; \
+	for(; i + (16 / W) <= count; i += 16 / W) { \
+		VEC x = _mm_loadu_##SUFFIX((const T*)(data + (i * W))); \
+		VEC inside = _mm_and_##SUFFIX(_mm_cmpge_##SUFFIX(x, vlo), _mm_cmple_##SUFFIX(x, vhi)); \
+		uint64_t m = (uint64_t)_mm_movemask_epi8(_mm_cast##SUFFIX##_si128(inside)); \
+		_VEC_SCAN_MASK(m, W) \
+	} \
+	_VEC_SCAN_TAIL(tail, W) \
+}
+
+#define _VEC_SCAN_AVX2_FLOAT(name, tail, T, W, SUFFIX, VEC) \
+CC_VEC_TARGET_AVX2 static size_t name(const uint8_t* data, size_t count, size_t stride, const void* lo, const void* hi, int op, uint8_t* out) { \
+	(void)stride; \
+	T l, h; \
+	memcpy(&l, lo, sizeof(T)); \
+	memcpy(&h, hi, sizeof(T)); \
+	VEC vlo = _mm256_set1_##SUFFIX(l); \
+	VEC vhi = _mm256_set1_##SUFFIX(h); \
+	size_t i = 0; \
+	size_t hits = 0; \
+	for(; i + (32 / W) <= count; i += 32 / W) { \
+		VEC x = _mm256_loadu_##SUFFIX((const T*)(data + (i * W))); \
+		VEC inside = _mm256_and_##SUFFIX(_mm256_cmp_##SUFFIX(x, vlo, _CMP_GE_OQ), _mm256_cmp_##SUFFIX(x, vhi, _CMP_LE_OQ)); \
+		uint64_t m = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cast##SUFFIX##_si256(inside)); \
+		_VEC_SCAN_MASK(m, W) \
+	} \
+	_VEC_SCAN_TAIL(tail, W) \
+}
+
+_VEC_SCAN_SSE2_INT(_vec_scan_sse2_i8, _vec_scan_scalar_i8, int8_t, 1, _mm_set1_epi8, _mm_cmpgt_epi8, 0)
+_VEC_SCAN_SSE2_INT(_vec_scan_sse2_u8, _vec_scan_scalar_u8, uint8_t, 1, _mm_set1_epi8, _mm_cmpgt_epi8, INT8_MIN)
+_VEC_SCAN_SSE2_INT(_vec_scan_sse2_i16, _vec_scan_scalar_i16, int16_t, 2, _mm_set1_epi16, _mm_cmpgt_epi16, 0)
+_VEC_SCAN_SSE2_INT(_vec_scan_sse2_u16, _vec_scan_scalar_u16, uint16_t, 2, _mm_set1_epi16, _mm_cmpgt_epi16, INT16_MIN)
+_VEC_SCAN_SSE2_INT(_vec_scan_sse2_i32, _vec_scan_scalar_i32, int32_t, 4, _mm_set1_epi32, _mm_cmpgt_epi32, 0)
+_VEC_SCAN_SSE2_INT(_vec_scan_sse2_u32, _vec_scan_scalar_u32, uint32_t, 4, _mm_set1_epi32, _mm_cmpgt_epi32, INT32_MIN)
+_VEC_SCAN_SSE2_FLOAT(_vec_scan_sse2_f32, _vec_scan_scalar_f32, float, 4, ps, __m128)
+_VEC_SCAN_SSE2_FLOAT(_vec_scan_sse2_f64, _vec_scan_scalar_f64, double, 8, pd, __m128d)
+
+_VEC_SCAN_AVX2_INT(_vec_scan_avx2_i8, _vec_scan_scalar_i8, int8_t, 1, _mm256_set1_epi8, _mm256_cmpgt_epi8, 0)
+_VEC_SCAN_AVX2_INT(_vec_scan_avx2_u8, _vec_scan_scalar_u8, uint8_t, 1, _mm256_set1_epi8, _mm256_cmpgt_epi8, INT8_MIN)
+_VEC_SCAN_AVX2_INT(_vec_scan_avx2_i16, _vec_scan_scalar_i16, int16_t, 2, _mm256_set1_epi16, _mm256_cmpgt_epi16, 0)
+_VEC_SCAN_AVX2_INT(_vec_scan_avx2_u16, _vec_scan_scalar_u16, uint16_t, 2, _mm256_set1_epi16, _mm256_cmpgt_epi16, INT16_MIN)
+_VEC_SCAN_AVX2_INT(_vec_scan_avx2_i32, _vec_scan_scalar_i32, int32_t, 4, _mm256_set1_epi32, _mm256_cmpgt_epi32, 0)
+_VEC_SCAN_AVX2_INT(_vec_scan_avx2_u32, _vec_scan_scalar_u32, uint32_t, 4, _mm256_set1_epi32, _mm256_cmpgt_epi32, INT32_MIN)
+_VEC_SCAN_AVX2_INT(_vec_scan_avx2_i64, _vec_scan_scalar_i64, int64_t, 8, _mm256_set1_epi64x, _mm256_cmpgt_epi64, 0)
+_VEC_SCAN_AVX2_INT(_vec_scan_avx2_u64, _vec_scan_scalar_u64, uint64_t, 8, _mm256_set1_epi64x, _mm256_cmpgt_epi64, INT64_MIN)
+_VEC_SCAN_AVX2_FLOAT(_vec_scan_avx2_f32, _vec_scan_scalar_f32, float, 4, ps, __m256)
+_VEC_SCAN_AVX2_FLOAT(_vec_scan_avx2_f64, _vec_scan_scalar_f64, double, 8, pd, __m256d)
+
+// SSE2 has no 64-bit integer compare, those keys stay scalar
+static const _vec_scan_fn _vec_scan_sse2[VECTOR_KEY_COUNT] = {
+	_vec_scan_sse2_i8, _vec_scan_sse2_u8, _vec_scan_sse2_i16, _vec_scan_sse2_u16, _vec_scan_sse2_i32,
+	_vec_scan_sse2_u32, _vec_scan_scalar_i64, _vec_scan_scalar_u64, _vec_scan_sse2_f32, _vec_scan_sse2_f64
+};
+
+static const _vec_scan_fn _vec_scan_avx2[VECTOR_KEY_COUNT] = {
+	_vec_scan_avx2_i8, _vec_scan_avx2_u8, _vec_scan_avx2_i16, _vec_scan_avx2_u16, _vec_scan_avx2_i32,
+	_vec_scan_avx2_u32, _vec_scan_avx2_i64, _vec_scan_avx2_u64, _vec_scan_avx2_f32, _vec_scan_avx2_f64
+};
+
+static const _vec_scan_fn* _vec_scan_table = NULL;
+static once_flag _vec_scan_once = ONCE_FLAG_INIT;
+
+static void _vec_scan_detect(void) {
+	// Pick the widest kernels the CPU supports
+#if defined(_MSC_VER)
+	int info[4];
+	bool sse2 = false;
+	bool avx2 = false;
+	__cpuid(info, 1);
+	sse2 = (info[3] & (1 << 26)) != 0;
+	if ((info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6) {
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] & (1 << 5)) != 0;
+	}
+#else
+	__builtin_cpu_init();
+	bool sse2 = __builtin_cpu_supports("sse2");
+	bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+	_vec_scan_table = (avx2) ? _vec_scan_avx2 : (sse2) ? _vec_scan_sse2 : _vec_scan_scalar;
+}
+
+static const _vec_scan_fn* _vec_scan_select(void) {
+	// Check the CPU once, call_once publishes the table to every thread that gets here later
+	call_once(&_vec_scan_once, _vec_scan_detect);
+	return _vec_scan_table;
+}
+
+#endif	// defined(CC_VEC_X86)
+
+_vec_scan_fn _vec_scan_kernel(vector_t* vec, vector_key_t key) {
+	// Error check
+	if (!vec || key >= VECTOR_KEY_COUNT || vec->_element_size < _vec_key_size[key]) { return NULL; }
+
+	// Only vectors of bare keys are contiguous enough for SIMD
+#if defined(CC_VEC_X86)
+	if (vec->_element_size == _vec_key_size[key]) { return _vec_scan_select()[key]; }
+#endif
+	return _vec_scan_scalar[key];
+}
+
+size_t _vec_find(vector_t* vec, vector_key_t key, void* value) {
+	// Error check
+	_vec_scan_fn scan = _vec_scan_kernel(vec, key);
+	if (!scan || !value) { return SIZE_MAX; }
+
+	// Equality is the range [value, value]
+	size_t i = scan(vec->_buffer, vec->_length, vec->_element_size, value, value, _VEC_SCAN_FIND, NULL);
+	return (i < vec->_length) ? i : SIZE_MAX;
+}
+
+size_t _vec_count(vector_t* vec, vector_key_t key, void* lo, void* hi) {
+	// Error check
+	_vec_scan_fn scan = _vec_scan_kernel(vec, key);
+	if (!scan || !lo || !hi) { return 0; }
+	return scan(vec->_buffer, vec->_length, vec->_element_size, lo, hi, _VEC_SCAN_COUNT, NULL);
+}
+
+// Branchless binary search, the compare is the only thing that depends on the key type
+#define _VEC_LOWER_BOUND(T) { \
+	T k; \
+	memcpy(&k, value, sizeof(T)); \
+	while(n > 0) { \
+		size_t half = n / 2; \
+		T x; \
+		memcpy(&x, _vec_pos(vec, first + half), sizeof(T)); \
+		first = (x < k) ? first + half + 1 : first; \
+		n = (x < k) ? n - half - 1 : half; \
+	} \
+	break; \
+}
+
+size_t _vec_lower_bound(vector_t* vec, vector_key_t key, void* value) {
+	// Error check
+	if (!vec || !value || key >= VECTOR_KEY_COUNT || vec->_element_size < _vec_key_size[key]) { return SIZE_MAX; }
+
+	// Narrow [first, first + n) down to the first key not less than the value
+	size_t first = 0;
+	size_t n = vec->_length;
+	switch(key) {
+		case VECTOR_KEY_I8: _VEC_LOWER_BOUND(int8_t)
+		case VECTOR_KEY_U8: _VEC_LOWER_BOUND(uint8_t)
+		case VECTOR_KEY_I16: _VEC_LOWER_BOUND(int16_t)
+		case VECTOR_KEY_U16: _VEC_LOWER_BOUND(uint16_t)
+		case VECTOR_KEY_I32: _VEC_LOWER_BOUND(int32_t)
+		case VECTOR_KEY_U32: _VEC_LOWER_BOUND(uint32_t)
+		case VECTOR_KEY_I64: _VEC_LOWER_BOUND(int64_t)
+		case VECTOR_KEY_U64: _VEC_LOWER_BOUND(uint64_t)
+		case VECTOR_KEY_F32: _VEC_LOWER_BOUND(float)
+		case VECTOR_KEY_F64: _VEC_LOWER_BOUND(double)
+		default: break;
+	}
+	return first;
+}
+
+size_t _vec_filter_into(vector_t** dest, vector_t* vec, vector_key_t key, void* lo, void* hi) {
+	// Error check
+	if (!dest || !(*dest) || (*dest) == vec) { return 0; }
+	vector_t* _dest = *dest;
+	_vec_scan_fn scan = _vec_scan_kernel(vec, key);
+	if (!scan || !lo || !hi || _dest->_element_size != vec->_element_size) { return 0; }
+
+	// Count first so the destination grows once & exactly
+	size_t n = scan(vec->_buffer, vec->_length, vec->_element_size, lo, hi, _VEC_SCAN_COUNT, NULL);
+	if (n == 0 || n > VECTOR_MAX_CAPACITY - _dest->_length) { return 0; }
+	if (_dest->_length + n > _dest->_capacity) {
+		vector_t* temp = _vec_resize(_dest, _dest->_length + n);
+		if (!temp) { return 0; }
+		(*dest) = temp;
+		_dest = temp;
+	}
+
+	// Copy the matches straight into the free space
+	scan(vec->_buffer, vec->_length, vec->_element_size, lo, hi, _VEC_SCAN_COPY, _vec_pos(_dest, _dest->_length));
+	_dest->_length += n;
+	return n;
+}
@@ -1,4 +1,7 @@
 #include <stdio.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <threads.h>
 #include "vector.h"
 #include "stack.h"
 #include "unordered_map.h"
@@ -8,6 +11,230 @@
 #include "deque.h"
 #include "free_list.h"
 #include "tree.h"
+#include "radix_heap.h"
+#include "timing_wheel.h"
+#include "multi_queue.h"
+#include "object_pool.h"
+#include "blocking_queue.h"
+
+static int failures = 0;
+
+// Print the outcome of a behaviour check & remember failures for the exit code
+static void check(int cond, const char* what) {
+	printf("%s: %s\n", (cond) ? "ok" : "FAILED", what);
+	if (!cond) { failures++; }
+}
+
+static size_t count_slabs(_tree_slab_t* slab) {
+	size_t n = 0;
+	for(; slab; slab = slab->_next) { n++; }
+	return n;
+}
+
+// Count visited elements, stopping once the context limit is reached
+static int count_visit(void* data, const char* key, void* ctx) {
+	size_t* seen = ctx;
+	(void)key; (void)data;
+	return ++seen[0] == seen[1];
+}
+
+// Sum visited values from several threads at once
+static int sum_visit(void* data, const char* key, void* ctx) {
+	(void)key;
+	atomic_fetch_add((atomic_long*)ctx, *(int*)data);
+	return 0;
+}
+
+// Order string keys alphabetically
+static int compare_names(const void* a, const void* b) {
+	return strcmp((const char*)a, (const char*)b);
+}
+
+#define STRESS_THREADS 4
+#define STRESS_ITEMS 20000
+
+// Push a disjoint range of values into a shared multi-queue, then pop as many as were pushed
+typedef struct {
+	multi_queue_t* mq;
+	int first;
+	long popped_sum;
+	size_t popped;
+} multi_queue_worker_t;
+
+static int multi_queue_worker(void* arg) {
+	multi_queue_worker_t* w = arg;
+	for (int i = 0; i < STRESS_ITEMS; ++i) {
+		int value = w->first + i;
+		multi_queue_push(w->mq, value, &value);
+	}
+	int data;
+	while (w->popped < STRESS_ITEMS && multi_queue_pop(w->mq, NULL, &data)) {
+		w->popped_sum += data;
+		w->popped++;
+	}
+	return 0;
+}
+
+// Allocate, hand off & free pool objects, flagging any object that is handed out twice
+#define POOL_LIVE_MARK(o) ((uintptr_t)(o) ^ (uintptr_t)0x5A5A5A5A)
+#define POOL_HANDOFF_SLOTS 16
+
+typedef struct {
+	uintptr_t mark;
+	int payload[6];
+} pooled_t;
+
+typedef struct {
+	object_pool_t* pool;
+	_Atomic(pooled_t*)* handoff;
+	atomic_int* errors;
+	unsigned int seed;
+} object_pool_worker_t;
+
+static int object_pool_worker(void* arg) {
+	object_pool_worker_t* w = arg;
+	pooled_t* held[64] = { 0 };
+	for (int i = 0; i < STRESS_ITEMS; ++i) {
+		w->seed = w->seed * 1103515245u + 12345u;
+		size_t slot = (w->seed >> 8) % 64;
+		if (held[slot]) {
+			pooled_t* o = held[slot];
+			if (o->mark != POOL_LIVE_MARK(o)) { atomic_fetch_add(w->errors, 1); }
+			held[slot] = NULL;
+			// Pass some objects to other threads so they are freed remotely
+			if ((w->seed >> 20) % 4 == 0) {
+				o = atomic_exchange(&w->handoff[(w->seed >> 12) % POOL_HANDOFF_SLOTS], o);
+				if (!o) { continue; }
+				if (o->mark != POOL_LIVE_MARK(o)) { atomic_fetch_add(w->errors, 1); }
+			}
+			o->mark = 0;
+			object_pool_free(w->pool, o);
+		}
+		else {
+			pooled_t* o = object_pool_alloc(w->pool);
+			if (!o || o->mark == POOL_LIVE_MARK(o)) { atomic_fetch_add(w->errors, 1); continue; }
+			o->mark = POOL_LIVE_MARK(o);
+			held[slot] = o;
+		}
+	}
+	for (size_t i = 0; i < 64; ++i) {
+		if (held[i]) {
+			held[i]->mark = 0;
+			object_pool_free(w->pool, held[i]);
+		}
+	}
+	return 0;
+}
+
+// Producers push increasing values tagged with their id, consumers check each producer's values arrive in order
+typedef struct {
+	blocking_queue_t* q;
+	int id;
+	long sum;
+	size_t count;
+	int in_order;
+} blocking_queue_worker_t;
+
+static int blocking_queue_producer(void* arg) {
+	blocking_queue_worker_t* w = arg;
+	int batch[8];
+	for (int i = 0; i < STRESS_ITEMS; i += 8) {
+		for (int j = 0; j < 8; ++j) { batch[j] = (w->id << 24) | (i + j); }
+		// Alternate batched & single pushes, finishing partial batches
+		if (w->id % 2 == 0) {
+			size_t done = 0;
+			while (done < 8) { done += blocking_queue_push_batch(w->q, batch + done, 8 - done); }
+		}
+		else {
+			for (int j = 0; j < 8; ++j) { blocking_queue_push(w->q, &batch[j]); }
+		}
+	}
+	return 0;
+}
+
+static int blocking_queue_consumer(void* arg) {
+	blocking_queue_worker_t* w = arg;
+	int last[STRESS_THREADS];
+	for (int i = 0; i < STRESS_THREADS; ++i) { last[i] = -1; }
+	int batch[8];
+	for (;;) {
+		size_t n = (w->id % 2 == 0) ? blocking_queue_pop_batch(w->q, batch, 8) : (size_t)blocking_queue_pop(w->q, batch);
+		if (n == 0) { break; }
+		for (size_t i = 0; i < n; ++i) {
+			int producer = batch[i] >> 24;
+			int value = batch[i] & 0xFFFFFF;
+			if (value <= last[producer]) { w->in_order = 0; }
+			last[producer] = value;
+			w->sum += value;
+			w->count++;
+		}
+	}
+	return 0;
+}
+
+// Write a small integer (or NaN for negative values of float keys) as the given key type
+static void write_key(uint8_t* dest, vector_key_t key, int value) {
+	switch (key) {
+	case VECTOR_KEY_I8: *(int8_t*)dest = (int8_t)value; break;
+	case VECTOR_KEY_U8: *(uint8_t*)dest = (uint8_t)value; break;
+	case VECTOR_KEY_I16: *(int16_t*)dest = (int16_t)value; break;
+	case VECTOR_KEY_U16: *(uint16_t*)dest = (uint16_t)value; break;
+	case VECTOR_KEY_I32: *(int32_t*)dest = value; break;
+	case VECTOR_KEY_U32: *(uint32_t*)dest = (uint32_t)value; break;
+	case VECTOR_KEY_I64: *(int64_t*)dest = value; break;
+	case VECTOR_KEY_U64: *(uint64_t*)dest = (uint64_t)value; break;
+	case VECTOR_KEY_F32: *(float*)dest = (value < 0) ? NAN : (float)value; break;
+	case VECTOR_KEY_F64: *(double*)dest = (value < 0) ? NAN : (double)value; break;
+	default: break;
+	}
+}
+
+// Bare key vectors take the SIMD kernels while padded elements take the scalar ones, so both must agree
+static int scan_matches_scalar(vector_key_t key, size_t width) {
+	vector_t* bare = _vec_factory(width, 8);
+	vector_t* padded = _vec_factory(width + 8, 8);
+	uint8_t element[16];
+	unsigned int seed = 99u + (unsigned int)key;
+	for (int i = 0; i < 1003; ++i) {
+		seed = seed * 1103515245u + 12345u;
+		int value = (i % 13 == 0) ? -1 : (int)((seed >> 8) % 50);
+		memset(element, 0xAB, sizeof element);
+		write_key(element, key, value);
+		vector_push_back(bare, element);
+		vector_push_back(padded, element);
+	}
+	uint8_t lo[8], hi[8], needle[8];
+	write_key(lo, key, 10);
+	write_key(hi, key, 20);
+	write_key(needle, key, 17);
+	int same = vector_find(bare, key, needle) == vector_find(padded, key, needle);
+	same &= vector_find(bare, key, needle) != SIZE_MAX;
+	same &= vector_count(bare, key, lo, hi) == vector_count(padded, key, lo, hi);
+	vector_t* bare_hits = _vec_factory(width, 8);
+	vector_t* padded_hits = _vec_factory(width + 8, 8);
+	size_t n = vector_filter_into(bare_hits, bare, key, lo, hi);
+	same &= n > 0 && n == vector_filter_into(padded_hits, padded, key, lo, hi);
+	for (size_t i = 0; same && i < n; ++i) {
+		same &= memcmp(vector_get(bare_hits, i), vector_get(padded_hits, i), width) == 0;
+	}
+	vector_destroy(bare_hits);
+	vector_destroy(padded_hits);
+	vector_destroy(bare);
+	vector_destroy(padded);
+	return same;
+}
+
+// Fill a vector with 0..n-1
+static vector_t* iota_vector(int n) {
+	vector_t* v = vector_create(int);
+	for (int i = 0; i < n; ++i) { vector_push_back(v, &i); }
+	return v;
+}
+
+// Erase predicate for multiples of the context value
+static bool is_multiple(const void* data, void* ctx) {
+	return *(const int*)data % *(int*)ctx == 0;
+}
 
 int main() {
 	printf("__Vector__\n");
@@ -38,7 +265,7 @@ int main() {
 		keys[i] = i + 1000;
 		unordered_map_insert(mymap, keys[i], &i);
 	}
-	for (unordered_map_it_t* it = unordered_map_it(mymap); it; unordered_map_it_next(it)) {
+	for (unordered_map_it_t* it = unordered_map_it(mymap); it; it = unordered_map_it_next(it)) {
 		int j = *(int*)(it->data);
 		printf("%d: %d\n", (int)it->key, j);
 	}
@@ -83,5 +310,753 @@ int main() {
 	printf("%s\n", tree);
 	free(tree);
 	tree_destroy(mytree);
-	return 0;
+
+	printf("__Tree Slabs__\n");
+	tree_t* churn = tree_create(int);
+	char path[64];
+	for (int i = 0; i < 64; ++i) {
+		sprintf(path, "node%d/leaf%d", i, i);
+		tree_insert(churn, path, "/", &i);
+	}
+	size_t key_slabs = count_slabs(churn->_keys);
+	size_t node_slabs = count_slabs(churn->_nodes._slabs);
+	for (int round = 0; round < 2000; ++round) {
+		int i = round % 64;
+		sprintf(path, "node%d", i);
+		tree_delete(churn, path, "/");
+		sprintf(path, "node%d/leaf%d", i, round);
+		tree_insert(churn, path, "/", &round);
+	}
+	check(tree_length(churn) == 128, "churn keeps the element count");
+	check(count_slabs(churn->_keys) == key_slabs, "deleted keys are recycled");
+	check(count_slabs(churn->_nodes._slabs) == node_slabs, "deleted nodes are recycled");
+	sprintf(path, "node%d/leaf%d", 1999 % 64, 1999);
+	int* recycled_leaf = tree_find(churn, path, "/");
+	check(recycled_leaf && *recycled_leaf == 1999, "recycled keys still match");
+	tree_destroy(churn);
+
+	printf("__Radix Tree__\n");
+	tree_t* radix = tree_create_radix(int);
+	int values[4] = { 1, 2, 3, 4 };
+	tree_insert(radix, "usr/local/bin", "/", &values[0]);
+	check(radix->_root->_first_child->_num_children == 0, "single path is one compressed edge");
+	tree_insert(radix, "usr/local/lib", "/", &values[1]);
+	tree_insert(radix, "usr/share", "/", &values[2]);
+	check(*(int*)tree_find(radix, "usr/local/bin", "/") == 1, "edge split keeps the old element");
+	check(*(int*)tree_find(radix, "usr/local/lib", "/") == 2, "find below a split edge");
+	check(tree_find(radix, "usr/local", "/") == NULL, "branch nodes hold no element");
+	check(tree_depth(radix, "usr/local/lib", "/") == 3, "depth counts compressed segments");
+	size_t under_local = 0;
+	for (tree_it_t* it = tree_find_prefix(radix, "usr/local", "/"); it; it = tree_it_next(it)) { under_local++; }
+	check(under_local == 2, "prefix iteration");
+	tree_delete(radix, "usr/local/lib", "/");
+	check(*(int*)tree_find(radix, "usr/local/bin", "/") == 1, "delete merges the edge back");
+	check(tree_insert(radix, "usr/bad\x1fkey", "/", &values[3]) == NULL, "key with the edge seperator is rejected");
+	check(tree_find(radix, "usr/local\x1f" "bin", "/") == NULL, "lookup with the edge seperator fails");
+	check(tree_length(radix) == 2, "rejected key left the tree alone");
+	tree_destroy(radix);
+
+	printf("__Tree Printing__\n");
+	tree_t* printed = tree_create(int);
+	tree_insert(printed, "a,b", ",", &values[0]);
+	tree_insert(printed, "a,\"q\"", ",", &values[1]);
+	tree_insert(printed, "c", ",", &values[2]);
+	char* text;
+	tree_print_format(printed, text, TREE_PRINT_TEXT);
+	check(text && strcmp(text, "(root)\n|-a\n  |-b\n  |-\"q\"\n|-c") == 0, "text format");
+	char* json;
+	tree_print_format(printed, json, TREE_PRINT_JSON);
+	check(json && strcmp(json, "{\"a\": {\"b\": {}, \"\\\"q\\\"\": {}}, \"c\": {}}") == 0, "json format escapes keys");
+	FILE* sink = tmpfile();
+	if (sink) {
+		check(tree_fprint(printed, sink, TREE_PRINT_TEXT) == strlen(text), "file output matches string output");
+		fclose(sink);
+	}
+	free(text);
+	free(json);
+	tree_destroy(printed);
+
+	printf("__Tree Walks__\n");
+	tree_t* walked = tree_create(int);
+	long expected = 0;
+	for (int i = 0; i < 16; ++i) {
+		for (int j = 0; j < 16; ++j) {
+			char key[32];
+			int value = i * 16 + j;
+			sprintf(key, "n%d/m%d", i, j);
+			tree_insert(walked, key, "/", &value);
+			expected += value;
+		}
+	}
+	size_t seen[2] = { 0, SIZE_MAX };
+	check(tree_for_each(walked, NULL, "/", count_visit, seen) == tree_length(walked), "visitor reaches every element");
+	size_t stop[2] = { 0, 5 };
+	check(tree_for_each(walked, NULL, "/", count_visit, stop) == 5, "visitor stops early");
+	atomic_long sum = 0;
+	check(tree_for_each_parallel(walked, NULL, "/", sum_visit, &sum, 4) == tree_length(walked), "parallel walk reaches every element");
+	check(atomic_load(&sum) == expected, "parallel walk sees every value once");
+	check(tree_depth_parallel(walked, NULL, "/", 4) == 2, "parallel depth of whole tree");
+	check(tree_depth_parallel(walked, "n3", "/", 4) == 1, "parallel depth of subtree");
+	check(tree_depth_parallel(walked, "missing", "/", 4) == -1, "parallel depth of missing path");
+	size_t before = tree_length(walked);
+	tree_delete_parallel(walked, "n7", "/", 4);
+	check(tree_length(walked) == before - 17, "parallel delete removes the subtree");
+	check(tree_find(walked, "n7/m0", "/") == NULL && tree_find(walked, "n8/m0", "/") != NULL, "parallel delete leaves siblings");
+	tree_destroy(walked);
+
+	printf("__Tree Depth__\n");
+	tree_t* deep = tree_create(int);
+	tree_insert(deep, "a", "/", &values[0]);
+	tree_insert(deep, "a/b", "/", &values[1]);
+	tree_insert(deep, "a/b/c", "/", &values[2]);
+	tree_insert(deep, "a/b/c/d/e", "/", &values[3]);
+	tree_insert(deep, "x", "/", &values[0]);
+	check(tree_max_depth(deep) == 5, "max depth tracks the deepest insert");
+	check(tree_depth(deep, "a/b/c", "/") == 3, "depth of a node");
+	size_t limited[2] = { 0, SIZE_MAX };
+	check(tree_walk(deep, "a", "/", 1, count_visit, limited) == 2, "depth-limited walk stops one level down");
+	size_t whole[2] = { 0, SIZE_MAX };
+	check(tree_walk(deep, "a", "/", 0, count_visit, whole) == 1, "zero depth walk visits only the path");
+	size_t shallow = 0;
+	for (tree_it_t* it = tree_it_depth(deep, NULL, "/", 1); it; it = tree_it_next(it)) { shallow++; }
+	check(shallow == 2, "depth-limited iterator skips deeper nodes");
+	tree_delete(deep, "a/b/c/d", "/");
+	check(tree_max_depth(deep) == 3, "max depth shrinks after delete");
+	tree_delete(deep, "a", "/");
+	check(tree_max_depth(deep) == 1, "max depth after removing a branch");
+	tree_destroy(deep);
+
+	printf("__Indexed Priority Queue__\n");
+	priority_queue_t* indexed = priority_queue_create_indexed(int);
+	priority_queue_handle_t handles[64];
+	for (int i = 0; i < 64; ++i) {
+		handles[i] = priority_queue_push_handle(indexed, i, &i);
+	}
+	check(priority_queue_size(indexed) == 64 && *priority_queue_top_value(indexed) == 63, "handle pushes keep heap order");
+	priority_queue_update(indexed, handles[5], 100);
+	check(priority_queue_top_handle(indexed) == handles[5] && *(int*)priority_queue_top_data(indexed) == 5, "update raises an element to the top");
+	priority_queue_update(indexed, handles[5], -1);
+	check(*priority_queue_get_value(indexed, handles[5]) == -1 && *priority_queue_top_value(indexed) == 63, "update lowers an element");
+	priority_queue_remove_handle(indexed, handles[10]);
+	check(!priority_queue_contains(indexed, handles[10]) && priority_queue_get(indexed, handles[10]) == NULL, "removed handle is gone");
+	int reused = 1000;
+	priority_queue_handle_t fresh = priority_queue_push_handle(indexed, 7, &reused);
+	check(priority_queue_contains(indexed, fresh) && !priority_queue_contains(indexed, handles[10]), "stale handle rejected after its slot is reused");
+	priority_queue_update(indexed, handles[10], 500);
+	priority_queue_remove_handle(indexed, handles[10]);
+	check(priority_queue_contains(indexed, fresh) && *priority_queue_get_value(indexed, fresh) == 7, "stale update and remove leave the new element alone");
+	priority_queue_pop(indexed);
+	check(!priority_queue_contains(indexed, handles[63]), "popped handle goes stale");
+	priority_queue_clear(indexed);
+	check(!priority_queue_contains(indexed, fresh) && !priority_queue_contains(indexed, handles[0]), "clear retires every handle");
+	check(!priority_queue_contains(indexed, PRIORITY_QUEUE_INVALID_HANDLE), "invalid handle is never live");
+	priority_queue_destroy(indexed);
+
+	printf("__Radix Heap__\n");
+	radix_heap_t* radix_heap = radix_heap_create(int);
+	unsigned int seed = 12345;
+	for (int i = 0; i < 1000; ++i) {
+		seed = seed * 1103515245u + 12345u;
+		int value = (int)(seed >> 8) % 100000;
+		radix_heap_push(radix_heap, value, &value);
+	}
+	int sorted = 1;
+	int previous = -1;
+	size_t popped = 0;
+	while (radix_heap_size(radix_heap) > 0) {
+		int top = *radix_heap_top_value(radix_heap);
+		if (top < previous || *(int*)radix_heap_top_data(radix_heap) != top) { sorted = 0; }
+		previous = top;
+		if (!radix_heap_pop(radix_heap)) { break; }
+		popped++;
+		// Monotone pushes interleaved with pops
+		if (popped % 10 == 0) {
+			int later = previous + (int)popped;
+			radix_heap_push(radix_heap, later, &later);
+		}
+	}
+	check(sorted && radix_heap_size(radix_heap) == 0, "radix heap pops in ascending order");
+	check(!radix_heap_pop(radix_heap), "pop on an empty radix heap fails");
+	int below = 5;
+	radix_heap_push(radix_heap, 10, &below);
+	radix_heap_push(radix_heap, 20, &below);
+	radix_heap_pop(radix_heap);
+	check(radix_heap_push(radix_heap, 5, &below) == NULL && radix_heap_size(radix_heap) == 1, "push below the last popped value is rejected");
+	radix_heap_clear(radix_heap);
+	check(radix_heap_push(radix_heap, 5, &below) != NULL && *radix_heap_top_value(radix_heap) == 5, "clear restarts the monotone bound");
+	radix_heap_destroy(radix_heap);
+
+	printf("__Priority Queue Keys__\n");
+	priority_queue_t* min64 = priority_queue_create_key(int, PRIORITY_QUEUE_KEY_I64, PRIORITY_QUEUE_FLAG_MIN);
+	int64_t big[] = { 5000000000LL, -7, 42, -5000000000LL };
+	for (int i = 0; i < 4; ++i) { priority_queue_push_key(min64, &big[i], &i); }
+	check(*(int64_t*)priority_queue_top_key(min64) == -5000000000LL, "int64 min queue keeps the lowest key on top");
+	priority_queue_pop(min64);
+	check(*(int64_t*)priority_queue_top_key(min64) == -7, "int64 min queue pops in ascending order");
+	priority_queue_destroy(min64);
+	priority_queue_t* max_u64 = priority_queue_create_key(int, PRIORITY_QUEUE_KEY_U64, 0);
+	uint64_t wide[] = { 1, UINT64_MAX, 1ULL << 40 };
+	for (int i = 0; i < 3; ++i) { priority_queue_push_key(max_u64, &wide[i], &i); }
+	check(*(uint64_t*)priority_queue_top_key(max_u64) == UINT64_MAX && *(int*)priority_queue_top_data(max_u64) == 1, "uint64 max queue compares unsigned");
+	priority_queue_destroy(max_u64);
+	priority_queue_t* min_f64 = priority_queue_create_key(int, PRIORITY_QUEUE_KEY_F64, PRIORITY_QUEUE_FLAG_MIN);
+	double reals[] = { 0.5, -2.25, 3.0 };
+	for (int i = 0; i < 3; ++i) { priority_queue_push_key(min_f64, &reals[i], &i); }
+	check(*(double*)priority_queue_top_key(min_f64) == -2.25, "double min queue");
+	priority_queue_destroy(min_f64);
+	priority_queue_t* names = priority_queue_create_custom(int, 8, compare_names, PRIORITY_QUEUE_FLAG_MIN);
+	const char name_keys[][8] = { "pear", "apple", "melon" };
+	for (int i = 0; i < 3; ++i) { priority_queue_push_key(names, name_keys[i], &i); }
+	check(strcmp((char*)priority_queue_top_key(names), "apple") == 0, "custom keys use the comparison function");
+	priority_queue_pop(names);
+	check(strcmp((char*)priority_queue_top_key(names), "melon") == 0, "custom keys pop in order");
+	priority_queue_destroy(names);
+	check(priority_queue_create_custom(int, 8, NULL, 0) == NULL, "custom keys need a comparison function");
+	priority_queue_t* printed64 = priority_queue_create_key(char, PRIORITY_QUEUE_KEY_I64, 0);
+	int64_t wide_keys[] = { INT64_MIN, INT64_MAX, -1 };
+	for (char i = 0; i < 3; ++i) { priority_queue_push_key(printed64, &wide_keys[(int)i], &i); }
+	char* printed_keys = _priority_queue_print(printed64);
+	check(printed_keys && strstr(printed_keys, "-9223372036854775808:") && strstr(printed_keys, "9223372036854775807:") && strstr(printed_keys, "]3"), "printing wide keys of small elements");
+	CC_FREE(printed_keys);
+	priority_queue_destroy(printed64);
+
+	printf("__Priority Queue Bulk__\n");
+	priority_queue_value_t bulk_values[100];
+	int bulk_data[100];
+	for (int i = 0; i < 100; ++i) {
+		bulk_values[i] = (i * 37) % 100;
+		bulk_data[i] = bulk_values[i];
+	}
+	priority_queue_t* built = priority_queue_from_arrays(int, bulk_values, bulk_data, 100);
+	check(built && priority_queue_size(built) == 100 && *priority_queue_top_value(built) == 99, "linear build from arrays");
+	priority_queue_t* batch = priority_queue_create(int);
+	check(priority_queue_push_n(batch, bulk_values, bulk_data, 50), "batch push");
+	check(priority_queue_push_n(batch, bulk_values + 50, bulk_data + 50, 50), "batch push onto a non-empty queue");
+	check(priority_queue_merge(batch, built) && priority_queue_size(batch) == 200 && priority_queue_size(built) == 100, "merge copies the other queue");
+	check(!priority_queue_merge(batch, batch) && priority_queue_size(batch) == 200, "merging a queue into itself is rejected");
+	priority_queue_t* other_order = priority_queue_create_key(int, PRIORITY_QUEUE_KEY_I32, PRIORITY_QUEUE_FLAG_MIN);
+	check(!priority_queue_merge(batch, other_order), "merging a queue with another order is rejected");
+	priority_queue_value_t drained[200];
+	int in_order = priority_queue_drain_sorted(batch, drained, NULL) == 200;
+	for (int i = 1; i < 200; ++i) {
+		if (drained[i] > drained[i - 1]) { in_order = 0; }
+	}
+	check(in_order && drained[0] == 99 && drained[1] == 99 && drained[2] == 98, "merged queue drains best first");
+	priority_queue_destroy(other_order);
+	priority_queue_destroy(batch);
+	priority_queue_destroy(built);
+
+	printf("__Bounded Priority Queue__\n");
+	priority_queue_t* top_k = priority_queue_create_bounded(int, 5);
+	for (int i = 0; i < 100; ++i) {
+		int value = (i * 37) % 100;
+		priority_queue_push(top_k, value, &value);
+	}
+	check(priority_queue_size(top_k) == 5 && *priority_queue_top_value(top_k) == 95, "bounded queue keeps the k best with the worst on top");
+	int rejected = 1;
+	check(priority_queue_push(top_k, 1, &rejected) == NULL && priority_queue_size(top_k) == 5, "push below the cutoff is rejected");
+	priority_queue_value_t best[5];
+	int best_data[5];
+	check(priority_queue_drain_sorted(top_k, best, best_data) == 5, "drain every kept element");
+	check(best[0] == 99 && best[4] == 95 && best_data[0] == 99 && priority_queue_size(top_k) == 0, "bounded drain is best first");
+	priority_queue_destroy(top_k);
+	priority_queue_t* lowest = priority_queue_create_bounded_key(int, PRIORITY_QUEUE_KEY_F64, PRIORITY_QUEUE_FLAG_MIN, 3);
+	for (int i = 0; i < 20; ++i) {
+		double key = 10.0 - i * 0.5;
+		priority_queue_push_key(lowest, &key, &i);
+	}
+	check(priority_queue_size(lowest) == 3 && *(double*)priority_queue_top_key(lowest) == 1.5, "bounded min queue keeps the lowest keys");
+	priority_queue_destroy(lowest);
+	check(priority_queue_create_bounded(int, 0) == NULL, "bound of zero is rejected");
+
+	printf("__Timing Wheel__\n");
+	timing_wheel_t* wheel = timing_wheel_create(int);
+	timing_wheel_handle_t timers[200];
+	for (int i = 0; i < 200; ++i) {
+		uint64_t deadline = ((uint64_t)(i * 37) % 200) * 1000 + 1;
+		int id = (int)deadline;
+		timers[i] = timing_wheel_schedule(wheel, deadline, &id);
+	}
+	check(timing_wheel_size(wheel) == 200 && timers[199] != TIMING_WHEEL_INVALID_HANDLE, "schedule grows past the default capacity");
+	check(timing_wheel_cancel(wheel, timers[0]) && !timing_wheel_cancel(wheel, timers[0]), "cancel succeeds once");
+	check(timing_wheel_reschedule(wheel, timers[1], 5), "reschedule a live timer");
+	int fired[200];
+	size_t n = timing_wheel_advance(wheel, 5, fired, 200);
+	check(n == 1 && fired[0] == 37001, "rescheduled timer fires at its new deadline");
+	check(timing_wheel_get(wheel, timers[1]) == NULL && !timing_wheel_reschedule(wheel, timers[1], 10), "expired handle goes stale");
+	int expected_order = 1;
+	size_t total = 0;
+	for (uint64_t now = 50000; now <= 200000; now += 50000) {
+		n = timing_wheel_advance(wheel, now, fired + total, 200 - total);
+		total += n;
+	}
+	for (size_t i = 1; i < total; ++i) {
+		if (fired[i] <= fired[i - 1]) { expected_order = 0; }
+	}
+	check(total == 198 && expected_order && timing_wheel_size(wheel) == 0, "timers fire once each in deadline order");
+	int recycled = 7;
+	timing_wheel_handle_t replacement = timing_wheel_schedule(wheel, timing_wheel_now(wheel) + 10, &recycled);
+	check(timing_wheel_get(wheel, replacement) && *(int*)timing_wheel_get(wheel, replacement) == 7, "new timer reuses a record");
+	int stale = 1;
+	for (int i = 0; i < 200; ++i) {
+		if (timing_wheel_get(wheel, timers[i]) || timing_wheel_cancel(wheel, timers[i])) { stale = 0; }
+	}
+	check(stale && timing_wheel_size(wheel) == 1, "old handles stay stale after their records are reused");
+	int far = 9;
+	timing_wheel_schedule(wheel, timing_wheel_now(wheel) + (1ULL << 40), &far);
+	n = timing_wheel_advance(wheel, timing_wheel_now(wheel) + (1ULL << 39), fired, 200);
+	check(n == 1 && fired[0] == 7 && timing_wheel_size(wheel) == 1, "far deadline waits while nearer timers fire");
+	check(timing_wheel_advance(wheel, timing_wheel_now(wheel) + (1ULL << 39), fired, 200) == 1 && fired[0] == 9, "deadline beyond the top level fires");
+	timing_wheel_schedule(wheel, timing_wheel_now(wheel) + 3, &far);
+	timing_wheel_clear(wheel);
+	check(timing_wheel_size(wheel) == 0 && timing_wheel_advance(wheel, timing_wheel_now(wheel) + 10, fired, 200) == 0, "clear cancels everything");
+	timing_wheel_destroy(wheel);
+
+	printf("__Multi Queue__\n");
+	multi_queue_t* mq = multi_queue_create(int, STRESS_THREADS);
+	check(((uintptr_t)&mq->_shards[0] % MULTI_QUEUE_CACHE_LINE) == 0 && ((uintptr_t)&mq->_shards[1] % MULTI_QUEUE_CACHE_LINE) == 0, "shards start on cache line boundaries");
+	int empty_data;
+	check(!multi_queue_pop(mq, NULL, &empty_data), "pop on an empty multi-queue fails");
+	multi_queue_worker_t mq_workers[STRESS_THREADS];
+	thrd_t mq_threads[STRESS_THREADS];
+	for (int i = 0; i < STRESS_THREADS; ++i) {
+		mq_workers[i] = (multi_queue_worker_t){ mq, i * STRESS_ITEMS, 0, 0 };
+		thrd_create(&mq_threads[i], multi_queue_worker, &mq_workers[i]);
+	}
+	long mq_sum = 0;
+	size_t mq_popped = 0;
+	for (int i = 0; i < STRESS_THREADS; ++i) {
+		thrd_join(mq_threads[i], NULL);
+		mq_sum += mq_workers[i].popped_sum;
+		mq_popped += mq_workers[i].popped;
+	}
+	priority_queue_value_t mq_key;
+	int mq_data;
+	while (multi_queue_pop(mq, &mq_key, &mq_data)) {
+		mq_sum += mq_data;
+		mq_popped++;
+	}
+	long mq_total = (long)STRESS_THREADS * STRESS_ITEMS;
+	check(mq_popped == (size_t)mq_total && mq_sum == mq_total * (mq_total - 1) / 2, "concurrent pushes and pops lose and duplicate nothing");
+	check(multi_queue_size(mq) == 0, "multi-queue is empty after the stress run");
+	for (int i = 0; i < 100; ++i) { multi_queue_push(mq, i, &i); }
+	multi_queue_clear(mq);
+	check(multi_queue_size(mq) == 0 && !multi_queue_pop(mq, NULL, NULL), "clear empties every shard");
+	multi_queue_destroy(mq);
+
+	printf("__Slot Map__\n");
+	free_list_t* slots = free_list_create_slot_map(int);
+	free_list_handle_t slot_handles[100];
+	for (int i = 0; i < 100; ++i) {
+		slot_handles[i] = free_list_insert_handle(slots, &i);
+	}
+	check(free_list_size(slots) == 100 && *(int*)free_list_get_handle(slots, slot_handles[42]) == 42, "handles find their elements");
+	check(free_list_remove_handle(slots, slot_handles[42]) && !free_list_remove_handle(slots, slot_handles[42]), "remove succeeds once");
+	check(!free_list_contains(slots, slot_handles[42]) && free_list_get_handle(slots, slot_handles[42]) == NULL, "removed handle goes stale");
+	check(*(int*)free_list_get_handle(slots, slot_handles[99]) == 99, "moved element keeps its handle");
+	int packed = 1;
+	for (size_t i = 0; i < free_list_size(slots); ++i) {
+		int value = ((int*)free_list_data(slots))[i];
+		if (free_list_handle_at(slots, i) != slot_handles[value]) { packed = 0; }
+	}
+	check(packed && free_list_size(slots) == 99, "packed array maps back to live handles");
+	int replacement_value = 1000;
+	free_list_handle_t slot_reused = free_list_insert_handle(slots, &replacement_value);
+	check((slot_reused & UINT32_MAX) == (slot_handles[42] & UINT32_MAX) && slot_reused != slot_handles[42], "freed slot is reused under a new generation");
+	check(!free_list_contains(slots, slot_handles[42]) && *(int*)free_list_get_handle(slots, slot_reused) == 1000, "stale handle does not see the new element");
+	free_list_clear(slots);
+	int all_stale = !free_list_contains(slots, slot_reused);
+	for (int i = 0; i < 100; ++i) {
+		if (free_list_contains(slots, slot_handles[i])) { all_stale = 0; }
+	}
+	check(all_stale && free_list_size(slots) == 0, "clear retires every handle");
+	check(!free_list_contains(slots, FREE_LIST_INVALID_HANDLE), "invalid handle is never live");
+	free_list_destroy(slots);
+
+	printf("__Paged Free List__\n");
+	free_list_t* paged = free_list_create_paged(int);
+	int* first_ptr = NULL;
+	size_t first_index;
+	for (int i = 0; i < (int)FREE_LIST_PAGE_SIZE * 3 + 10; ++i) {
+		size_t index;
+		int* p = free_list_insert(paged, &index, &i);
+		if (i == 0) {
+			first_ptr = p;
+			first_index = index;
+		}
+	}
+	check(free_list_size(paged) == FREE_LIST_PAGE_SIZE * 3 + 10, "paged list grows page by page");
+	check(free_list_get(paged, first_index) == first_ptr && *first_ptr == 0, "element pointers survive growth");
+	free_list_remove(paged, 5);
+	free_list_remove(paged, FREE_LIST_PAGE_SIZE + 7);
+	check(free_list_get(paged, 5) == NULL && free_list_size(paged) == FREE_LIST_PAGE_SIZE * 3 + 8, "removed slots read as free");
+	size_t hole_a, hole_b;
+	int hole_value = -1;
+	free_list_insert(paged, &hole_a, &hole_value);
+	free_list_insert(paged, &hole_b, &hole_value);
+	check(hole_a == 5 && hole_b == FREE_LIST_PAGE_SIZE + 7, "inserts fill the lowest holes first");
+	size_t paged_seen = 0;
+	for (free_list_it_t* it = free_list_it(paged); it; it = free_list_it_next(it)) { paged_seen++; }
+	check(paged_seen == free_list_size(paged), "iterator visits every live element");
+	free_list_destroy(paged);
+
+	printf("__Object Pool__\n");
+	object_pool_t* pool = object_pool_create(pooled_t);
+	pooled_t* single = object_pool_alloc(pool);
+	check(single && ((uintptr_t)single % _Alignof(max_align_t)) == 0, "objects are suitably aligned");
+	object_pool_free(pool, single);
+	check(object_pool_alloc(pool) == single, "freed object is served again from the thread cache");
+	object_pool_free(pool, single);
+	_Atomic(pooled_t*) handoff[POOL_HANDOFF_SLOTS];
+	for (int i = 0; i < POOL_HANDOFF_SLOTS; ++i) { atomic_init(&handoff[i], NULL); }
+	atomic_int pool_errors = 0;
+	object_pool_worker_t pool_workers[STRESS_THREADS];
+	thrd_t pool_threads[STRESS_THREADS];
+	for (int i = 0; i < STRESS_THREADS; ++i) {
+		pool_workers[i] = (object_pool_worker_t){ pool, handoff, &pool_errors, 777u * (unsigned int)(i + 1) };
+		thrd_create(&pool_threads[i], object_pool_worker, &pool_workers[i]);
+	}
+	for (int i = 0; i < STRESS_THREADS; ++i) { thrd_join(pool_threads[i], NULL); }
+	for (int i = 0; i < POOL_HANDOFF_SLOTS; ++i) {
+		pooled_t* o = atomic_load(&handoff[i]);
+		if (o) {
+			o->mark = 0;
+			object_pool_free(pool, o);
+		}
+	}
+	object_pool_flush(pool);
+	object_pool_stats_t pool_stats;
+	object_pool_stats(pool, &pool_stats);
+	check(atomic_load(&pool_errors) == 0, "no object is handed to two owners at once");
+	check(pool_stats.allocs == pool_stats.frees && pool_stats.live == 0, "every allocation is returned");
+	check(pool_stats.remote_frees > 0 && pool_stats.hits > 0, "remote frees and cache hits are counted");
+	object_pool_destroy(pool);
+
+	printf("__Free List Compaction__\n");
+	free_list_t* sparse = free_list_create(int);
+	for (int i = 0; i < 100; ++i) {
+		size_t index;
+		free_list_insert(sparse, &index, &i);
+	}
+	for (size_t i = 0; i < 100; ++i) {
+		if (i % 10 != 0) { free_list_remove(sparse, i); }
+	}
+	size_t sparse_bytes = free_list_bytes(sparse);
+	size_t* remap;
+	check(free_list_compact(sparse, &remap) && remap, "compact a sparse list");
+	int compact_ok = free_list_size(sparse) == 10;
+	for (size_t i = 0; i < 100; ++i) {
+		size_t expected_index = (i % 10 == 0) ? i / 10 : SIZE_MAX;
+		if (remap[i] != expected_index) { compact_ok = 0; }
+	}
+	for (size_t i = 0; i < 10; ++i) {
+		int* value = free_list_get(sparse, i);
+		if (!value || *value != (int)(i * 10)) { compact_ok = 0; }
+	}
+	check(compact_ok, "live elements keep their order and the remap table matches");
+	check(free_list_bytes(sparse) < sparse_bytes, "compaction gives back capacity");
+	size_t after_index;
+	int after_value = -1;
+	free_list_insert(sparse, &after_index, &after_value);
+	check(after_index == 10, "inserts continue after the packed prefix");
+	CC_FREE(remap);
+	free_list_destroy(sparse);
+	free_list_t* sparse_pages = free_list_create_paged(int);
+	for (int i = 0; i < (int)FREE_LIST_PAGE_SIZE * 4; ++i) {
+		size_t index;
+		free_list_insert(sparse_pages, &index, &i);
+	}
+	for (size_t i = 0; i < FREE_LIST_PAGE_SIZE * 4; ++i) {
+		if (i % 100 != 0) { free_list_remove(sparse_pages, i); }
+	}
+	size_t paged_bytes = free_list_bytes(sparse_pages);
+	check(free_list_compact(sparse_pages, NULL) && free_list_bytes(sparse_pages) < paged_bytes, "paged compaction frees trailing pages");
+	int* last_packed = free_list_get(sparse_pages, free_list_size(sparse_pages) - 1);
+	check(last_packed && *last_packed == (int)((FREE_LIST_PAGE_SIZE * 4 - 1) / 100 * 100), "paged elements are packed in order");
+	free_list_destroy(sparse_pages);
+
+	printf("__Chunked Deque__\n");
+	deque_t* chunked = deque_create_chunked(int);
+	int* anchor = NULL;
+	for (int i = 0; i < 5000; ++i) {
+		deque_push_back(chunked, &i);
+		if (i == 0) { anchor = deque_front(chunked); }
+		int front = -1 - i;
+		deque_push_front(chunked, &front);
+	}
+	check(deque_size(chunked) == 10000 && *anchor == 0, "pointers survive growth at both ends");
+	int chunk_order = 1;
+	for (size_t i = 0; i < deque_size(chunked); ++i) {
+		if (*(int*)deque_at(chunked, i) != (int)i - 5000) { chunk_order = 0; }
+	}
+	check(chunk_order, "elements keep their order across chunks");
+	for (int i = 0; i < 4000; ++i) {
+		deque_pop_front(chunked);
+		deque_pop_back(chunked);
+	}
+	check(deque_size(chunked) == 2000 && *(int*)deque_front(chunked) == -1000 && *(int*)deque_back(chunked) == 999, "pops from both ends");
+	check(*anchor == 0, "popping other chunks leaves live elements in place");
+	deque_clear(chunked);
+	check(deque_size(chunked) == 0 && deque_front(chunked) == NULL, "clear empties the chunked deque");
+	deque_destroy(chunked);
+
+	printf("__Spans__\n");
+	queue_t* ring = queue_create(int);
+	int batch_items[12];
+	for (int i = 0; i < 12; ++i) { batch_items[i] = i; }
+	check(queue_push_n(ring, batch_items, 12) && queue_size(ring) == 12, "batch push onto a queue");
+	queue_pop_n(ring, 5);
+	check(*(int*)queue_head(ring) == 5 && *(int*)queue_at(ring, 6) == 11 && queue_at(ring, 7) == NULL, "batch pop and random access");
+	queue_push_n(ring, batch_items, 6);
+	queue_span_t ring_spans[2];
+	size_t ring_count = queue_spans(ring, ring_spans);
+	size_t ring_total = 0;
+	int ring_order = 1;
+	int ring_expected = 5;
+	for (size_t i = 0; i < ring_count; ++i) {
+		for (size_t j = 0; j < ring_spans[i].count; ++j) {
+			if (((int*)ring_spans[i].data)[j] != ring_expected) { ring_order = 0; }
+			ring_expected = (ring_expected == 11) ? 0 : ring_expected + 1;
+		}
+		ring_total += ring_spans[i].count;
+	}
+	check(ring_count >= 1 && ring_count <= 2 && ring_total == queue_size(ring) && ring_order, "queue spans cover the elements in order");
+	queue_destroy(ring);
+	deque_t* spanned = deque_create_chunked(int);
+	for (int i = 0; i < 3000; ++i) { deque_push_back(spanned, &i); }
+	deque_pop_front_n(spanned, 100);
+	deque_pop_back_n(spanned, 100);
+	deque_span_t deque_spans_out[16];
+	size_t deque_count = deque_spans(spanned, deque_spans_out, 16);
+	size_t deque_total = 0;
+	int deque_order = 1;
+	int deque_expected = 100;
+	for (size_t i = 0; i < deque_count; ++i) {
+		for (size_t j = 0; j < deque_spans_out[i].count; ++j) {
+			if (((int*)deque_spans_out[i].data)[j] != deque_expected++) { deque_order = 0; }
+		}
+		deque_total += deque_spans_out[i].count;
+	}
+	check(deque_count > 1 && deque_total == 2800 && deque_order, "chunked deque spans cover the elements in order");
+	check(deque_spans(spanned, deque_spans_out, 1) == 1 && deque_at(spanned, 2800) == NULL, "span count is capped and access is bounds checked");
+	deque_destroy(spanned);
+
+	printf("__Segmented Stack__\n");
+	stack_t* segmented = stack_create_segmented(int);
+	int* bottom = NULL;
+	for (int i = 0; i < 3000; ++i) {
+		stack_push(segmented, &i);
+		if (i == 0) { bottom = stack_head(segmented); }
+	}
+	check(stack_size(segmented) == 3000 && *(int*)stack_head(segmented) == 2999 && *bottom == 0, "segments grow without moving elements");
+	size_t mark = stack_mark(segmented);
+	for (int i = 0; i < 2000; ++i) {
+		int scratch = -i;
+		stack_push(segmented, &scratch);
+	}
+	stack_rewind(segmented, mark);
+	check(stack_size(segmented) == 3000 && *(int*)stack_head(segmented) == 2999, "rewind drops everything pushed after the mark");
+	int stack_order = 1;
+	for (int i = 2999; i >= 1000; --i) {
+		if (*(int*)stack_head(segmented) != i) { stack_order = 0; }
+		stack_pop(segmented);
+	}
+	check(stack_order && stack_size(segmented) == 1000 && *(int*)stack_head(segmented) == 999, "pops cross segment boundaries in order");
+	stack_clear(segmented);
+	check(stack_size(segmented) == 0 && stack_head(segmented) == NULL, "clear empties the segmented stack");
+	int again = 42;
+	stack_push(segmented, &again);
+	check(*(int*)stack_head(segmented) == 42, "segments are reused after clear");
+	stack_destroy(segmented);
+
+	printf("__Blocking Queue__\n");
+	blocking_queue_t* bq = blocking_queue_create(int, 16);
+	int bq_value = 0;
+	check(!blocking_queue_try_pop(bq, &bq_value) && !blocking_queue_pop_timeout(bq, &bq_value, 10), "pops on an empty queue time out");
+	for (int i = 0; i < 16; ++i) { blocking_queue_push(bq, &i); }
+	check(!blocking_queue_try_push(bq, &bq_value) && !blocking_queue_push_timeout(bq, &bq_value, 10), "pushes on a full queue time out");
+	int bq_batch[16];
+	check(blocking_queue_pop_batch_timeout(bq, bq_batch, 16, 0) == 16 && bq_batch[0] == 0 && bq_batch[15] == 15, "batch pop drains in order");
+	blocking_queue_worker_t producers[STRESS_THREADS];
+	blocking_queue_worker_t consumers[STRESS_THREADS];
+	thrd_t producer_threads[STRESS_THREADS];
+	thrd_t consumer_threads[STRESS_THREADS];
+	for (int i = 0; i < STRESS_THREADS; ++i) {
+		producers[i] = (blocking_queue_worker_t){ bq, i, 0, 0, 1 };
+		consumers[i] = (blocking_queue_worker_t){ bq, i, 0, 0, 1 };
+		thrd_create(&consumer_threads[i], blocking_queue_consumer, &consumers[i]);
+		thrd_create(&producer_threads[i], blocking_queue_producer, &producers[i]);
+	}
+	for (int i = 0; i < STRESS_THREADS; ++i) { thrd_join(producer_threads[i], NULL); }
+	blocking_queue_close(bq);
+	long bq_sum = 0;
+	size_t bq_count = 0;
+	int bq_order = 1;
+	for (int i = 0; i < STRESS_THREADS; ++i) {
+		thrd_join(consumer_threads[i], NULL);
+		bq_sum += consumers[i].sum;
+		bq_count += consumers[i].count;
+		bq_order &= consumers[i].in_order;
+	}
+	check(bq_count == (size_t)STRESS_THREADS * STRESS_ITEMS && bq_sum == (long)STRESS_THREADS * STRESS_ITEMS * (STRESS_ITEMS - 1) / 2, "every element is delivered exactly once");
+	check(bq_order, "each producer's elements arrive in order");
+	check(!blocking_queue_push(bq, &bq_value) && !blocking_queue_pop(bq, &bq_value), "closed queue rejects pushes and is drained");
+	blocking_queue_destroy(bq);
+
+	printf("__Inline Vector__\n");
+	vector_storage(small_storage, int, 4);
+	vector_t* small = vector_create_inline(small_storage, int);
+	check(small && (void*)small == (void*)small_storage && vector_is_inline(small), "small vector lives in its storage");
+	for (int i = 0; i < 4; ++i) { vector_push_back(small, &i); }
+	check(vector_is_inline(small) && vector_size(small) == 4, "inline capacity is used before spilling");
+	for (int i = 4; i < 100; ++i) { vector_push_back(small, &i); }
+	int spilled_ok = !vector_is_inline(small) && vector_size(small) == 100;
+	for (size_t i = 0; i < vector_size(small); ++i) {
+		if (*(int*)vector_get(small, i) != (int)i) { spilled_ok = 0; }
+	}
+	check(spilled_ok, "spilled vector keeps every element");
+	vector_destroy(small);
+	vector_storage(unused_storage, int, 8);
+	vector_t* unused = vector_create_inline(unused_storage, int);
+	int unused_value = 3;
+	vector_push_front(unused, &unused_value);
+	check(vector_is_inline(unused) && *(int*)vector_get_front(unused) == 3, "destroying an unspilled vector frees nothing");
+	vector_destroy(unused);
+	check(vector_create_inline(small_storage, uint8_t[sizeof small_storage]) == NULL, "storage too small for one element is rejected");
+
+	printf("__Vector Scans__\n");
+	const size_t key_widths[VECTOR_KEY_COUNT] = { 1, 1, 2, 2, 4, 4, 8, 8, 4, 8 };
+	int kernels_agree = 1;
+	for (int key = 0; key < VECTOR_KEY_COUNT; ++key) {
+		if (!scan_matches_scalar((vector_key_t)key, key_widths[key])) {
+			printf("key type %d differs\n", key);
+			kernels_agree = 0;
+		}
+	}
+	check(kernels_agree, "SIMD find, count and filter match the scalar kernels for every key type");
+	vector_t* sorted_keys = vector_create(int32_t);
+	for (int32_t i = 0; i < 100; ++i) {
+		int32_t twice = i * 2;
+		vector_push_back(sorted_keys, &twice);
+	}
+	int32_t probe = 51;
+	int32_t low_probe = -3;
+	check(vector_lower_bound(sorted_keys, VECTOR_KEY_I32, &probe) == 26 && vector_lower_bound(sorted_keys, VECTOR_KEY_I32, &low_probe) == 0, "lower bound on sorted keys");
+	vector_destroy(sorted_keys);
+
+	printf("__Vector Permutations__\n");
+	typedef struct { int id; char blob[2000]; } bulky_t;
+	vector_t* bulky = vector_create(bulky_t);
+	bulky_t bulk_item;
+	memset(&bulk_item, 0, sizeof bulk_item);
+	for (int i = 0; i < 3; ++i) {
+		bulk_item.id = i;
+		memset(bulk_item.blob, 'a' + i, sizeof bulk_item.blob);
+		vector_push_back(bulky, &bulk_item);
+	}
+	vector_swap(bulky, 0, 2);
+	bulky_t* swapped_first = vector_get(bulky, 0);
+	bulky_t* swapped_last = vector_get(bulky, 2);
+	check(swapped_first->id == 2 && swapped_first->blob[1999] == 'c' && swapped_last->id == 0 && swapped_last->blob[0] == 'a', "swap of large elements");
+	vector_destroy(bulky);
+	vector_t* perm_vec = iota_vector(10);
+	vector_reverse(perm_vec);
+	check(*(int*)vector_get_front(perm_vec) == 9 && *(int*)vector_get_back(perm_vec) == 0, "reverse");
+	vector_reverse(perm_vec);
+	vector_rotate(perm_vec, 3);
+	check(*(int*)vector_get_front(perm_vec) == 3 && *(int*)vector_get(perm_vec, 6) == 9 && *(int*)vector_get_back(perm_vec) == 2, "rotate left");
+	vector_destroy(perm_vec);
+	vector_t* shuffled_a = iota_vector(100);
+	vector_t* shuffled_b = iota_vector(100);
+	vector_shuffle(shuffled_a, 1234);
+	vector_shuffle(shuffled_b, 1234);
+	int shuffle_same = 1, shuffle_moved = 0;
+	unsigned char seen_values[100] = { 0 };
+	for (size_t i = 0; i < 100; ++i) {
+		int value = *(int*)vector_get(shuffled_a, i);
+		if (value != *(int*)vector_get(shuffled_b, i)) { shuffle_same = 0; }
+		if (value != (int)i) { shuffle_moved = 1; }
+		seen_values[value]++;
+	}
+	int shuffle_complete = 1;
+	for (size_t i = 0; i < 100; ++i) {
+		if (seen_values[i] != 1) { shuffle_complete = 0; }
+	}
+	check(shuffle_same && shuffle_moved && shuffle_complete, "shuffle is a seeded permutation");
+	vector_destroy(shuffled_b);
+	size_t perm_table[100];
+	for (size_t i = 0; i < 100; ++i) { perm_table[i] = (i * 7) % 100; }
+	vector_t* expected_perm = iota_vector(100);
+	vector_t* permuted = iota_vector(100);
+	check(vector_apply_permutation(permuted, perm_table), "apply a permutation");
+	int perm_ok = 1;
+	for (size_t i = 0; i < 100; ++i) {
+		if (*(int*)vector_get(permuted, i) != (int)((i * 7) % 100) || perm_table[i] != (i * 7) % 100) { perm_ok = 0; }
+	}
+	check(perm_ok, "position i receives element p[i] and the table is left unchanged");
+	perm_table[5] = perm_table[6];
+	check(!vector_apply_permutation(expected_perm, perm_table) && *(int*)vector_get(expected_perm, 5) == 5, "a table with a repeat is rejected");
+	vector_destroy(expected_perm);
+	vector_destroy(permuted);
+	vector_destroy(shuffled_a);
+
+	printf("__Vector Erase__\n");
+	vector_t* erase_vec = iota_vector(10);
+	vector_swap_remove(erase_vec, 2);
+	check(vector_size(erase_vec) == 9 && *(int*)vector_get(erase_vec, 2) == 9 && *(int*)vector_get_back(erase_vec) == 8, "swap remove moves the last element into the hole");
+	vector_swap_remove(erase_vec, 8);
+	check(vector_size(erase_vec) == 8 && *(int*)vector_get_back(erase_vec) == 7, "swap remove of the last element");
+	vector_destroy(erase_vec);
+	vector_t* filter_vec = iota_vector(20);
+	int divisor = 3;
+	check(vector_erase_if(filter_vec, is_multiple, &divisor) == 7 && vector_size(filter_vec) == 13, "erase if removes matches");
+	int filter_ok = 1, filter_previous = -1;
+	for (size_t i = 0; i < vector_size(filter_vec); ++i) {
+		int value = *(int*)vector_get(filter_vec, i);
+		if (value % 3 == 0 || value <= filter_previous) { filter_ok = 0; }
+		filter_previous = value;
+	}
+	check(filter_ok, "erase if keeps the order of the rest");
+	divisor = 100;
+	check(vector_erase_if(filter_vec, is_multiple, &divisor) == 0 && vector_size(filter_vec) == 13, "erase if without matches");
+	vector_destroy(filter_vec);
+	vector_t* indexed_vec = iota_vector(10);
+	size_t erase_at[] = { 0, 3, 3, 9 };
+	check(vector_erase_indices(indexed_vec, erase_at, 4) == 3 && vector_size(indexed_vec) == 7, "erase indices removes repeats once");
+	int indexed_expect[] = { 1, 2, 4, 5, 6, 7, 8 };
+	int indexed_ok = 1;
+	for (size_t i = 0; i < 7; ++i) {
+		if (*(int*)vector_get(indexed_vec, i) != indexed_expect[i]) { indexed_ok = 0; }
+	}
+	check(indexed_ok, "erase indices keeps the order of the rest");
+	size_t erase_unsorted[] = { 4, 1 };
+	size_t erase_outside[] = { 1, 7 };
+	check(vector_erase_indices(indexed_vec, erase_unsorted, 2) == 0 && vector_erase_indices(indexed_vec, erase_outside, 2) == 0 && vector_size(indexed_vec) == 7, "out of order or out of range indices are rejected");
+	vector_destroy(indexed_vec);
+
+#if !defined(_WIN32)
+	printf("__Mapped Vector__\n");
+	const char* mapped_path = "cc_mapped_vector.bin";
+	remove(mapped_path);
+	vector_t* mapped = vector_open(int, mapped_path);
+	check(mapped && vector_size(mapped) == 0, "open a new file");
+	for (int i = 0; i < 5000; ++i) { vector_push_back(mapped, &i); }
+	check(vector_size(mapped) == 5000 && *(int*)vector_get(mapped, 4999) == 4999, "grow past the first page");
+	check(vector_flush(mapped) && vector_advise(mapped, VECTOR_ADVICE_SEQUENTIAL), "flush & advise");
+	vector_t* second_map = vector_open(int, mapped_path);
+	check(second_map == NULL, "a second open is refused while the file is in use");
+	int mapped_extra = -1;
+	vector_push_back(mapped, &mapped_extra);
+	vector_destroy(mapped);
+	mapped = vector_open(int, mapped_path);
+	int mapped_ok = mapped && vector_size(mapped) == 5001 && mapped->_capacity >= 5001;
+	for (size_t i = 0; mapped_ok && i < 5000; ++i) {
+		if (*(int*)vector_get(mapped, i) != (int)i) { mapped_ok = 0; }
+	}
+	check(mapped_ok && *(int*)vector_get_back(mapped) == -1, "reopen restores the length & derives the capacity from the file size");
+	vector_destroy(mapped);
+	check(vector_open(double, mapped_path) == NULL, "another element size is rejected");
+	remove(mapped_path);
+#endif
+	return failures != 0;
 }
\ No newline at end of file